@@ -0,0 +1,65 @@
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+/*
+    $ ./batch_throughput [scripts]
+
+    It writes a directory of small scripts (a quarter of them byte identical) and runs them
+    with one process per script and with a single "--batch" process, and prints both throughputs.
+    LANG_EXECUTABLE is the path of the interpreter, it is set by CMake.
+*/
+int main(int argc, const char* argv[])
+{
+    std::size_t script_count = (argc == 2) ? std::stoul(argv[1]) : 200;
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "lang_batch_throughput";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    for(std::size_t i = 0; i < script_count; i++)
+    {
+        std::ofstream script(directory / ("script_" + std::to_string(i) + ".ll"));
+
+        std::size_t variant = (i % 4 == 0) ? 0 : i;
+        script << "fun fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }\n";
+        script << "var total = 0;\n";
+        script << "for (var i = 0; i < 10; i = i + 1) { total = total + fib(i) + " << variant << "; }\n";
+        script << "print total;\n";
+    }
+
+    std::string executable = LANG_EXECUTABLE;
+
+    auto start = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < script_count; i++)
+    {
+        std::string command = executable + " " + (directory / ("script_" + std::to_string(i) + ".ll")).string() + " > /dev/null";
+        if(std::system(command.c_str()) != 0)
+        {
+            std::cerr << "failed: " << command << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+    double process_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    std::string command = executable + " --batch " + directory.string() + " > /dev/null";
+    if(std::system(command.c_str()) != 0)
+    {
+        std::cerr << "failed: " << command << "\n";
+        return EXIT_FAILURE;
+    }
+    double batch_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "scripts             " << script_count << "\n";
+    std::cout << "process per script  " << script_count / process_seconds << " scripts/s\n";
+    std::cout << "--batch             " << script_count / batch_seconds << " scripts/s\n";
+    std::cout << "speedup             " << process_seconds / batch_seconds << "\n";
+
+    std::filesystem::remove_all(directory);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,76 @@
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <lang/lang.hpp>
+
+/*
+    $ ./execute_overhead [executions]
+
+    It runs a small script with a different input global each time, in two ways:
+        full    :- compile the source and execute it in a new Lang for every execution
+        reused  :- compile once, then execute the shared program on one Lang, reading the result global back
+    and prints the average time of one execution for both.
+*/
+namespace
+{
+    const char* SOURCE = R"(
+        fun square(n) { return n * n; }
+        var result = square(input) + 1;
+        print result;
+    )";
+
+    double elapsed_ns(std::chrono::steady_clock::time_point start)
+    {
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    std::size_t executions = (argc == 2) ? std::stoul(argv[1]) : 20000;
+
+    std::ostringstream output;
+    double checksum{0};
+
+    auto start = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < executions; i++)
+    {
+        lang::Lang runtime;
+        runtime.set_output(output);
+
+        auto program = lang::Lang::compile(SOURCE);
+        (void)runtime.execute(*program, {{"input", static_cast<double>(i)}});
+
+        checksum += std::get<double>(*runtime.get_global("result"));
+        output.str("");
+    }
+    double full_ns = elapsed_ns(start) / executions;
+
+    auto program = lang::Lang::compile(SOURCE);
+    lang::Lang runtime;
+    runtime.set_output(output);
+
+    start = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < executions; i++)
+    {
+        auto result = runtime.execute(*program, {{"input", static_cast<double>(i)}});
+        if(!result.ok())
+        {
+            std::cerr << result.errors.front() << "\n";
+            return EXIT_FAILURE;
+        }
+
+        checksum -= std::get<double>(*runtime.get_global("result"));
+        output.str("");
+    }
+    double reused_ns = elapsed_ns(start) / executions;
+
+    std::cout << "executions " << executions << "\n";
+    std::cout << "full       " << full_ns << " ns/execution\n";
+    std::cout << "reused     " << reused_ns << " ns/execution\n";
+    std::cout << "checksum   " << checksum << "\n";
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,260 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <lang/lang.hpp>
+#include <memory/memory.hpp>
+
+/*
+    $ ./frontend_throughput [max_size_mb] [shape]
+
+    Lexer::tokenize and Parser::parse timed separately on generated programs of 1 KB, 10 KB, ... up to
+    max_size_mb (100 by default), for every shape of program:
+        functions    :- many small function declarations
+        nesting      :- functions with 64 levels of nested if blocks
+        expressions  :- statements with a 2000 term arithmetic expression each
+        strings      :- 64 KB string literals
+        mixed        :- the four above in turn
+    The best of the repetitions is reported in MB/s and in tokens/s with the heap allocations of each phase
+    and the peak heap bytes of lexing and of parsing, above what was allocated before the phase (lang::memory
+    accounting). A ns/token that grows with the size is superlinear behavior. The tokens and the AST of a
+    100 MB program take several GB, pass a smaller max_size_mb on small machines.
+*/
+namespace
+{
+    enum class Shape
+    {
+        FUNCTIONS,
+        NESTING,
+        EXPRESSIONS,
+        STRINGS,
+        MIXED
+    };
+
+    const char* shape_name(Shape shape)
+    {
+        switch(shape)
+        {
+            case Shape::FUNCTIONS: return "functions";
+            case Shape::NESTING: return "nesting";
+            case Shape::EXPRESSIONS: return "expressions";
+            case Shape::STRINGS: return "strings";
+            case Shape::MIXED: return "mixed";
+        }
+
+        return "";
+    }
+
+    void append_function(std::string& source, std::size_t index)
+    {
+        std::string name = "f" + std::to_string(index);
+        source += "fun " + name + "(a, b)\n{\n    var x = a * 2 + b;\n    if (x > 10) { return x - 1; }\n    while (x < 100) { x = x + " + name + "(x, 1); }\n    return x;\n}\n";
+    }
+
+    void append_nesting(std::string& source, std::size_t index)
+    {
+        constexpr std::size_t DEPTH = 64;
+
+        source += "fun n" + std::to_string(index) + "(x)\n{\n";
+        for(std::size_t level = 1; level <= DEPTH; level++)
+        {
+            source += std::string(level * 4, ' ') + "if (x > " + std::to_string(level) + ") { x = x - 1;\n";
+        }
+        for(std::size_t level = DEPTH; level >= 1; level--)
+        {
+            source += std::string(level * 4, ' ') + "}\n";
+        }
+        source += "    return x;\n}\n";
+    }
+
+    void append_expression(std::string& source, std::size_t index)
+    {
+        constexpr std::size_t TERMS = 2000;
+        const char* operators[] = {" + ", " * ", " - ", " / "};
+
+        source += "var e" + std::to_string(index) + " = 1";
+        for(std::size_t term = 0; term < TERMS; term++)
+        {
+            source += operators[term % 4];
+            source += (term % 10 == 0) ? "(v" + std::to_string(term) + " - 3)" : "v" + std::to_string(term);
+        }
+        source += ";\n";
+    }
+
+    void append_string(std::string& source, std::size_t index)
+    {
+        constexpr std::size_t LENGTH = 64 * 1024;
+
+        source += "var s" + std::to_string(index) + " = \"";
+        for(std::size_t i = 0; i < LENGTH; i++)
+        {
+            source += static_cast<char>('a' + (i * 7 + index) % 26);
+        }
+        source += "\";\n";
+    }
+
+    /* Pieces of the shape until the program has at least "size" bytes */
+    std::string generate_program(Shape shape, std::size_t size)
+    {
+        std::string source;
+        source.reserve(size + 128 * 1024);
+
+        for(std::size_t index = 0; source.size() < size; index++)
+        {
+            Shape piece = (shape == Shape::MIXED) ? static_cast<Shape>(index % 4) : shape;
+            switch(piece)
+            {
+                case Shape::FUNCTIONS: append_function(source, index); break;
+                case Shape::NESTING: append_nesting(source, index); break;
+                case Shape::EXPRESSIONS: append_expression(source, index); break;
+                default: append_string(source, index); break;
+            }
+        }
+
+        return source;
+    }
+
+    struct PhaseResult
+    {
+        double seconds{0};
+        std::uint64_t allocations{0};
+        std::uint64_t allocated_bytes{0};
+        std::int64_t peak_bytes{0}; /* above the bytes allocated when the phase started */
+    };
+
+    struct Result
+    {
+        std::size_t tokens{0};
+        PhaseResult lex;
+        PhaseResult parse;
+    };
+
+    double elapsed_s(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /* It fails the benchmark if the generated program does not compile */
+    Result measure_once(const std::string& source)
+    {
+        Result result;
+
+        std::string copy = source;
+        lang::Lexer lexer;
+        lang::Parser parser;
+
+        std::int64_t heap_before = lang::memory::total_stats().current_bytes;
+        lang::memory::reset_peaks();
+
+        auto before = lang::memory::thread_counters();
+        auto start = std::chrono::steady_clock::now();
+        auto [tokens, tokenization_errors] = lexer.tokenize(std::move(copy));
+        result.lex.seconds = elapsed_s(start);
+        auto after_lex = lang::memory::thread_counters();
+
+        result.lex.peak_bytes = lang::memory::total_stats().peak_bytes - heap_before;
+        result.tokens = tokens.size();
+
+        heap_before = lang::memory::total_stats().current_bytes;
+        lang::memory::reset_peaks();
+
+        start = std::chrono::steady_clock::now();
+        auto [statements, parsing_errors] = parser.parse(std::move(tokens));
+        result.parse.seconds = elapsed_s(start);
+        auto after_parse = lang::memory::thread_counters();
+
+        result.parse.peak_bytes = lang::memory::total_stats().peak_bytes - heap_before;
+
+        if(!tokenization_errors.empty() || !parsing_errors.empty() || statements.empty())
+        {
+            std::cerr << "The generated program does not compile: " << (tokenization_errors.empty() ? (parsing_errors.empty() ? "no statements" : parsing_errors.front()) : tokenization_errors.front()) << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+
+        result.lex.allocations = after_lex.allocations - before.allocations;
+        result.lex.allocated_bytes = after_lex.allocated_bytes - before.allocated_bytes;
+        result.parse.allocations = after_parse.allocations - after_lex.allocations;
+        result.parse.allocated_bytes = after_parse.allocated_bytes - after_lex.allocated_bytes;
+
+        return result;
+    }
+
+    std::string format_size(std::size_t bytes)
+    {
+        if(bytes >= 1024 * 1024)
+        {
+            return std::to_string(bytes / (1024 * 1024)) + " MB";
+        }
+        return std::to_string(bytes / 1024) + " KB";
+    }
+
+    void run_shape(Shape shape, std::size_t max_size)
+    {
+        std::cout << "\n" << shape_name(shape) << "\n";
+        std::cout << "    size   tokens      lex MB/s  lex Mtok/s  lex ns/tok  lex allocs   parse MB/s  parse Mtok/s  parse ns/tok  parse allocs  parse MB alloc  lex peak MB  parse peak MB\n";
+
+        const std::size_t sizes[] = {1 << 10, 10 << 10, 100 << 10, 1 << 20, 10 << 20, 100 << 20};
+        for(std::size_t size: sizes)
+        {
+            if(size > max_size)
+            {
+                break;
+            }
+
+            std::string source = generate_program(shape, size);
+
+            /* About 4 MB of source per size, at least once */
+            std::size_t repetitions = std::clamp<std::size_t>((4 * 1024 * 1024) / source.size(), 1, 100);
+
+            Result best = measure_once(source);
+            for(std::size_t i = 1; i < repetitions; i++)
+            {
+                Result result = measure_once(source);
+                best.lex.seconds = std::min(best.lex.seconds, result.lex.seconds);
+                best.parse.seconds = std::min(best.parse.seconds, result.parse.seconds);
+            }
+
+            double mb = static_cast<double>(source.size()) / (1024.0 * 1024.0);
+            double tokens = static_cast<double>(best.tokens);
+
+            char row[512];
+            std::snprintf(row, sizeof(row), "  %6s  %9zu  %10.1f  %10.2f  %10.1f  %10llu   %10.1f  %12.2f  %12.1f  %12llu  %14.1f  %11.1f  %13.1f\n",
+                format_size(size).c_str(), best.tokens,
+                mb / best.lex.seconds, tokens / best.lex.seconds / 1e6, best.lex.seconds * 1e9 / tokens, static_cast<unsigned long long>(best.lex.allocations),
+                mb / best.parse.seconds, tokens / best.parse.seconds / 1e6, best.parse.seconds * 1e9 / tokens, static_cast<unsigned long long>(best.parse.allocations),
+                static_cast<double>(best.parse.allocated_bytes) / (1024.0 * 1024.0),
+                static_cast<double>(best.lex.peak_bytes) / (1024.0 * 1024.0), static_cast<double>(best.parse.peak_bytes) / (1024.0 * 1024.0));
+            std::cout << row << std::flush;
+        }
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    /* For the peaks of the phases */
+    lang::memory::enable_accounting();
+
+    std::size_t max_size = static_cast<std::size_t>((argc >= 2) ? std::stod(argv[1]) * 1024 * 1024 : 100.0 * 1024 * 1024);
+
+    std::vector<Shape> shapes = {Shape::FUNCTIONS, Shape::NESTING, Shape::EXPRESSIONS, Shape::STRINGS, Shape::MIXED};
+    if(argc >= 3)
+    {
+        auto found = std::find_if(shapes.begin(), shapes.end(), [&](Shape shape){ return std::strcmp(shape_name(shape), argv[2]) == 0; });
+        if(found == shapes.end())
+        {
+            std::cerr << "Unknown shape " << argv[2] << "\n";
+            return EXIT_FAILURE;
+        }
+        shapes = {*found};
+    }
+
+    for(Shape shape: shapes)
+    {
+        run_shape(shape, max_size);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,68 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include <isolate/isolate.hpp>
+
+/*
+    $ ./isolate_throughput [scripts]
+
+    It runs the same number of independent CPU bound scripts with ScriptRunners of 1, 2, 4, ... threads
+    (up to the number of hardware threads) and prints the throughput and the speedup over one thread.
+*/
+namespace
+{
+    const char* SOURCE = R"(
+        var total = 0;
+        for(var i = 0; i < 20000; i = i + 1)
+        {
+            total = total + i * input;
+        }
+        print total;
+    )";
+}
+
+int main(int argc, const char* argv[])
+{
+    std::size_t script_count = (argc == 2) ? std::stoul(argv[1]) : 64;
+    std::size_t max_threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+
+    auto program = lang::Lang::compile(SOURCE);
+
+    std::vector<lang::Script> scripts;
+    for(std::size_t i = 0; i < script_count; i++)
+    {
+        scripts.push_back(lang::Script{program, {{"input", static_cast<double>(i)}}});
+    }
+
+    std::cout << "scripts " << script_count << ", hardware threads " << max_threads << "\n";
+
+    double single_thread_rate{0};
+    for(std::size_t threads = 1; threads <= max_threads; threads *= 2)
+    {
+        lang::ScriptRunner runner(threads);
+
+        auto start = std::chrono::steady_clock::now();
+        auto results = runner.run(scripts);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        for(const auto& result: results)
+        {
+            if(!result.errors.empty())
+            {
+                std::cerr << result.errors.front() << "\n";
+                return EXIT_FAILURE;
+            }
+        }
+
+        double rate = script_count / seconds;
+        if(threads == 1)
+        {
+            single_thread_rate = rate;
+        }
+
+        std::cout << "threads " << threads << ": " << rate << " scripts/s, speedup " << rate / single_thread_rate << "\n";
+    }
+
+    return EXIT_SUCCESS;
+}
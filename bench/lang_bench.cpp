@@ -0,0 +1,336 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <lang/lang.hpp>
+
+/*
+    $ ./lang_bench [--warmup N] [--repetitions N] [--filter NAME] [--json FILE]
+
+    The reference workloads of the interpreter, to compare engine changes over time. Every workload is a fixed
+    script (nothing depends on the clock or on random numbers) that leaves a checksum in the global "result",
+    it is compiled once and executed N warm-up times and then N measured times by the same lang::Lang.
+
+    The report has the median, mean, variance and range of the measured runs, --json writes them with the
+    individual samples as well. Build it with $ make bench-configure bench-build for numbers worth comparing,
+    the default build of the repository is a Debug build.
+*/
+namespace
+{
+    struct Workload
+    {
+        const char* name;
+        const char* description;
+        std::string source;
+        double expected_result;
+    };
+
+    struct Statistics
+    {
+        double median{0};
+        double mean{0};
+        double variance{0}; /* of the sample, in ms^2 */
+        double min{0};
+        double max{0};
+    };
+
+    struct Measurement
+    {
+        const Workload* workload;
+        std::vector<double> samples_ms;
+        Statistics statistics;
+    };
+
+    /* 50 blocks nested in each iteration, every level declares a variable and reads the one of its parent */
+    std::string generate_deep_nesting()
+    {
+        constexpr int DEPTH = 50;
+
+        std::string source = "var result = 0;\nfor (var i = 0; i < 2000; i = i + 1)\n{\n    var v0 = 1;\n";
+        for(int level = 1; level <= DEPTH; level++)
+        {
+            source += std::string(static_cast<std::size_t>(level) * 4, ' ') + "{ var v" + std::to_string(level) + " = v" + std::to_string(level - 1) + " + 1;\n";
+        }
+
+        source += std::string(static_cast<std::size_t>(DEPTH + 1) * 4, ' ') + "result = result + v" + std::to_string(DEPTH) + ";\n";
+        for(int level = DEPTH; level >= 1; level--)
+        {
+            source += std::string(static_cast<std::size_t>(level) * 4, ' ') + "}\n";
+        }
+        source += "}\n";
+
+        return source;
+    }
+
+    std::vector<Workload> make_workloads()
+    {
+        std::vector<Workload> workloads;
+
+        workloads.push_back(Workload{"fib", "recursive fib(22)", R"(
+            fun fib(n)
+            {
+                if (n < 2) return n;
+                return fib(n - 1) + fib(n - 2);
+            }
+
+            var result = fib(22);
+        )", 17711});
+
+        workloads.push_back(Workload{"counted_while", "a while loop summing 300000 numbers", R"(
+            var result = 0;
+            var i = 0;
+            while (i < 300000)
+            {
+                result = result + i;
+                i = i + 1;
+            }
+        )", 44999850000});
+
+        workloads.push_back(Workload{"closure_counter", "100000 calls of a counter closure (lang/source_file/main1.ll)", R"(
+            fun makeCounter()
+            {
+                var i = 0;
+
+                fun count()
+                {
+                    i = i + 1;
+                    return i;
+                }
+
+                return count;
+            }
+
+            var counter = makeCounter();
+            var result = 0;
+            for (var j = 0; j < 100000; j = j + 1)
+            {
+                result = counter();
+            }
+        )", 100000});
+
+        workloads.push_back(Workload{"string_concat", "a 1 MB string built from 100000 pieces", R"(
+            var s = "";
+            var i = 0;
+            while (i < 100000)
+            {
+                s = s + "0123456789";
+                i = i + 1;
+            }
+
+            var result = len(s);
+        )", 1000000});
+
+        workloads.push_back(Workload{"deep_nesting", "2000 iterations of 50 nested blocks", generate_deep_nesting(), 2000 * 51});
+
+        workloads.push_back(Workload{"call_heavy", "200000 calls of small functions with 0 to 3 arguments", R"(
+            fun zero() { return 1; }
+            fun one(a) { return a; }
+            fun two(a, b) { return a + b; }
+            fun three(a, b, c) { return two(a, b) - c; }
+
+            var result = 0;
+            for (var i = 0; i < 50000; i = i + 1)
+            {
+                result = result + zero() + one(i) + three(i, 1, i);
+            }
+        )", 50000 * 2 + 1249975000});
+
+        return workloads;
+    }
+
+    Statistics compute_statistics(std::vector<double> samples)
+    {
+        Statistics statistics;
+        if(samples.empty())
+        {
+            return statistics;
+        }
+
+        std::sort(samples.begin(), samples.end());
+
+        std::size_t middle = samples.size() / 2;
+        statistics.median = (samples.size() % 2 == 1) ? samples[middle] : (samples[middle - 1] + samples[middle]) / 2.0;
+        statistics.min = samples.front();
+        statistics.max = samples.back();
+
+        for(double sample: samples)
+        {
+            statistics.mean += sample;
+        }
+        statistics.mean /= static_cast<double>(samples.size());
+
+        if(samples.size() > 1)
+        {
+            for(double sample: samples)
+            {
+                statistics.variance += (sample - statistics.mean) * (sample - statistics.mean);
+            }
+            statistics.variance /= static_cast<double>(samples.size() - 1);
+        }
+
+        return statistics;
+    }
+
+    double run_ms(lang::Lang& runtime, const Workload& workload, const lang::CompiledProgram& program)
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto result = runtime.execute(program);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        if(!result.ok())
+        {
+            std::cerr << workload.name << ": " << result.errors.front() << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+
+        /* A workload that computes something else is not measuring the same thing anymore */
+        const lang::util::object_t* checksum = runtime.get_global("result");
+        if(checksum == nullptr || !std::holds_alternative<double>(*checksum) || std::get<double>(*checksum) != workload.expected_result)
+        {
+            std::cerr << workload.name << ": wrong result\n";
+            std::exit(EXIT_FAILURE);
+        }
+
+        return ms;
+    }
+
+    void write_json(std::ostream& out, const std::vector<Measurement>& measurements, std::size_t warmup, std::size_t repetitions)
+    {
+#ifdef NDEBUG
+        const char* optimized = "true";
+#else
+        const char* optimized = "false";
+#endif
+
+        out << "{\n";
+        out << "  \"benchmark\": \"lang_bench\",\n";
+        out << "  \"build_type\": \"" << LANG_BUILD_TYPE << "\",\n";
+        out << "  \"optimized\": " << optimized << ",\n";
+        out << "  \"warmup\": " << warmup << ",\n";
+        out << "  \"repetitions\": " << repetitions << ",\n";
+        out << "  \"workloads\": [\n";
+
+        for(std::size_t i = 0; i < measurements.size(); i++)
+        {
+            const Measurement& measurement = measurements[i];
+            const Statistics& statistics = measurement.statistics;
+
+            out << "    {\n";
+            out << "      \"name\": \"" << measurement.workload->name << "\",\n";
+            out << "      \"description\": \"" << measurement.workload->description << "\",\n";
+            out << "      \"median_ms\": " << statistics.median << ",\n";
+            out << "      \"mean_ms\": " << statistics.mean << ",\n";
+            out << "      \"variance_ms2\": " << statistics.variance << ",\n";
+            out << "      \"min_ms\": " << statistics.min << ",\n";
+            out << "      \"max_ms\": " << statistics.max << ",\n";
+            out << "      \"samples_ms\": [";
+            for(std::size_t j = 0; j < measurement.samples_ms.size(); j++)
+            {
+                out << (j == 0 ? "" : ", ") << measurement.samples_ms[j];
+            }
+            out << "]\n";
+            out << "    }" << (i + 1 < measurements.size() ? "," : "") << "\n";
+        }
+
+        out << "  ]\n";
+        out << "}\n";
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    std::size_t warmup = 2;
+    std::size_t repetitions = 10;
+    std::string filter;
+    std::string json_path;
+
+    for(int i = 1; i + 1 < argc; i += 2)
+    {
+        if(std::strcmp(argv[i], "--warmup") == 0)
+        {
+            warmup = std::stoul(argv[i + 1]);
+        }
+        else if(std::strcmp(argv[i], "--repetitions") == 0)
+        {
+            repetitions = std::stoul(argv[i + 1]);
+        }
+        else if(std::strcmp(argv[i], "--filter") == 0)
+        {
+            filter = argv[i + 1];
+        }
+        else if(std::strcmp(argv[i], "--json") == 0)
+        {
+            json_path = argv[i + 1];
+        }
+        else
+        {
+            std::cerr << "Usage: lang_bench [--warmup N] [--repetitions N] [--filter NAME] [--json FILE]\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    if(repetitions == 0)
+    {
+        std::cerr << "--repetitions must be at least 1\n";
+        return EXIT_FAILURE;
+    }
+
+#ifndef NDEBUG
+    std::cerr << "warning: lang_bench was built without optimizations (" << LANG_BUILD_TYPE << "), see $ make bench-configure\n";
+#endif
+
+    std::vector<Workload> workloads = make_workloads();
+    std::vector<Measurement> measurements;
+
+    for(const auto& workload: workloads)
+    {
+        if(!filter.empty() && filter != workload.name)
+        {
+            continue;
+        }
+
+        auto program = lang::Lang::compile(workload.source);
+        if(!program->ok())
+        {
+            lang::Lang::write_compile_errors(*program, std::cerr);
+            return EXIT_FAILURE;
+        }
+
+        lang::Lang runtime;
+
+        for(std::size_t i = 0; i < warmup; i++)
+        {
+            run_ms(runtime, workload, *program);
+        }
+
+        Measurement measurement{&workload, {}, {}};
+        for(std::size_t i = 0; i < repetitions; i++)
+        {
+            measurement.samples_ms.push_back(run_ms(runtime, workload, *program));
+        }
+        measurement.statistics = compute_statistics(measurement.samples_ms);
+
+        const Statistics& statistics = measurement.statistics;
+        std::cout << workload.name << std::string(18 - std::strlen(workload.name), ' ') << "median " << statistics.median << " ms  mean " << statistics.mean << " ms  variance " << statistics.variance << " ms^2  range " << statistics.min << " - " << statistics.max << " ms\n";
+
+        measurements.push_back(std::move(measurement));
+    }
+
+    if(!json_path.empty())
+    {
+        std::ofstream file(json_path);
+        if(!file.is_open())
+        {
+            std::cerr << "Error opening the file " << json_path << "\n";
+            return EXIT_FAILURE;
+        }
+
+        write_json(file, measurements, warmup, repetitions);
+    }
+
+    return EXIT_SUCCESS;
+}
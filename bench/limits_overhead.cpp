@@ -0,0 +1,96 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include <lang/lang.hpp>
+
+/*
+    $ ./limits_overhead [repetitions]
+
+    A loop and call heavy script run without limits and with limits that are never reached, to measure
+    what the step counter of lang::ExecutionLimits costs. The best of the repetitions is reported.
+*/
+namespace
+{
+    const char* SOURCE = R"(
+        fun fib(n)
+        {
+            if (n < 2) return n;
+            return fib(n - 1) + fib(n - 2);
+        }
+
+        var total = 0;
+        var i = 0;
+        while (i < 20000)
+        {
+            total = total + i;
+            i = i + 1;
+        }
+
+        for (var j = 0; j < 20000; j = j + 1)
+        {
+            total = total + j;
+        }
+
+        var result = total + fib(18);
+    )";
+
+    double run_ms(lang::Lang& runtime, const lang::CompiledProgram& program)
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto result = runtime.execute(program);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        if(!result.ok())
+        {
+            std::cerr << result.errors.front() << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+
+        return ms;
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    std::size_t repetitions = (argc == 2) ? std::stoul(argv[1]) : 20;
+
+    auto program = lang::Lang::compile(SOURCE);
+
+    const char* names[] = {"no limits       ", "step budget     ", "deadline        ", "both            "};
+    lang::ExecutionLimits limits[] = {
+        {},
+        {1'000'000'000, std::chrono::milliseconds(0)},
+        {0, std::chrono::hours(1)},
+        {1'000'000'000, std::chrono::hours(1)},
+    };
+
+    lang::Lang runtimes[4];
+    double best[4] = {};
+    for(std::size_t kind = 0; kind < 4; kind++)
+    {
+        runtimes[kind].set_limits(limits[kind]);
+    }
+
+    /* The kinds take turns so that noise affects all of them alike */
+    for(std::size_t i = 0; i < repetitions; i++)
+    {
+        for(std::size_t kind = 0; kind < 4; kind++)
+        {
+            double ms = run_ms(runtimes[kind], *program);
+            best[kind] = (i == 0 || ms < best[kind]) ? ms : best[kind];
+        }
+    }
+
+    for(std::size_t kind = 0; kind < 4; kind++)
+    {
+        std::cout << names[kind] << best[kind] << " ms";
+        if(kind > 0)
+        {
+            std::cout << " (" << (best[kind] / best[0] - 1.0) * 100.0 << "%)";
+        }
+        std::cout << "\n";
+    }
+
+    return EXIT_SUCCESS;
+}
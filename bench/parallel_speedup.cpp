@@ -0,0 +1,74 @@
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <lang/lang.hpp>
+#include <parallel/parallel.hpp>
+
+/*
+    $ ./parallel_speedup [end]
+
+    It sums fib(i % 16) for i in [0, end) with a plain loop and with parallel_reduce() on 1, 2, 4 and 8 threads
+    (and one per hardware thread when there are more), and prints the times and the speedups over the loop.
+*/
+namespace
+{
+    const char* SOURCE = R"(
+        fun fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }
+        fun work(i) { return fib(i - 16 * floor_div(i, 16)); }
+        fun floor_div(a, b) { var q = 0; while ((q + 1) * b <= a) { q = q + 1; } return q; }
+
+        var start = nanotime();
+        var total = 0;
+        for (var i = 0; i < end; i = i + 1) { total = total + work(i); }
+        var loop_ns = nanotime() - start;
+
+        start = nanotime();
+        var parallel_total = parallel_reduce(work, 0, end);
+        var parallel_ns = nanotime() - start;
+    )";
+}
+
+int main(int argc, const char* argv[])
+{
+    double end = (argc == 2) ? std::stod(argv[1]) : 400;
+    std::size_t hardware_threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+
+    auto program = lang::Lang::compile(SOURCE);
+
+    std::vector<std::size_t> thread_counts{1, 2, 4, 8};
+    if(hardware_threads > 8)
+    {
+        thread_counts.push_back(hardware_threads);
+    }
+
+    std::cout << "range [0, " << end << "), hardware threads " << hardware_threads << "\n";
+
+    for(std::size_t threads: thread_counts)
+    {
+        lang::parallel::set_thread_count(threads);
+
+        lang::Lang runtime;
+        auto result = runtime.execute(*program, {{"end", end}});
+
+        if(!result.ok())
+        {
+            std::cerr << result.errors.front() << "\n";
+            return EXIT_FAILURE;
+        }
+
+        double loop_ns = std::get<double>(*runtime.get_global("loop_ns"));
+        double parallel_ns = std::get<double>(*runtime.get_global("parallel_ns"));
+
+        if(std::get<double>(*runtime.get_global("total")) != std::get<double>(*runtime.get_global("parallel_total")))
+        {
+            std::cerr << "parallel_reduce() and the loop disagree\n";
+            return EXIT_FAILURE;
+        }
+
+        std::cout << "threads " << threads << ": loop " << loop_ns / 1e6 << " ms, parallel_reduce " << parallel_ns / 1e6 << " ms, speedup " << loop_ns / parallel_ns << "\n";
+    }
+
+    return EXIT_SUCCESS;
+}
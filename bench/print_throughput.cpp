@@ -0,0 +1,99 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <lang/lang.hpp>
+
+/*
+    $ ./print_throughput [prints]
+
+    Numbers formatted and written to /dev/null:
+        iostream    :- out << value << "\n" on a std::ofstream, what the print statement did before the output sinks
+        sink        :- lang::util::append_number into a lang::FileSink
+    and a script that prints in a loop, once per kind of sink (the whole run, the interpreter included).
+*/
+namespace
+{
+    const char* SOURCE = R"(
+        for (var i = 0; i < count; i = i + 1)
+        {
+            print i * 0.25;
+        }
+    )";
+
+    const char* NULL_DEVICE = "/dev/null";
+
+    double elapsed_s(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void report(const char* name, std::size_t prints, double seconds)
+    {
+        std::cout << name << static_cast<std::size_t>(prints / seconds) << " prints/s\n";
+    }
+
+    double run_script(const lang::CompiledProgram& program, std::size_t prints, std::unique_ptr<lang::OutputSink> sink)
+    {
+        lang::Lang runtime;
+        runtime.set_output(std::move(sink));
+
+        auto start = std::chrono::steady_clock::now();
+        auto result = runtime.execute(program, {{"count", static_cast<double>(prints)}});
+        double seconds = elapsed_s(start);
+
+        if(!result.ok())
+        {
+            std::cerr << result.errors.front() << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+
+        return seconds;
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    std::size_t prints = (argc == 2) ? std::stoul(argv[1]) : 1000000;
+
+    std::cout << "prints " << prints << "\n";
+
+    {
+        std::ofstream out(NULL_DEVICE);
+
+        auto start = std::chrono::steady_clock::now();
+        for(std::size_t i = 0; i < prints; i++)
+        {
+            out << i * 0.25 << "\n";
+        }
+        out.flush();
+        report("iostream               ", prints, elapsed_s(start));
+    }
+
+    {
+        lang::FileSink sink(NULL_DEVICE);
+        std::string line;
+
+        auto start = std::chrono::steady_clock::now();
+        for(std::size_t i = 0; i < prints; i++)
+        {
+            line.clear();
+            lang::util::append_number(line, i * 0.25);
+            line += '\n';
+            sink.write(line);
+        }
+        sink.flush();
+        report("sink                   ", prints, elapsed_s(start));
+    }
+
+    auto program = lang::Lang::compile(SOURCE);
+
+    std::ofstream stream(NULL_DEVICE);
+    report("script, StreamSink     ", prints, run_script(*program, prints, std::make_unique<lang::StreamSink>(stream)));
+    report("script, FileSink line  ", prints, run_script(*program, prints, std::make_unique<lang::FileSink>(NULL_DEVICE, lang::FlushPolicy::EVERY_LINE)));
+    report("script, FileSink full  ", prints, run_script(*program, prints, std::make_unique<lang::FileSink>(NULL_DEVICE)));
+    report("script, MemorySink     ", prints, run_script(*program, prints, std::make_unique<lang::MemorySink>()));
+
+    return EXIT_SUCCESS;
+}
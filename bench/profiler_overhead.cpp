@@ -0,0 +1,78 @@
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <lang/lang.hpp>
+
+/*
+    $ ./profiler_overhead [repetitions]
+
+    A call heavy script run without the profiler, with only the shadow stack and with the shadow stack
+    sampled every millisecond of CPU time. The kinds take turns and the best run of each is reported.
+*/
+namespace
+{
+    const char* SOURCE = R"(
+        fun fib(n)
+        {
+            if (n < 2) return n;
+            return fib(n - 1) + fib(n - 2);
+        }
+
+        var result = fib(18);
+    )";
+
+    double run_ms(lang::Lang& runtime, const lang::CompiledProgram& program)
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto result = runtime.execute(program);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        if(!result.ok())
+        {
+            std::cerr << result.errors.front() << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+
+        return ms;
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    std::size_t repetitions = (argc == 2) ? std::stoul(argv[1]) : 30;
+
+    auto program = lang::Lang::compile(SOURCE);
+
+    lang::profiler::Profiler shadow_only("bench");
+    lang::profiler::Profiler sampled("bench");
+
+    lang::Lang plain;
+    lang::Lang with_stack;
+    lang::Lang with_sampling;
+    with_stack.set_shadow_stack(&shadow_only.shadow_stack());
+    with_sampling.set_shadow_stack(&sampled.shadow_stack());
+
+    double best[3] = {};
+    for(std::size_t i = 0; i < repetitions; i++)
+    {
+        double plain_ms = run_ms(plain, *program);
+        double stack_ms = run_ms(with_stack, *program);
+
+        sampled.start();
+        double sampling_ms = run_ms(with_sampling, *program);
+        sampled.stop();
+
+        best[0] = (i == 0 || plain_ms < best[0]) ? plain_ms : best[0];
+        best[1] = (i == 0 || stack_ms < best[1]) ? stack_ms : best[1];
+        best[2] = (i == 0 || sampling_ms < best[2]) ? sampling_ms : best[2];
+    }
+
+    std::cout << "no profiler     " << best[0] << " ms\n";
+    std::cout << "shadow stack    " << best[1] << " ms (" << (best[1] / best[0] - 1.0) * 100.0 << "%)\n";
+    std::cout << "sampling 1 ms   " << best[2] << " ms (" << (best[2] / best[0] - 1.0) * 100.0 << "%)\n";
+    std::cout << "samples         " << sampled.samples() << ", dropped " << sampled.dropped_samples() << "\n";
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <snapshot/snapshot.hpp>
+
+/*
+    $ ./snapshot_startup [runs]
+
+    Time to the first statement of a script that begins with a large generated prelude (functions, a class
+    and lookup tables filled by loops), measured from the start of the compilation to a mark() native the
+    script calls first:
+        source      :- compile prelude + script and run it all
+        snapshot    :- load the snapshot of the prelude, compile the script and restore the globals
+    The snapshot is written once, before the runs.
+*/
+namespace
+{
+    constexpr std::size_t FUNCTIONS = 300;
+    constexpr std::size_t TABLES = 40;
+    constexpr std::size_t TABLE_SIZE = 1000;
+
+    const char* SCRIPT = R"(
+        mark();
+        print f0(1) + table0[10] + get(names, "name10") + Vector(1, 2).length();
+    )";
+
+    std::chrono::steady_clock::time_point mark_time;
+
+    double native_mark_function()
+    {
+        mark_time = std::chrono::steady_clock::now();
+        return 0;
+    }
+
+    std::string generate_prelude()
+    {
+        std::string prelude;
+
+        for(std::size_t i = 0; i < FUNCTIONS; i++)
+        {
+            std::string n = std::to_string(i);
+            prelude += "fun f" + n + "(x) { var y = x * " + n + "; if (y > 100) { return y - 100; } return y + " + n + "; }\n";
+        }
+
+        prelude += "class Vector { init(x, y) { this.x = x; this.y = y; } length() { return this.x * this.x + this.y * this.y; } }\n";
+
+        for(std::size_t i = 0; i < TABLES; i++)
+        {
+            std::string n = std::to_string(i);
+            prelude += "var table" + n + " = array(" + std::to_string(TABLE_SIZE) + ", 0);\n";
+            prelude += "for (var i = 0; i < " + std::to_string(TABLE_SIZE) + "; i = i + 1) { table" + n + "[i] = f" + n + "(i) * 0.5; }\n";
+        }
+
+        prelude += "var names = map();\n";
+        for(std::size_t i = 0; i < 200; i++)
+        {
+            prelude += "set(names, \"name" + std::to_string(i) + "\", " + std::to_string(i) + ");\n";
+        }
+
+        return prelude;
+    }
+
+    double elapsed_ms(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(mark_time - start).count();
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    std::size_t runs = (argc == 2) ? std::stoul(argv[1]) : 20;
+
+    std::string prelude = generate_prelude();
+    std::string path = (std::filesystem::temp_directory_path() / "snapshot_startup.snap").string();
+
+    auto errors = lang::snapshot::create(prelude, path);
+    if(!errors.empty())
+    {
+        std::cerr << errors.front() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    std::ostringstream output;
+    double source_ms{0};
+    double snapshot_ms{0};
+
+    for(std::size_t i = 0; i < runs; i++)
+    {
+        {
+            lang::Lang runtime;
+            runtime.set_output(output);
+            runtime.register_native("mark", &native_mark_function);
+
+            auto start = std::chrono::steady_clock::now();
+            auto program = lang::Lang::compile(prelude + SCRIPT);
+            auto result = runtime.execute(*program);
+            source_ms += elapsed_ms(start);
+
+            if(!result.ok())
+            {
+                std::cerr << result.errors.front() << "\n";
+                return EXIT_FAILURE;
+            }
+        }
+
+        {
+            lang::Lang runtime;
+            runtime.set_output(output);
+            runtime.register_native("mark", &native_mark_function);
+
+            auto start = std::chrono::steady_clock::now();
+            auto snapshot = lang::snapshot::Snapshot::load(path);
+            auto program = snapshot->compile(SCRIPT);
+            auto result = runtime.execute(*program, *snapshot);
+            snapshot_ms += elapsed_ms(start);
+
+            if(!result.ok())
+            {
+                std::cerr << result.errors.front() << "\n";
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    std::cout << "prelude " << prelude.size() << " bytes, snapshot " << std::filesystem::file_size(path) << " bytes\n";
+    std::cout << "source    " << source_ms / runs << " ms to the first statement\n";
+    std::cout << "snapshot  " << snapshot_ms / runs << " ms to the first statement\n";
+    std::cout << "speedup   " << source_ms / snapshot_ms << "x\n";
+    std::cout << output.str().substr(0, output.str().find('\n')) << "\n";
+
+    std::filesystem::remove(path);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,76 @@
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <lang/lang.hpp>
+#include <tasks/tasks.hpp>
+
+/*
+    $ ./task_scaling [tasks]
+
+    It runs a script that spawns independent fib() tasks and joins them, on schedulers of 1, 2, 4 and 8 workers
+    (and one per hardware thread when there are more), and prints the time and the speedup over one worker.
+*/
+namespace
+{
+    std::string make_source(std::size_t task_count)
+    {
+        return R"(
+            fun fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }
+
+            var handles = array()" + std::to_string(task_count) + R"(, 0);
+            for (var i = 0; i < len(handles); i = i + 1) { handles[i] = spawn(fib, 17); }
+
+            var total = 0;
+            for (var i = 0; i < len(handles); i = i + 1) { total = total + join(handles[i]); }
+            print total;
+        )";
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    std::size_t task_count = (argc == 2) ? std::stoul(argv[1]) : 32;
+    std::size_t hardware_threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+
+    auto program = lang::Lang::compile(make_source(task_count));
+
+    std::vector<std::size_t> worker_counts{1, 2, 4, 8};
+    if(hardware_threads > 8)
+    {
+        worker_counts.push_back(hardware_threads);
+    }
+
+    std::cout << "tasks " << task_count << ", hardware threads " << hardware_threads << "\n";
+
+    double single_worker_seconds{0};
+    for(std::size_t workers: worker_counts)
+    {
+        lang::tasks::Scheduler scheduler(workers);
+
+        lang::Lang runtime;
+        std::ostringstream output;
+        runtime.set_output(output);
+        runtime.set_scheduler(&scheduler);
+
+        auto start = std::chrono::steady_clock::now();
+        auto result = runtime.execute(*program);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if(!result.ok())
+        {
+            std::cerr << result.errors.front() << "\n";
+            return EXIT_FAILURE;
+        }
+
+        if(workers == 1)
+        {
+            single_worker_seconds = seconds;
+        }
+
+        std::cout << "workers " << workers << ": " << seconds << " s, speedup " << single_worker_seconds / seconds << "\n";
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -1,30 +1,206 @@
 #include <iostream>
 #include <filesystem>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 #include <lang/lang.hpp>
+#include <batch/batch.hpp>
+#include <snapshot/snapshot.hpp>
+#include <memory/memory.hpp>
 
-/* $ ./main.out file  :- For this "argc" is 2 */
+namespace
+{
+    /* $ ./main.out --batch directory_or_list :- the reports in the order of the scripts and a summary */
+    int run_batch(const char* directory_or_list, const lang::ExecutionLimits& limits)
+    {
+        std::vector<std::string> paths = lang::batch::collect_scripts(directory_or_list);
+
+        lang::batch::ProgramCache cache;
+        auto reports = lang::batch::run(paths, std::thread::hardware_concurrency(), cache, limits);
+
+        std::size_t failed{0};
+        for(const auto& report: reports)
+        {
+            std::cout << "==> " << report.path << " <==\n" << report.output;
+            failed += report.succeeded ? 0 : 1;
+        }
+
+        std::cout << "\nBATCH SUMMARY: " << reports.size() << " scripts, " << reports.size() - failed << " succeeded, " << failed << " failed, " << cache.compilations() << " compiled\n";
+        for(const auto& report: reports)
+        {
+            if(!report.succeeded)
+            {
+                std::cout << "FAILED " << report.path << "\n";
+            }
+        }
+
+        return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    /* --mem-stats :- the report is written when main() returns, before the program of the run is freed */
+    class MemoryReport
+    {
+        public:
+            ~MemoryReport()
+            {
+                if(lang::memory::accounting_enabled())
+                {
+                    lang::memory::write_report(std::cerr);
+                }
+            }
+    };
+}
+
+/*
+    $ ./main.out [options] file  or  ./main.out [options] --batch directory_or_list
+    options :- --max-steps N  (loop iterations and calls)  --timeout MS  (wall clock time of every script)
+               --snapshot FILE  (the file runs after the prelude of the snapshot)
+               --profile  (samples the script functions, the folded stacks are written to stderr)
+               --profile=lines  (counts every statement and expression, the report is written to stderr)
+               --mem-stats  (the memory of every subsystem is written to stderr at exit)
+    $ ./main.out --make-snapshot prelude_file snapshot_file
+*/
 int main(int argc, const char* argv[])
 {
     try
     {
         lang::Lang application;
+        MemoryReport memory_report;
+        lang::ExecutionLimits limits;
+        std::shared_ptr<const lang::snapshot::Snapshot> snapshot;
+        bool profile{false};
+        bool profile_lines{false};
 
-        if(argc > 2 || argc <= 1)
+        std::vector<std::string_view> arguments(argv + 1, argv + argc);
+        while(arguments.size() >= 2)
         {
-            std::cout << "Usage: last [absolute_path_to_the_source_code_file]\n";
+            if(arguments[0] == "--profile")
+            {
+                profile = true;
+                arguments.erase(arguments.begin());
+                continue;
+            }
+
+            if(arguments[0] == "--profile=lines")
+            {
+                profile_lines = true;
+                arguments.erase(arguments.begin());
+                continue;
+            }
+
+            if(arguments[0] == "--mem-stats")
+            {
+                lang::memory::enable_accounting();
+                arguments.erase(arguments.begin());
+                continue;
+            }
+
+            if(arguments[0] != "--max-steps" && arguments[0] != "--timeout" && arguments[0] != "--snapshot")
+            {
+                break;
+            }
+
+            if(arguments[0] == "--snapshot")
+            {
+                snapshot = lang::snapshot::Snapshot::load(std::string(arguments[1]));
+            }
+            else if(arguments[0] == "--max-steps")
+            {
+                limits.max_steps = std::stoull(std::string(arguments[1]));
+            }
+            else
+            {
+                limits.timeout = std::chrono::milliseconds(std::stoull(std::string(arguments[1])));
+            }
+
+            arguments.erase(arguments.begin(), arguments.begin() + 2);
+        }
+
+        if(arguments.size() == 3 && arguments[0] == "--make-snapshot")
+        {
+            std::ifstream file{std::string(arguments[1])};
+            if(!file.is_open())
+            {
+                std::cout << "Provided file does not exists\n";
+                return EXIT_FAILURE;
+            }
+
+            std::stringstream prelude;
+            prelude << file.rdbuf();
+
+            auto errors = lang::snapshot::create(std::move(prelude).str(), std::string(arguments[2]));
+            lang::Lang::write_execution_errors(lang::ExecutionResult{errors}, std::cout);
+
+            return errors.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        else if(arguments.size() == 2 && arguments[0] == "--batch")
+        {
+            std::string directory_or_list(arguments[1]);
+            if(!std::filesystem::exists(directory_or_list))
+            {
+                std::cout << "Provided directory or list does not exists\n";
+                return EXIT_FAILURE;
+            }
+
+            return run_batch(directory_or_list.c_str(), limits);
+        }
+        else if(arguments.size() != 1)
+        {
+            std::cout << "Usage: last [options] [absolute_path_to_the_source_code_file]\n";
+            std::cout << "       last [options] --batch [directory_of_ll_files | file_listing_one_path_per_line]\n";
+            std::cout << "Options: --max-steps N  stop a script after N loop iterations and function calls\n";
+            std::cout << "         --timeout MS   stop a script after MS milliseconds\n";
+            std::cout << "         --snapshot FILE  run the file after the prelude saved in the snapshot\n";
+            std::cout << "         --profile      write the folded stacks of the script functions to stderr\n";
+            std::cout << "         --profile=lines  write the execution count and time of every line to stderr\n";
+            std::cout << "         --mem-stats    write the memory used by every subsystem to stderr at exit\n";
+            std::cout << "       last --make-snapshot [prelude_file] [snapshot_file]\n";
             return EXIT_FAILURE;
         }
-        else if(argc == 2)
+        else
         {
-            if(!std::filesystem::exists(argv[1]))
+            std::string path(arguments[0]);
+            if(!std::filesystem::exists(path))
             {
                 std::cout << "Provided file does not exists\n";
                 return EXIT_FAILURE;
             }
 
-            application.run_source_code(argv[1]);
+            application.set_limits(limits);
+
+            if(profile_lines)
+            {
+                if(!lang::profiler::LineProfiler::ENABLED)
+                {
+                    std::cerr << "--profile=lines needs a build configured with -DENABLE_LINE_PROFILER=ON\n";
+                    return EXIT_FAILURE;
+                }
+
+                lang::profiler::LineProfiler line_profiler;
+                application.set_line_profiler(&line_profiler);
+
+                application.run_source_code(path.c_str(), snapshot.get());
+
+                const lang::CompiledProgram* program = application.last_program();
+                line_profiler.write_report(std::cerr, program->statements(), program->source(), std::filesystem::path(path).filename().string());
+                return EXIT_SUCCESS;
+            }
+
+            if(!profile)
+            {
+                application.run_source_code(path.c_str(), snapshot.get());
+                return EXIT_SUCCESS;
+            }
+
+            lang::profiler::Profiler profiler(std::filesystem::path(path).filename().string());
+            application.set_shadow_stack(&profiler.shadow_stack());
+
+            profiler.start();
+            application.run_source_code(path.c_str(), snapshot.get());
+            profiler.stop();
+
+            profiler.write_folded(std::cerr);
             return EXIT_SUCCESS;
         }
 
@@ -34,4 +210,4 @@ int main(int argc, const char* argv[])
     }
 
     return EXIT_FAILURE;
-}
\ No newline at end of file
+}
@@ -0,0 +1,21 @@
+// Counted loop benchmark: the same 1M iteration sum with "while" and with the numeric "for" fast path
+
+var start = clock();
+var total = 0;
+var i = 0;
+while (i < 1000000)
+{
+    total = total + i;
+    i = i + 1;
+}
+print total;
+print clock() - start;
+
+start = clock();
+total = 0;
+for (var j = 0; j < 1000000; j = j + 1)
+{
+    total = total + j;
+}
+print total;
+print clock() - start;
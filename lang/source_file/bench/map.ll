@@ -0,0 +1,42 @@
+// Map benchmark: 1M number keys inserted and looked up twice, then 1M updates of a small set of string keys
+
+var numbers = map();
+var i = 0;
+while (i < 1000000)
+{
+    set(numbers, i, i);
+    i = i + 1;
+}
+
+var found = 0;
+i = 0;
+while (i < 1000000)
+{
+    if (has(numbers, i)) found = found + 1;
+    i = i + 1;
+}
+
+print len(numbers);
+print found;
+
+var words = map();
+var key = "k";
+i = 0;
+while (i < 1000000)
+{
+    set(words, key, i);
+    key = key + "k";
+    if (len(key) > 64) key = "w";
+    i = i + 1;
+}
+
+var total = 0;
+i = 0;
+while (i < 1000000)
+{
+    total = total + get(numbers, i);
+    i = i + 1;
+}
+
+print len(words);
+print total;
@@ -0,0 +1,31 @@
+// Property access benchmark: 1M reads of an instance field against 1M reads of an array element
+
+class Point
+{
+    init(x, y)
+    {
+        this.x = x;
+        this.y = y;
+    }
+}
+
+var p = Point(1, 2);
+var a = [1, 2];
+
+var start = clock();
+var total = 0;
+for (var i = 0; i < 1000000; i = i + 1)
+{
+    total = total + p.y;
+}
+print total;
+print clock() - start;
+
+start = clock();
+total = 0;
+for (var i = 0; i < 1000000; i = i + 1)
+{
+    total = total + a[1];
+}
+print total;
+print clock() - start;
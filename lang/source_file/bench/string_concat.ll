@@ -0,0 +1,11 @@
+// String concatenation benchmark: a 10 MB string built from 1M pieces of 10 characters
+
+var s = "";
+var i = 0;
+while (i < 1000000)
+{
+    s = s + "0123456789";
+    i = i + 1;
+}
+
+print len(s);
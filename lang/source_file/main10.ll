@@ -0,0 +1,24 @@
+fun fib(n)
+{
+    if (n < 2) return n;
+    return fib(n - 1) + fib(n - 2);
+}
+
+// Every task gets copies of its arguments and of the globals it can see
+var handles = array(4, 0);
+for (var i = 0; i < 4; i = i + 1)
+{
+    handles[i] = spawn(fib, 15 + i);
+}
+
+for (var i = 0; i < 4; i = i + 1)
+{
+    print join(handles[i]);
+}
+
+fun total(values)
+{
+    return sum(values);
+}
+
+print join(spawn(total, [1, 2, 3, 4]));
@@ -0,0 +1,17 @@
+fun fib(n)
+{
+    if (n < 2) return n;
+    return fib(n - 1) + fib(n - 2);
+}
+
+// The function must be pure: no print, no writes to outer variables
+print parallel_map(fib, 0, 10);
+print parallel_reduce(fib, 0, 20);
+
+fun larger(a, b)
+{
+    if (a > b) return a;
+    return b;
+}
+
+print parallel_reduce(fib, 0, 20, larger);
@@ -0,0 +1,11 @@
+
+var xs = array(1000000, 0.5);
+var ys = [1, 2, 3, 4];
+
+ys[0] = 10;
+
+print len(xs);
+print sum(xs);
+print dot(ys, scale(ys, 2));
+print min(ys);
+print max(add(ys, ys));
@@ -0,0 +1,19 @@
+
+fun fib(n)
+{
+    if (n <= 1) return n;
+    return fib(n - 2) + fib(n - 1);
+}
+
+fun work()
+{
+    return fib(12);
+}
+
+var start = clock();
+var report = bench(work, 20);
+
+print get(report, "median_ns");
+print get(report, "p99_ns");
+print get(report, "allocations");
+print clock() - start;
@@ -0,0 +1,33 @@
+
+class Counter
+{
+    init(start)
+    {
+        this.count = start;
+    }
+
+    increment()
+    {
+        this.count = this.count + 1;
+        return this;
+    }
+}
+
+class LoudCounter < Counter
+{
+    increment()
+    {
+        super.increment();
+        print this.count;
+        return this;
+    }
+}
+
+var counter = LoudCounter(10);
+
+for (var i = 0; i < 3; i = i + 1)
+{
+    counter.increment();
+}
+
+print counter.count;
@@ -17,6 +17,8 @@ namespace lang
         struct WhileStatement;
         struct FunctionStatement;
         struct ReturnStatement;
+        struct NumericForStatement;
+        struct ClassStatement;
         
         struct BaseVisitorForStatement
         {
@@ -28,10 +30,14 @@ namespace lang
             virtual void visit(WhileStatement* statement) = 0;
             virtual void visit(FunctionStatement* statement) = 0;
             virtual void visit(ReturnStatement* statement) = 0;
+            virtual void visit(NumericForStatement* statement) = 0;
+            virtual void visit(ClassStatement* statement) = 0;
         };
 
         struct Statement
         {
+            virtual ~Statement() = default;
+
             virtual void accept(BaseVisitorForStatement* visitor) = 0;
         };
         /**********************************************************************************************************************8*/
@@ -45,6 +51,13 @@ namespace lang
         struct AssignmentExpression;
         struct LogicalExpression;
         struct CallExpression;
+        struct ArrayExpression;
+        struct IndexExpression;
+        struct IndexAssignmentExpression;
+        struct GetExpression;
+        struct SetExpression;
+        struct ThisExpression;
+        struct SuperExpression;
 
         struct BaseVisitorForExpression
         {
@@ -56,13 +69,80 @@ namespace lang
             virtual lang::util::object_t visit(AssignmentExpression* expression) = 0;
             virtual lang::util::object_t visit(LogicalExpression* expression) = 0;
             virtual lang::util::object_t visit(CallExpression* expression) = 0;
+            virtual lang::util::object_t visit(ArrayExpression* expression) = 0;
+            virtual lang::util::object_t visit(IndexExpression* expression) = 0;
+            virtual lang::util::object_t visit(IndexAssignmentExpression* expression) = 0;
+            virtual lang::util::object_t visit(GetExpression* expression) = 0;
+            virtual lang::util::object_t visit(SetExpression* expression) = 0;
+            virtual lang::util::object_t visit(ThisExpression* expression) = 0;
+            virtual lang::util::object_t visit(SuperExpression* expression) = 0;
         };
 
         struct Expression
         {
+            virtual ~Expression() = default;
+
             virtual lang::util::object_t accept(BaseVisitorForExpression* visitor) = 0;
         };
 
+        /*
+            The inline cache of a property access, keyed on the hidden class (lang::util::LLShape) of the instance.
+
+            It holds up to ENTRIES shapes (monomorphic with one, polymorphic up to ENTRIES). A hit gives the
+            answer of the property lookup for that shape without touching any hash map. When a site sees more
+            shapes than that it becomes megamorphic and stops caching.
+
+            For a GetExpression an entry gives either the field position (slot) or the method found in the class.
+            For a SetExpression an entry gives the field position and the shape of the instance after the store
+            (next_shape differs from shape when the store adds the field).
+        */
+        struct InlineCache
+        {
+            static constexpr std::size_t ENTRIES = 4;
+
+            struct Entry
+            {
+                const lang::util::LLShape* shape = nullptr;
+                std::size_t slot{0};
+                lang::util::LLCallable* method = nullptr;
+                lang::util::LLShape* next_shape = nullptr;
+            };
+
+            std::array<Entry, ENTRIES> entries;
+            std::size_t size{0};
+            bool megamorphic{false};
+
+            const Entry* find(const lang::util::LLShape* shape) const
+            {
+                for(std::size_t i = 0; i < size; i++)
+                {
+                    if(entries[i].shape == shape)
+                    {
+                        return &entries[i];
+                    }
+                }
+
+                return nullptr;
+            }
+
+            /* It returns the cached copy of the entry, or the argument itself once the site is megamorphic */
+            const Entry* insert(const Entry& entry)
+            {
+                if(size == ENTRIES)
+                {
+                    megamorphic = true;
+                    m_megamorphic_entry = entry;
+                    return &m_megamorphic_entry;
+                }
+
+                entries[size] = entry;
+                return &entries[size++];
+            }
+
+            private:
+                Entry m_megamorphic_entry;
+        };
+
         /**********************************************************************************************************************8*/
         struct ExpressionStatement: public Statement
         {
@@ -110,6 +190,7 @@ namespace lang
         struct BlockStatement: public Statement
         {
             std::vector<Statement*> statements;
+            bool scope_escapes{true}; /* See FunctionStatement::frame_escapes */
 
             BlockStatement(std::vector<Statement*>&& statements)
                 : statements(std::move(statements))
@@ -139,11 +220,12 @@ namespace lang
 
         struct WhileStatement: public Statement
         {
+            lang::Token keyword; /* "while", or "for" for a desugared for loop */
             Expression* condition;
             Statement* body;
 
-            WhileStatement(Expression* condition, Statement* body)
-                : condition(condition), body(body)
+            WhileStatement(const lang::Token& keyword, Expression* condition, Statement* body)
+                : keyword(keyword), condition(condition), body(body)
             {}
 
             void accept(BaseVisitorForStatement* visitor) override
@@ -158,6 +240,31 @@ namespace lang
             std::vector<lang::Token> params;
             std::vector<Statement*> body_stmts;
 
+            /* A variable of an enclosing scope the function uses, see lang::util::LLCallable::upvalues */
+            struct Capture
+            {
+                std::string_view name;
+                int enclosing_index; /* -1: the variable "name" of the scope the function is declared in, otherwise this upvalue of the enclosing function */
+            };
+
+            /*
+                Set by lang::Resolver. A function that captures its environment closes over the whole scope it is
+                declared in and looks every variable up by name, like methods and functions that see variables
+                declared after them. The others only capture "captures".
+            */
+            bool captures_environment{true};
+            std::vector<Capture> captures;
+
+            /* Set by lang::Resolver: the global names the body and the functions in it use, see lang::tasks::ValueCloner */
+            std::vector<std::string_view> globals;
+
+            /*
+                Set by lang::Resolver: false if no function declared in the body captures its environment, then
+                nothing can refer to the environment of a call and it is taken from the interpreter's environment
+                stack (see FrameEnvironment)
+            */
+            bool frame_escapes{true};
+
             FunctionStatement(const lang::Token& name, std::vector<lang::Token>&& params, std::vector<Statement*>&& body_stmts)
                 : name(name), params(std::move(params)), body_stmts(std::move(body_stmts))
             {}
@@ -182,6 +289,50 @@ namespace lang
                 return visitor->visit(this);
             }
         };
+
+        /*
+            A counted "for" loop: for (var i = init; i < limit; i = i + step) body
+            (the comparison can be any of < <= > >= and the step can also be "i - step").
+
+            The interpreter keeps "i" in a C++ double for the comparison and the step and only stores it into
+            the loop's environment for the body. If "init" does not evaluate to a number, generic_loop
+            (the while loop the parser would have produced otherwise) runs instead.
+        */
+        struct NumericForStatement: public Statement
+        {
+            lang::Token name;
+            Expression* initializer;
+            lang::Token comparison;
+            Expression* limit;
+            double step;
+            Statement* body;
+            Statement* generic_loop;
+            bool scope_escapes{true}; /* of the loop's environment, see FunctionStatement::frame_escapes */
+
+            NumericForStatement(const lang::Token& name, Expression* initializer, const lang::Token& comparison, Expression* limit, double step, Statement* body, Statement* generic_loop)
+                : name(name), initializer(initializer), comparison(comparison), limit(limit), step(step), body(body), generic_loop(generic_loop)
+            {}
+
+            void accept(BaseVisitorForStatement* visitor) override
+            {
+                return visitor->visit(this);
+            }
+        };
+        struct ClassStatement: public Statement
+        {
+            lang::Token name;
+            VariableExpression* superclass;
+            std::vector<FunctionStatement*> methods;
+
+            ClassStatement(const lang::Token& name, VariableExpression* superclass, std::vector<FunctionStatement*>&& methods)
+                : name(name), superclass(superclass), methods(std::move(methods))
+            {}
+
+            void accept(BaseVisitorForStatement* visitor) override
+            {
+                return visitor->visit(this);
+            }
+        };
         /**********************************************************************************************************************8*/
 
 
@@ -247,6 +398,8 @@ namespace lang
         struct VariableExpression: public Expression
         {
             lang::Token name;
+            int upvalue_index{-1}; /* Set by lang::Resolver for a captured variable, the position in the running function's LLCallable::upvalues */
+            int global_slot{-1}; /* Set by lang::Resolver for a global variable, its symbol id (see lang::env::SymbolTable) */
 
             VariableExpression(const lang::Token& name)
                 : name(name)
@@ -262,6 +415,8 @@ namespace lang
         {
             lang::Token name;
             Expression* value;
+            int upvalue_index{-1}; /* See VariableExpression::upvalue_index */
+            int global_slot{-1}; /* See VariableExpression::global_slot */
 
 
             AssignmentExpression(const lang::Token& name, Expression* value)
@@ -297,6 +452,9 @@ namespace lang
             lang::Token closing_paren;
             std::vector<Expression*> arguments;
 
+            /* Set by the parser when the callee is "object.name" or "super.name", a method is then called without binding it */
+            GetExpression* get_callee = nullptr;
+            SuperExpression* super_callee = nullptr;
 
             CallExpression(Expression* callee, const lang::Token& closing_paren, std::vector<Expression*>&& arguments)
                 : callee(callee), closing_paren(closing_paren), arguments(std::move(arguments))
@@ -307,5 +465,122 @@ namespace lang
                 return visitor->visit(this);
             }
         };
+
+        struct ArrayExpression: public Expression
+        {
+            lang::Token closing_bracket;
+            std::vector<Expression*> elements;
+
+
+            ArrayExpression(const lang::Token& closing_bracket, std::vector<Expression*>&& elements)
+                : closing_bracket(closing_bracket), elements(std::move(elements))
+            {}
+
+            lang::util::object_t accept(BaseVisitorForExpression* visitor) override
+            {
+                return visitor->visit(this);
+            }
+        };
+
+        struct IndexExpression: public Expression
+        {
+            Expression* object;
+            lang::Token closing_bracket;
+            Expression* index;
+
+
+            IndexExpression(Expression* object, const lang::Token& closing_bracket, Expression* index)
+                : object(object), closing_bracket(closing_bracket), index(index)
+            {}
+
+            lang::util::object_t accept(BaseVisitorForExpression* visitor) override
+            {
+                return visitor->visit(this);
+            }
+        };
+
+        struct IndexAssignmentExpression: public Expression
+        {
+            Expression* object;
+            lang::Token closing_bracket;
+            Expression* index;
+            Expression* value;
+
+
+            IndexAssignmentExpression(Expression* object, const lang::Token& closing_bracket, Expression* index, Expression* value)
+                : object(object), closing_bracket(closing_bracket), index(index), value(value)
+            {}
+
+            lang::util::object_t accept(BaseVisitorForExpression* visitor) override
+            {
+                return visitor->visit(this);
+            }
+        };
+
+        struct GetExpression: public Expression
+        {
+            Expression* object;
+            lang::Token name;
+            std::size_t cache_index; /* The position of this site's InlineCache in the interpreter, see Parser::inline_cache_count */
+
+
+            GetExpression(Expression* object, const lang::Token& name, std::size_t cache_index)
+                : object(object), name(name), cache_index(cache_index)
+            {}
+
+            lang::util::object_t accept(BaseVisitorForExpression* visitor) override
+            {
+                return visitor->visit(this);
+            }
+        };
+
+        struct SetExpression: public Expression
+        {
+            Expression* object;
+            lang::Token name;
+            Expression* value;
+            std::size_t cache_index; /* The position of this site's InlineCache in the interpreter, see Parser::inline_cache_count */
+
+
+            SetExpression(Expression* object, const lang::Token& name, Expression* value, std::size_t cache_index)
+                : object(object), name(name), value(value), cache_index(cache_index)
+            {}
+
+            lang::util::object_t accept(BaseVisitorForExpression* visitor) override
+            {
+                return visitor->visit(this);
+            }
+        };
+
+        struct ThisExpression: public Expression
+        {
+            lang::Token keyword;
+
+
+            ThisExpression(const lang::Token& keyword)
+                : keyword(keyword)
+            {}
+
+            lang::util::object_t accept(BaseVisitorForExpression* visitor) override
+            {
+                return visitor->visit(this);
+            }
+        };
+
+        struct SuperExpression: public Expression
+        {
+            lang::Token keyword;
+            lang::Token method;
+
+
+            SuperExpression(const lang::Token& keyword, const lang::Token& method)
+                : keyword(keyword), method(method)
+            {}
+
+            lang::util::object_t accept(BaseVisitorForExpression* visitor) override
+            {
+                return visitor->visit(this);
+            }
+        };
     }
 }
\ No newline at end of file
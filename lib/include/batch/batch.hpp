@@ -0,0 +1,58 @@
+#pragma once
+
+#include <isolate/isolate.hpp>
+
+#include <future>
+#include <mutex>
+#include <unordered_map>
+
+namespace lang
+{
+    /*
+        Batch mode: many scripts run in one process on a pool of worker threads, every worker with its own Isolate.
+        The output of every script is collected separately and reported in the order of the scripts, whatever
+        the order they ran in.
+    */
+    namespace batch
+    {
+        /*
+            Compiled programs by the content of their source: byte identical scripts are lexed and parsed once,
+            even when several workers ask for them at the same time.
+        */
+        class ProgramCache
+        {
+            public:
+                std::shared_ptr<const CompiledProgram> get(std::string source);
+
+                /* The number of sources actually compiled */
+                std::size_t compilations() const;
+
+            private:
+                /* FNV-1a, the sources of a bucket are compared to rule out collisions */
+                static std::uint64_t content_hash(std::string_view source);
+
+            private:
+                mutable std::mutex m_mutex;
+
+                std::unordered_map<std::uint64_t, std::vector<std::shared_future<std::shared_ptr<const CompiledProgram>>>> m_programs;
+
+                std::size_t m_compilations{0};
+        };
+
+        struct ScriptReport
+        {
+            std::string path;
+            std::string output; /* What the script printed followed by its errors, as the single file mode shows them */
+            bool succeeded{false};
+        };
+
+        /*
+            The scripts of a directory (its .ll files, sorted by path) or of a list file (one path per line,
+            relative paths are relative to the list's directory).
+        */
+        std::vector<std::string> collect_scripts(const std::string& directory_or_list);
+
+        /* The reports are in the order of the paths, every script runs with the limits */
+        std::vector<ScriptReport> run(const std::vector<std::string>& paths, std::size_t thread_count, ProgramCache& cache, const lang::ExecutionLimits& limits = {});
+    }
+}
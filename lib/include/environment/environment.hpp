@@ -2,27 +2,130 @@
 
 #include <types/types.hpp>
 #include <token/token.hpp>
+#include <memory/memory.hpp>
+
+#include <deque>
 
 namespace lang
 {
     namespace env
     {
+        /*
+            The ids of the global variable names of a program, the positions of their slots in the global
+            environment. Every program has its own table, a program that runs in the global environment of another
+            one (a script after its snapshot prelude) is parsed with a copy of the table of that one, so they agree
+            on the ids of the names they share. Only the parser adds names, see lang::Resolver.
+        */
+        class SymbolTable
+        {
+            public:
+                /* The id of "name", a new one the first time */
+                std::size_t id(std::string_view name);
+
+                std::size_t size() const;
+
+            private:
+                std::unordered_map<std::string, std::size_t, lang::util::string_hash, std::equal_to<>> m_ids;
+        };
+
+        /* The upvalues are counted as lang::memory::Subsystem::ENVIRONMENTS, like the variables they point to */
+        using upvalue_allocator_t = lang::memory::Allocator<lang::util::Upvalue, lang::memory::Subsystem::ENVIRONMENTS>;
+
         class Environment
         {
             public:
+                using values_t = std::unordered_map<std::string, lang::util::object_t, lang::util::string_hash, std::equal_to<>,
+                    lang::memory::Allocator<std::pair<const std::string, lang::util::object_t>, lang::memory::Subsystem::ENVIRONMENTS>>;
 
                 Environment(Environment* enclosing);
 
                 ~Environment();
 
+                /* They are counted as lang::memory::Subsystem::ENVIRONMENTS */
+                static void* operator new(std::size_t size);
+
+                static void operator delete(void* memory);
+
                 lang::util::object_t get(const lang::Token& name);
                 
-                void define(const std::string& name, const lang::util::object_t& value);
+                void define(std::string_view name, const lang::util::object_t& value);
 
                 void assign(const lang::Token& name, const lang::util::object_t& value);
+
+                /* It returns the storage of a variable defined in this environment (not the enclosing ones) or nullptr. The pointer stays valid while the variable exists */
+                lang::util::object_t* find_local(std::string_view name);
+
+                /* The variables defined in this environment and the enclosing environment (nullptr for the outermost one) */
+                const values_t& values() const;
+
+                Environment* enclosing() const;
+
+                /* The global environment of the run it belongs to: the outermost one inside the builtins */
+                Environment* global_environment();
+
+                /*
+                    The global variable with the symbol id "slot" as seen from this environment, nullptr until
+                    bind_global() found it. The global environment keeps a pointer to the variable per symbol id,
+                    so this is one indexed load after the first lookup.
+                */
+                lang::util::object_t* global_variable(std::size_t slot) const
+                {
+                    const auto& slots = m_global->m_slots;
+                    return slot < slots.size() ? slots[slot] : nullptr;
+                }
+
+                /*
+                    It looks "name" up in the global environment and the builtins and binds the slot to it, nullptr
+                    if it is not defined. Defining a new global variable unbinds all the slots, it can hide a builtin.
+                */
+                lang::util::object_t* bind_global(std::size_t slot, std::string_view name);
+
+                /* The name of the variable stored at "variable" (see find_local), empty if it is not one of this environment */
+                std::string_view name_of(const lang::util::object_t* variable) const;
+
+                /* It belongs to an EnvironmentStack */
+                bool is_pooled() const;
+
+                /* It forgets its variables and gets a new enclosing environment, for reuse by EnvironmentStack */
+                void reset(Environment* enclosing);
             private:
-                std::unordered_map<std::string, lang::util::object_t> m_values;
+                friend class EnvironmentStack;
+
+                values_t m_values;
                 Environment* m_enclosing = nullptr;
+                bool m_pooled{false};
+
+                /* The global environment of the chain (nullptr for the builtins), it has the slots */
+                Environment* m_global = nullptr;
+
+                /* Indexed by symbol id, empty for the environments that are not global ones */
+                std::vector<lang::util::object_t*> m_slots;
+        };
+
+        /*
+            The environments of the call frames and block scopes that nothing can capture (see
+            lang::ast::FunctionStatement::frame_escapes). They are taken and given back in LIFO order and reused,
+            a std::deque keeps them in contiguous blocks that never move.
+        */
+        class EnvironmentStack
+        {
+            public:
+                Environment* push(Environment* enclosing);
+
+                /* The variables of the top environment are released now, its upvalues are closed first */
+                void pop();
+
+                std::size_t depth() const;
+
+                /* The upvalue of a variable of one of its environments, the closures that capture the variable share it until it is closed */
+                std::shared_ptr<lang::util::Upvalue> capture(Environment* environment, lang::util::object_t* variable);
+
+            private:
+                std::deque<Environment, lang::memory::Allocator<Environment, lang::memory::Subsystem::ENVIRONMENTS>> m_environments;
+                std::size_t m_depth{0};
+
+                /* The upvalues of the environments that are still on the stack */
+                std::vector<std::shared_ptr<lang::util::Upvalue>> m_open_upvalues;
         };
     }
 }
\ No newline at end of file
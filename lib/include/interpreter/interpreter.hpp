@@ -3,30 +3,203 @@
 #include <types/types.hpp>
 #include <ast/ast.hpp>
 #include <environment/environment.hpp>
+#include <native/native.hpp>
+#include <output/output.hpp>
+#include <profiler/profiler.hpp>
+#include <profiler/line_profiler.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <limits>
 
 namespace lang
 {
+    namespace tasks
+    {
+        class Scheduler;
+        struct Task;
+    }
+
+    /* Values defined in the global environment before a program runs */
+    using globals_t = std::vector<std::pair<std::string, lang::util::object_t>>;
+
+    /*
+        The limits of one run. A step is a loop iteration or a call of a script function, so a run that never
+        stops uses up its steps. When a limit is reached the run stops with an error that says where it was.
+    */
+    struct ExecutionLimits
+    {
+        std::uint64_t max_steps = 0;            /* 0 is no limit */
+        std::chrono::milliseconds timeout{0};   /* wall clock time from the start of the run, 0 is no limit */
+    };
+
     class Interpreter: public lang::ast::BaseVisitorForExpression, public lang::ast::BaseVisitorForStatement
     {
         public:
-            Interpreter(){}
+            Interpreter();
+
+            ~Interpreter();
+
+            /*
+                It runs a program in a fresh global environment, the globals are defined in it before the first statement.
+                The natives live in an enclosing builtins environment that is created once, together with the interpreter.
+                Everything the previous run created (environments, functions, classes, instances) is released first,
+                so the values returned by get_global() are valid until the next call.
+            */
+            std::vector<std::string> interpret(const std::vector<lang::ast::Statement*>& statements, std::size_t inline_cache_count, const lang::globals_t& globals = {});
+
+            /* It runs the statements in the current run, which begin_run() started (see lang::snapshot) */
+            std::vector<std::string> continue_run(const std::vector<lang::ast::Statement*>& statements);
+
+            void execute_block(const std::vector<lang::ast::Statement*>& stmts, lang::env::Environment* env);
+
+            /*
+                It starts a run that is driven from C++ (a spawned task calls one function) instead of a list of statements:
+                the previous run is released and the inline caches are sized for the program of the function.
+            */
+            void begin_run(std::size_t inline_cache_count);
+
+            /* Its steps are settled, the tasks it did not join are cancelled and waited for and the output is flushed */
+            void end_run();
+
+            /* Everything the last run created is freed now, for an interpreter that is kept idle (see lang::tasks::Scheduler) */
+            void release_run();
+
+            /* The number of inline caches of the program being run */
+            std::size_t inline_cache_count() const;
+
+            /* The errors of the current run */
+            const std::vector<std::string>& errors() const;
+
+            lang::env::Environment* builtins();
+
+            /* The global environment of the current run */
+            lang::env::Environment* globals();
+
+            /* The interpreter owns the callable until the end of the run */
+            void adopt_callable(lang::util::LLCallable* callable);
+
+            void adopt_class(lang::util::LLClass* klass);
+
+            /* The scheduler of spawn()/join(), lang::tasks::Scheduler::shared() unless one is set */
+            lang::tasks::Scheduler& scheduler();
+
+            void set_scheduler(lang::tasks::Scheduler* scheduler);
+
+            /*
+                The owners of the programs the run executes (see lang::CompiledProgram). The tasks it spawns share
+                them, so the AST they run outlives the caller's handle on the program.
+            */
+            void set_programs(std::vector<std::shared_ptr<const void>> programs);
+
+            const std::vector<std::shared_ptr<const void>>& programs() const;
+
+            /*
+                The handle of a task spawned by the run. Handles are per interpreter: only the interpreter that
+                spawned a task can join it. The tasks that are not joined are cancelled at the end of the run.
+            */
+            std::uint64_t adopt_task(std::shared_ptr<lang::tasks::Task> task);
+
+            /* The task of the handle, which is forgotten, or nullptr if this interpreter has no such task */
+            std::shared_ptr<lang::tasks::Task> take_task(std::uint64_t handle);
+
+            /* The run stops with an error at its next step check, it can be called from any thread */
+            void cancel();
+
+            bool cancelled() const;
+
+            /* A global variable of the last run or nullptr */
+            const lang::util::object_t* get_global(std::string_view name);
 
-            ~Interpreter()
+            /* Where the print statements write, a StdoutSink by default. The sink is flushed at the end of every run */
+            void set_output(std::unique_ptr<lang::OutputSink> sink);
+
+            /* It forwards to a std::ostream the caller owns */
+            void set_output(std::ostream& out);
+
+            lang::OutputSink& output();
+
+            /* They apply from the next run on, spawned tasks and parallel workers run within the limits of their caller (see inherit_limits()) */
+            void set_limits(const lang::ExecutionLimits& limits);
+
+            const lang::ExecutionLimits& limits() const;
+
+            /*
+                For a spawned task or a parallel worker, after begin_run(): it runs within the caller's run. They
+                share one account of steps (every interpreter adds its steps at each check and draws what is left
+                from it) and the deadline, so spawning does not multiply the budget, joined or not. The child
+                checks the limits at its first step, when it starts to run.
+            */
+            void inherit_limits(const Interpreter& caller);
+
+            /* The steps of the run so far, with the ones of its tasks and workers that were settled */
+            std::uint64_t steps_taken() const;
+
+            /*
+                The steps taken since the last check go to the account of the run, and the limits are checked
+                at the next step: for a child run that ends, and for a caller that waited for its children.
+            */
+            void settle_steps();
+
+            /*
+                Called at every loop back-edge and function entry. It only decrements a counter, the limits
+                are checked when the counter reaches zero (see check_limits()).
+            */
+            void count_step(int line)
             {
-                for(auto const& func_pointer: m_temp_llcallables)
+                if(--m_steps_until_check <= 0)
                 {
-                    if(func_pointer != nullptr)
-                    {
-                        delete func_pointer;
-                    }
+                    this->check_limits(line);
                 }
             }
 
-            std::vector<std::string> interpret(std::vector<lang::ast::Statement*>&& statements);
+            /* The stack of a lang::profiler::Profiler, the script functions push their frames on it. None by default */
+            void set_shadow_stack(lang::profiler::ShadowStack* shadow_stack);
 
-            void execute_block(const std::vector<lang::ast::Statement*>& stmts, lang::env::Environment* env);
+            lang::profiler::ShadowStack* shadow_stack() const
+            {
+                return m_shadow_stack;
+            }
+
+            /* It counts every statement and expression, only in builds with the line profiler (see profiler/line_profiler.hpp). None by default */
+            void set_line_profiler(lang::profiler::LineProfiler* line_profiler);
+
+            /* A new environment owned by the interpreter until the end of the run */
+            lang::env::Environment* make_environment(lang::env::Environment* enclosing);
+
+            /* The environments that nothing can capture, see FrameEnvironment */
+            lang::env::EnvironmentStack& environment_stack()
+            {
+                return m_environment_stack;
+            }
+
+            using upvalues_t = std::vector<std::shared_ptr<lang::util::Upvalue>>;
+
+            /* The upvalues of the script function being run are "upvalues" from now on, it returns the previous ones (see CallUpvalues) */
+            const upvalues_t* exchange_upvalues(const upvalues_t* upvalues)
+            {
+                const upvalues_t* previous = m_upvalues;
+                m_upvalues = upvalues;
+                return previous;
+            }
+
+            /*
+                It defines "name" in the builtins environment as a native that calls the C++ function.
+                The arity and the argument checks come from the signature, see native/native.hpp.
+            */
+            template<typename R, typename... Args>
+            void register_native(std::string_view name, R (*function)(Args...))
+            {
+                this->define_native(name, sizeof...(Args), &lang::native::adapter<R, Args...>, reinterpret_cast<void (*)()>(function));
 
-            lang::env::Environment* get_environment();
+                m_builtin_llcallables.back()->flag_takes_callable = (std::is_same_v<std::decay_t<Args>, lang::util::LLCallable*> || ...);
+            }
+
+            /*
+                A native that gets the raw argument view (and its LLCallable, whose "interpreter" is the caller).
+                A variadic native accepts "arity" or more arguments.
+            */
+            void register_raw_native(std::string_view name, size_t arity, bool variadic, lang::util::LLCallable::native_fn_t call_fn);
 
         private:
             lang::util::object_t evaluate(lang::ast::Expression* expression);
@@ -49,6 +222,20 @@ namespace lang
             
             lang::util::object_t visit(lang::ast::CallExpression* expression) override;
 
+            lang::util::object_t visit(lang::ast::ArrayExpression* expression) override;
+
+            lang::util::object_t visit(lang::ast::IndexExpression* expression) override;
+
+            lang::util::object_t visit(lang::ast::IndexAssignmentExpression* expression) override;
+
+            lang::util::object_t visit(lang::ast::GetExpression* expression) override;
+
+            lang::util::object_t visit(lang::ast::SetExpression* expression) override;
+
+            lang::util::object_t visit(lang::ast::ThisExpression* expression) override;
+
+            lang::util::object_t visit(lang::ast::SuperExpression* expression) override;
+
             /*************************************************************************************************************/
 
             void visit(lang::ast::ExpressionStatement* statement) override;
@@ -67,9 +254,59 @@ namespace lang
 
             void visit(lang::ast::ReturnStatement* statement) override;
 
+            void visit(lang::ast::NumericForStatement* statement) override;
+
+            void visit(lang::ast::ClassStatement* statement) override;
+
+            /* The loop of a NumericForStatement, run with m_environment being the loop's environment */
+            void run_numeric_for(lang::ast::NumericForStatement* statement, lang::util::object_t* slot, double counter);
+
+            /* The upvalues of a new function, from the environments of the scope it is declared in and the upvalues of the running function */
+            void capture_upvalues(lang::util::LLCallable* function);
+
 
             /*************************************************************************************************************/
 
+            void define_native(std::string_view name, size_t arity, lang::util::LLCallable::native_fn_t call_fn, void (*native_target)());
+
+            /* It checks the object and index of an IndexExpression/IndexAssignmentExpression and returns the position into LLArray::values */
+            std::size_t array_position(const lang::util::object_t& object, const lang::util::object_t& index, int line);
+
+            /*
+                A new callable for the method whose closure has "this" defined as the instance. It lives until the
+                end of the run, a call of "object.name(...)" or "super.name(...)" uses call_method() instead.
+            */
+            lang::util::LLCallable* bind_method(lang::util::LLCallable* method, const std::shared_ptr<lang::util::LLInstance>& instance);
+
+            /*
+                A call of the method with "this" defined as the instance. The environment of "this" lives on the
+                environment stack for the call, unless a closure of the method can keep it (FunctionStatement::frame_escapes).
+            */
+            lang::util::object_t call_method(lang::util::LLCallable* method, const std::shared_ptr<lang::util::LLInstance>& instance, lang::util::Arguments arguments);
+
+            /* The value of the field, or null with "method" set to the method of the class, which is not bound */
+            lang::util::object_t get_property(lang::ast::GetExpression* expression, std::shared_ptr<lang::util::LLInstance>& instance, lang::util::LLCallable*& method);
+
+            /* The method of the superclass and the instance for a SuperExpression */
+            lang::util::LLCallable* find_super_method(lang::ast::SuperExpression* expression, std::shared_ptr<lang::util::LLInstance>& instance);
+
+            /* The slow path of a GetExpression: it finds the field or method for the shape and caches the answer */
+            const lang::ast::InlineCache::Entry* lookup_property(lang::ast::GetExpression* expression, lang::util::LLShape* shape);
+
+            /* It frees what the previous run created, after cancelling the tasks it did not join */
+            void release_run_state();
+
+            /* The tasks that were not joined are told to stop, it waits for them */
+            void cancel_tasks();
+
+            /* The step counter of count_step() for the part of the run until the next check */
+            void reload_step_counter();
+
+            /* It throws lang::util::execution_aborted if the budget or the deadline is used up */
+            void check_limits(int line);
+
+            lang::util::object_t call_class(lang::util::LLClass* klass, lang::util::Arguments arguments, int line);
+
             lang::util::object_t is_truthy(const lang::util::object_t& object);
 
             bool is_equal(const lang::util::object_t& object_A, const lang::util::object_t& object_B);
@@ -80,9 +317,111 @@ namespace lang
             std::vector<std::string> m_errors;
             lang::env::Environment* m_environment = nullptr;
 
+            /* The natives, it encloses the global environment of every run */
+            std::unique_ptr<lang::env::Environment> m_builtins{std::make_unique<lang::env::Environment>(nullptr)};
+            std::vector<lang::util::LLCallable*> m_builtin_llcallables;
+
+            lang::env::Environment* m_globals = nullptr;
+
+            std::unique_ptr<lang::OutputSink> m_output{std::make_unique<lang::StdoutSink>()};
+
+            /* The text of one print statement, reused so printing does not allocate */
+            std::string m_print_buffer;
+
+            lang::tasks::Scheduler* m_scheduler = nullptr;
+
+            std::vector<std::shared_ptr<const void>> m_programs;
+
+            /* The tasks spawned by the run that were not joined yet, by handle */
+            std::unordered_map<std::uint64_t, std::shared_ptr<lang::tasks::Task>> m_tasks;
+            std::uint64_t m_next_task_handle{1};
+
+            std::atomic<bool> m_cancelled{false};
+
+            /* The clock and the cancellation are checked once per DEADLINE_CHECK_STEPS steps */
+            static constexpr std::int64_t DEADLINE_CHECK_STEPS = 4096;
+
+            lang::ExecutionLimits m_limits;
+            std::int64_t m_steps_until_check{std::numeric_limits<std::int64_t>::max()};
+            std::int64_t m_steps_between_checks{std::numeric_limits<std::int64_t>::max()};
+            /* The steps of the run up to the last check of each interpreter, shared with its tasks and workers */
+            std::shared_ptr<std::atomic<std::uint64_t>> m_steps_taken{std::make_shared<std::atomic<std::uint64_t>>(0)};
+            std::chrono::steady_clock::time_point m_deadline;
+
+            lang::profiler::ShadowStack* m_shadow_stack = nullptr;
+            lang::profiler::LineProfiler* m_line_profiler = nullptr;
+
+            /* One per property access site of the program being run, indexed by GetExpression/SetExpression::cache_index */
+            std::vector<lang::ast::InlineCache> m_inline_caches;
+
             std::vector<std::unique_ptr<lang::env::Environment>> m_temp_envs;
 
+            lang::env::EnvironmentStack m_environment_stack;
+
+            /* The upvalues of the script function being run, see lang::ast::VariableExpression::upvalue_index */
+            const upvalues_t* m_upvalues = nullptr;
+
             std::vector<lang::util::LLCallable*> m_temp_llcallables;
 
+            std::vector<lang::util::LLClass*> m_temp_llclasses;
+
+    };
+
+    /*
+        The environment of a call frame, a block or a loop for its lifetime. If the resolver found that it cannot
+        escape (no function declared in that scope captures its environment) it comes from the interpreter's
+        environment stack and is released when the scope ends, otherwise it is a heap environment kept until the
+        end of the run.
+    */
+    class FrameEnvironment
+    {
+        public:
+            FrameEnvironment(Interpreter& interpreter, lang::env::Environment* enclosing, bool escapes)
+                : m_stack(escapes ? nullptr : &interpreter.environment_stack()),
+                  m_environment(escapes ? interpreter.make_environment(enclosing) : m_stack->push(enclosing))
+            {}
+
+            ~FrameEnvironment()
+            {
+                if(m_stack != nullptr)
+                {
+                    m_stack->pop();
+                }
+            }
+
+            FrameEnvironment(const FrameEnvironment&) = delete;
+
+            FrameEnvironment& operator=(const FrameEnvironment&) = delete;
+
+            lang::env::Environment* get() const
+            {
+                return m_environment;
+            }
+
+        private:
+            lang::env::EnvironmentStack* m_stack;
+            lang::env::Environment* m_environment;
+    };
+
+    /* The upvalues of a function are the running ones for the lifetime of its call */
+    class CallUpvalues
+    {
+        public:
+            CallUpvalues(Interpreter& interpreter, const Interpreter::upvalues_t& upvalues)
+                : m_interpreter(interpreter), m_previous(interpreter.exchange_upvalues(&upvalues))
+            {}
+
+            ~CallUpvalues()
+            {
+                (void)m_interpreter.exchange_upvalues(m_previous);
+            }
+
+            CallUpvalues(const CallUpvalues&) = delete;
+
+            CallUpvalues& operator=(const CallUpvalues&) = delete;
+
+        private:
+            Interpreter& m_interpreter;
+            const Interpreter::upvalues_t* m_previous;
     };
 }
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <lang/lang.hpp>
+#include <thread_pool/thread_pool.hpp>
+
+#include <output/output.hpp>
+
+namespace lang
+{
+    /*
+        An independent instance of the runtime: its own interpreter (environments, functions, classes and the
+        values they hold) and its own output buffer. Nothing mutable is shared with other isolates, the only
+        shared objects are the immutable CompiledPrograms, so different threads can use different isolates at once.
+        One isolate must not be used by two threads at the same time.
+    */
+    class Isolate
+    {
+        public:
+            Isolate();
+
+            ExecutionResult execute(const CompiledProgram& program, const lang::globals_t& globals = {});
+
+            /* What the print statements wrote since the last call */
+            std::string take_output();
+
+            void set_limits(const lang::ExecutionLimits& limits);
+
+            /* A global variable of the last execution or nullptr, it is valid until the next execution */
+            const lang::util::object_t* get_global(std::string_view name);
+
+            template<typename R, typename... Args>
+            void register_native(std::string_view name, R (*function)(Args...))
+            {
+                m_runtime.register_native(name, function);
+            }
+
+        private:
+            /* Owned by the interpreter of m_runtime */
+            lang::MemorySink* m_output;
+
+            lang::Lang m_runtime;
+    };
+
+    struct Script
+    {
+        std::shared_ptr<const CompiledProgram> program;
+        lang::globals_t globals;
+    };
+
+    struct ScriptResult
+    {
+        std::vector<std::string> errors;
+        std::string output;
+    };
+
+    /* It executes independent scripts concurrently, every worker thread of the pool has its own Isolate */
+    class ScriptRunner
+    {
+        public:
+            explicit ScriptRunner(std::size_t thread_count = std::thread::hardware_concurrency());
+
+            /* The results are in the order of the scripts */
+            std::vector<ScriptResult> run(const std::vector<Script>& scripts);
+
+            std::size_t thread_count() const;
+
+        private:
+            lang::ThreadPool m_pool;
+
+            std::vector<std::unique_ptr<Isolate>> m_isolates;
+    };
+}
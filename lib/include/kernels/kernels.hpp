@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+
+namespace lang
+{
+    /*
+        Vectorized kernels behind the array natives (sum, dot, min, max, scale, add).
+        They work on raw contiguous doubles so that the interpreter is out of the loop entirely.
+    */
+    namespace kernels
+    {
+        double sum(const double* data, std::size_t size);
+
+        double dot(const double* a, const double* b, std::size_t size);
+
+        /* size must be greater than 0 */
+        double min(const double* data, std::size_t size);
+
+        /* size must be greater than 0 */
+        double max(const double* data, std::size_t size);
+
+        /* out[i] = data[i] * factor */
+        void scale(const double* data, double factor, double* out, std::size_t size);
+
+        /* out[i] = a[i] + b[i] */
+        void add(const double* a, const double* b, double* out, std::size_t size);
+    }
+}
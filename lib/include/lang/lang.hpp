@@ -7,21 +7,133 @@
 
 namespace lang
 {
-    class Lang
+    namespace snapshot
+    {
+        class Snapshot;
+    }
+
+    /*
+        The result of Lang::compile. It owns the source, the tokens and the AST.
+
+        The AST is never modified after parsing (per run state such as the inline caches lives in the Interpreter),
+        so one CompiledProgram can be executed any number of times and by interpreters on different threads at once.
+    */
+    class CompiledProgram: public std::enable_shared_from_this<CompiledProgram>
     {
         public:
-            void run_source_code(const char* absolute_path_of_source_code);
+            const std::vector<lang::ast::Statement*>& statements() const;
 
-        private:
+            std::size_t inline_cache_count() const;
+
+            /* The function declarations and methods, in source order */
+            const std::vector<lang::ast::FunctionStatement*>& functions() const;
 
-            void run(std::string&& source);
+            const std::vector<std::string>& tokenization_errors() const;
+
+            const std::vector<std::string>& parsing_errors() const;
+
+            const std::string& source() const;
+
+            /* A program can be executed only if it has statements and no errors */
+            bool ok() const;
 
         private:
-            /** First lexer will be created then parser and then interpreter */
+            friend class Lang;
+
+            /* The tokens and the AST keep views into the source owned by the lexer */
             std::unique_ptr<lang::Lexer> m_lexer{std::make_unique<lang::Lexer>()};
 
             std::unique_ptr<lang::Parser> m_parser{std::make_unique<lang::Parser>()};
 
+            std::vector<lang::ast::Statement*> m_statements;
+
+            std::vector<std::string> m_tokenization_errors;
+
+            std::vector<std::string> m_parsing_errors;
+
+            /* The program it was compiled after, the symbol ids of its global names extend the ones of that program */
+            std::shared_ptr<const CompiledProgram> m_previous;
+    };
+
+    struct ExecutionResult
+    {
+        std::vector<std::string> errors;
+
+        bool ok() const
+        {
+            return errors.empty();
+        }
+    };
+
+    /*
+        The embedding API:
+
+            auto program = lang::Lang::compile(source);    compile once, share the handle
+            lang::Lang runtime;                            one per thread, its interpreter is reused
+            runtime.set_output(buffer);                    capture print
+            runtime.execute(*program, {{"x", 2.0}});       inject globals
+            runtime.get_global("result");                  read them back
+    */
+    class Lang
+    {
+        public:
+            /* With a snapshot the file runs after its prelude, see lang::snapshot */
+            void run_source_code(const char* absolute_path_of_source_code, const lang::snapshot::Snapshot* snapshot = nullptr);
+
+            /* "previous" is the program this one runs after in the same global environment, see lang::Parser::parse */
+            static std::shared_ptr<const CompiledProgram> compile(std::string source, const CompiledProgram* previous = nullptr);
+
+            ExecutionResult execute(const CompiledProgram& program, const lang::globals_t& globals = {});
+
+            /*
+                It continues from the state the snapshot recorded: the globals of its prelude are restored instead
+                of running the prelude again. The program must come from Snapshot::compile of this snapshot, any
+                other one is rejected with an error.
+            */
+            ExecutionResult execute(const CompiledProgram& program, const lang::snapshot::Snapshot& snapshot, const lang::globals_t& globals = {});
+
+            /* A global variable of the last execution or nullptr, it is valid until the next execution */
+            const lang::util::object_t* get_global(std::string_view name);
+
+            /* Where the print statements write, a lang::StdoutSink by default, see output/output.hpp */
+            void set_output(std::unique_ptr<lang::OutputSink> sink);
+
+            void set_output(std::ostream& out);
+
+            /* The step budget and the deadline of every execution, none by default */
+            void set_limits(const lang::ExecutionLimits& limits);
+
+            /* See lang::profiler::Profiler */
+            void set_shadow_stack(lang::profiler::ShadowStack* shadow_stack);
+
+            /* See lang::profiler::LineProfiler */
+            void set_line_profiler(lang::profiler::LineProfiler* line_profiler);
+
+            /* The program of the last run_source_code() or nullptr */
+            const CompiledProgram* last_program() const;
+
+            /* The scheduler of spawn()/join(), lang::tasks::Scheduler::shared() by default */
+            void set_scheduler(lang::tasks::Scheduler* scheduler);
+
+            template<typename R, typename... Args>
+            void register_native(std::string_view name, R (*function)(Args...))
+            {
+                m_interpreter->register_native(name, function);
+            }
+
+            /* The errors reported the way the command line does, nothing is written if there are none */
+            static void write_compile_errors(const CompiledProgram& program, std::ostream& out);
+
+            static void write_execution_errors(const ExecutionResult& result, std::ostream& out);
+
+        private:
+
+            void run(std::string&& source, const lang::snapshot::Snapshot* snapshot);
+
+        private:
             std::unique_ptr<lang::Interpreter> m_interpreter{std::make_unique<lang::Interpreter>()};
+
+            /* The program of the last run_source_code(), its AST stays valid for what refers to it (globals, profiles) */
+            std::shared_ptr<const CompiledProgram> m_program;
     };
-}
\ No newline at end of file
+}
@@ -8,13 +8,28 @@ namespace lang
     class Lexer
     {
         public:
+            /*
+                The returned tokens hold views into the source buffer owned by this Lexer.
+                They stay valid until the next call of tokenize() or until the Lexer is destroyed.
+            */
             std::pair<std::vector<lang::Token>, std::vector<std::string>> tokenize(std::string&& source);
 
+            /* The source of the last tokenize() */
+            const std::string& source() const;
+
         private:
             void scan_token();
 
             void read_identifier();
 
+            /*
+                Keywords are recognized with a switch on the first (and sometimes the second) character
+                followed by a single comparison of the rest of the lexeme. No hashing and no std::string is needed.
+            */
+            static TokenType identifier_type(std::string_view text);
+
+            static TokenType check_keyword(std::string_view text, std::size_t start, std::string_view rest, TokenType type);
+
             /*
                 A number literal is a series of digits optionally followed by a . and one or more trailing digits :- 1234, 12.34
 
@@ -65,24 +80,5 @@ namespace lang
             std::vector<lang::Token> m_tokens;
 
             std::vector<std::string> m_errors;
-
-            std::unordered_map<std::string, TokenType> m_keywords = {
-                {"and", TokenType::AND},
-                {"class", TokenType::CLASS},
-                {"else", TokenType::ELSE},
-                {"false", TokenType::FALSE},
-                {"for", TokenType::FOR},
-                {"fun", TokenType::FUN},
-                {"if", TokenType::IF},
-                {"nil", TokenType::NIL},
-                {"or", TokenType::OR},
-                {"print", TokenType::PRINT},
-                {"return", TokenType::RETURN},
-                {"super", TokenType::SUPER},
-                {"this", TokenType::THIS},
-                {"true", TokenType::TRUE},
-                {"var", TokenType::VAR},
-                {"while", TokenType::WHILE}
-            };
     };
 }
\ No newline at end of file
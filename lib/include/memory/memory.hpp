@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <ostream>
+
+namespace lang
+{
+    /*
+        Heap accounting. The library counts the blocks it allocates with allocate(), which its own subsystems
+        use through class operator new and Allocator (the environments, the callables and classes, the string
+        payloads). It does not touch the global operator new/delete of the host.
+
+        The executable and bench/frontend_throughput also link lang_memory_hooks (lib/src/memory_hooks.cpp), which replaces
+        the global operator new/delete with allocate()/deallocate(): then every allocation is counted, for the
+        subsystem of the innermost Scope of the allocating thread (the tokens, the AST, ...).
+
+        The counters of allocations are per thread, so reading them never contends with other threads. Every
+        counted block carries a small header with its size and its subsystem. Once accounting is enabled the
+        current, peak and total bytes of each subsystem are kept as well, in counters shared by all threads.
+        The bytes are the ones requested, the headers are not counted.
+    */
+    namespace memory
+    {
+        struct AllocationCounters
+        {
+            std::uint64_t allocations{0};
+            std::uint64_t deallocations{0};
+            std::uint64_t allocated_bytes{0};
+        };
+
+        /* The counters of the calling thread since it started, of every allocation with lang_memory_hooks */
+        AllocationCounters thread_counters();
+
+        enum class Subsystem: std::uint8_t
+        {
+            OTHER,          /* anything outside a Scope: arrays, maps, instances, the interpreter itself, ... */
+            TOKENS,         /* Lexer::tokenize */
+            AST,            /* Parser::parse */
+            ENVIRONMENTS,   /* lang::env::Environment and its variables */
+            CALLABLES,      /* functions, closures, bound methods and classes */
+            STRINGS,        /* the heap payloads of lang::util::LLString */
+            COUNT
+        };
+
+        const char* subsystem_name(Subsystem subsystem);
+
+        /* A block of "size" bytes for "subsystem", aligned like operator new, it throws std::bad_alloc */
+        void* allocate(std::size_t size, Subsystem subsystem);
+
+        /* A block of allocate(), null is ignored */
+        void deallocate(void* memory) noexcept;
+
+        /* The allocator of the standard containers of a subsystem, its blocks are counted like allocate() */
+        template<typename T, Subsystem SUBSYSTEM>
+        class Allocator
+        {
+            public:
+                using value_type = T;
+
+                template<typename U>
+                struct rebind
+                {
+                    using other = Allocator<U, SUBSYSTEM>;
+                };
+
+                Allocator() = default;
+
+                template<typename U>
+                Allocator(const Allocator<U, SUBSYSTEM>&) noexcept
+                {}
+
+                T* allocate(std::size_t count)
+                {
+                    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+
+                    if(count > std::numeric_limits<std::size_t>::max() / sizeof(T))
+                    {
+                        throw std::bad_array_new_length();
+                    }
+
+                    return static_cast<T*>(memory::allocate(count * sizeof(T), SUBSYSTEM));
+                }
+
+                void deallocate(T* block, std::size_t) noexcept
+                {
+                    memory::deallocate(block);
+                }
+
+                friend bool operator==(const Allocator&, const Allocator&)
+                {
+                    return true;
+                }
+        };
+
+        struct SubsystemStats
+        {
+            std::int64_t current_bytes{0};
+            std::int64_t peak_bytes{0};
+            std::uint64_t total_bytes{0};
+            std::uint64_t allocations{0};
+            std::uint64_t deallocations{0};
+        };
+
+        /*
+            It starts counting per subsystem, only the blocks allocated after the call are counted. It cannot be
+            turned off: enable it before the work to measure (the executable does for --mem-stats).
+        */
+        void enable_accounting();
+
+        bool accounting_enabled();
+
+        SubsystemStats stats(Subsystem subsystem);
+
+        /* All the subsystems together, its peak is the peak of the sum */
+        SubsystemStats total_stats();
+
+        /* The peaks start again from the current bytes, to measure the peak of one phase of the work */
+        void reset_peaks();
+
+        /* One line per subsystem and the total */
+        void write_report(std::ostream& out);
+
+        /* The subsystem of the allocations of the calling thread, for the global operator new of lang_memory_hooks */
+        constinit inline thread_local Subsystem tls_subsystem = Subsystem::OTHER;
+
+        /* The allocations of the calling thread are made for "subsystem" for its lifetime */
+        class Scope
+        {
+            public:
+                explicit Scope(Subsystem subsystem)
+                    : m_previous(tls_subsystem)
+                {
+                    tls_subsystem = subsystem;
+                }
+
+                ~Scope()
+                {
+                    tls_subsystem = m_previous;
+                }
+
+                Scope(const Scope&) = delete;
+
+                Scope& operator=(const Scope&) = delete;
+
+            private:
+                Subsystem m_previous;
+        };
+    }
+}
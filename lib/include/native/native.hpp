@@ -0,0 +1,204 @@
+#pragma once
+
+#include <types/types.hpp>
+
+#include <type_traits>
+#include <utility>
+#include <limits>
+#include <variant>
+#include <string>
+
+namespace lang
+{
+    /*
+        Compile time binding of plain C++ functions as natives of the language, see Interpreter::register_native.
+
+        For a function R f(Args...) the arity is sizeof...(Args) and adapter<R, Args...> is the LLCallable::call_fn.
+        It checks the type of every argument, converts them in place from the caller's argument storage
+        (no copies of strings/arrays/maps, no heap allocation) and converts the result back to an object_t.
+        A mismatch throws lang::util::native_error, which the interpreter reports with the line of the call.
+
+        Supported parameter types (by value or const reference):
+            double, bool, integral types (the number must be an integer in range), std::string_view,
+            any alternative of object_t (LLString, LLCallable*, std::shared_ptr<LLArray>, ...) and object_t itself.
+        Supported return types: void (gives nil), the same as the parameters, and anything object_t can be built from.
+    */
+    namespace native
+    {
+        template<typename T, typename Variant>
+        struct is_alternative_of;
+
+        template<typename T, typename... Alternatives>
+        struct is_alternative_of<T, std::variant<Alternatives...>> : std::bool_constant<(std::is_same_v<T, Alternatives> || ...)> {};
+
+        template<typename T, typename = void>
+        struct argument_traits;
+
+        /* Any alternative of object_t apart from double and bool, handed out by const reference */
+        template<typename T>
+        struct argument_traits<T, std::enable_if_t<is_alternative_of<T, lang::util::object_t>::value && !std::is_same_v<T, double> && !std::is_same_v<T, bool>>>
+        {
+            static bool matches(const lang::util::object_t& value)
+            {
+                return std::holds_alternative<T>(value);
+            }
+
+            static const T& get(lang::util::object_t& value)
+            {
+                return *std::get_if<T>(&value);
+            }
+        };
+
+        template<>
+        struct argument_traits<double>
+        {
+            static constexpr const char* name = "a number";
+
+            static bool matches(const lang::util::object_t& value)
+            {
+                return std::holds_alternative<double>(value);
+            }
+
+            static double get(lang::util::object_t& value)
+            {
+                return *std::get_if<double>(&value);
+            }
+        };
+
+        template<>
+        struct argument_traits<bool>
+        {
+            static constexpr const char* name = "a bool";
+
+            static bool matches(const lang::util::object_t& value)
+            {
+                return std::holds_alternative<bool>(value);
+            }
+
+            static bool get(lang::util::object_t& value)
+            {
+                return *std::get_if<bool>(&value);
+            }
+        };
+
+        template<typename T>
+        struct argument_traits<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
+        {
+            static constexpr const char* name = "an integer";
+
+            static bool matches(const lang::util::object_t& value)
+            {
+                auto* data = std::get_if<double>(&value);
+
+                return data != nullptr
+                    && *data >= static_cast<double>(std::numeric_limits<T>::min())
+                    && *data <= static_cast<double>(std::numeric_limits<T>::max())
+                    && *data == static_cast<double>(static_cast<T>(*data));
+            }
+
+            static T get(lang::util::object_t& value)
+            {
+                return static_cast<T>(*std::get_if<double>(&value));
+            }
+        };
+
+        template<>
+        struct argument_traits<std::string_view>
+        {
+            static constexpr const char* name = "a string";
+
+            static bool matches(const lang::util::object_t& value)
+            {
+                return std::holds_alternative<lang::util::LLString>(value);
+            }
+
+            static std::string_view get(lang::util::object_t& value)
+            {
+                return std::get_if<lang::util::LLString>(&value)->view();
+            }
+        };
+
+        template<>
+        struct argument_traits<lang::util::object_t>
+        {
+            static constexpr const char* name = "a value";
+
+            static bool matches(const lang::util::object_t&)
+            {
+                return true;
+            }
+
+            static lang::util::object_t& get(lang::util::object_t& value)
+            {
+                return value;
+            }
+        };
+
+        /* The name of a parameter type (with its article) used in error messages */
+        template<typename T>
+        constexpr const char* type_name()
+        {
+            if constexpr(std::is_same_v<T, lang::util::LLString>) { return "a string"; }
+            else if constexpr(std::is_same_v<T, lang::util::LLCallable*>) { return "a function"; }
+            else if constexpr(std::is_same_v<T, std::shared_ptr<lang::util::LLArray>>) { return "an array"; }
+            else if constexpr(std::is_same_v<T, std::shared_ptr<lang::util::LLMap>>) { return "a map"; }
+            else if constexpr(std::is_same_v<T, lang::util::LLClass*>) { return "a class"; }
+            else if constexpr(std::is_same_v<T, std::shared_ptr<lang::util::LLInstance>>) { return "an instance"; }
+            else if constexpr(std::is_same_v<T, lang::util::null_t>) { return "nil"; }
+            else { return argument_traits<T>::name; }
+        }
+
+        template<typename T>
+        void check_argument(const lang::util::LLCallable* callable, const lang::util::object_t& value, std::size_t position)
+        {
+            if(!argument_traits<T>::matches(value))
+            {
+                throw lang::util::native_error(callable->native_name + "() expects " + type_name<T>() + " as argument " + std::to_string(position + 1));
+            }
+        }
+
+        template<typename R>
+        lang::util::object_t to_object(R&& result)
+        {
+            using T = std::decay_t<R>;
+
+            if constexpr(std::is_integral_v<T> && !std::is_same_v<T, bool>)
+            {
+                return static_cast<double>(result);
+            }
+            else if constexpr(std::is_same_v<T, std::string_view> || std::is_same_v<T, std::string>)
+            {
+                return lang::util::LLString(result);
+            }
+            else
+            {
+                return lang::util::object_t(std::forward<R>(result));
+            }
+        }
+
+        template<typename R, typename... Args, std::size_t... I>
+        lang::util::object_t invoke(R (*function)(Args...), [[maybe_unused]] const lang::util::LLCallable* callable, [[maybe_unused]] lang::util::Arguments arguments, std::index_sequence<I...>)
+        {
+            /* Every argument is checked before any conversion happens */
+            (check_argument<std::decay_t<Args>>(callable, arguments[I], I), ...);
+
+            if constexpr(std::is_void_v<R>)
+            {
+                function(argument_traits<std::decay_t<Args>>::get(arguments[I])...);
+                return lang::util::null;
+            }
+            else
+            {
+                return to_object(function(argument_traits<std::decay_t<Args>>::get(arguments[I])...));
+            }
+        }
+
+        template<typename R, typename... Args>
+        lang::util::object_t adapter(const lang::util::LLCallable* callable, lang::util::Arguments arguments)
+        {
+            auto function = reinterpret_cast<R (*)(Args...)>(callable->native_target);
+
+            return invoke(function, callable, arguments, std::index_sequence_for<Args...>{});
+        }
+    }
+}
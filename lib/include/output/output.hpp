@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace lang
+{
+    /* When a buffered sink hands its buffer to the operating system */
+    enum class FlushPolicy
+    {
+        WHEN_FULL,  /* only when the buffer is full or flush() is called, the fastest */
+        EVERY_LINE  /* after every write that ends a line, for interactive use */
+    };
+
+    /*
+        Where the print statements of an interpreter write. Every interpreter owns one sink and flushes it
+        at the end of each run, a sink is used by one thread at a time.
+    */
+    class OutputSink
+    {
+        public:
+            virtual ~OutputSink() = default;
+
+            virtual void write(std::string_view text) = 0;
+
+            virtual void flush() = 0;
+    };
+
+    /* It collects the writes in its own buffer and hands them to a FILE* in large blocks */
+    class BufferedFileSink: public OutputSink
+    {
+        public:
+            static constexpr std::size_t DEFAULT_CAPACITY = 64 * 1024;
+
+            /* The file is not closed by the sink */
+            explicit BufferedFileSink(std::FILE* file, FlushPolicy policy = FlushPolicy::WHEN_FULL, std::size_t capacity = DEFAULT_CAPACITY);
+
+            ~BufferedFileSink() override;
+
+            void write(std::string_view text) override;
+
+            void flush() override;
+
+        protected:
+            std::FILE* m_file;
+
+        private:
+            FlushPolicy m_policy;
+            std::size_t m_capacity;
+            std::string m_buffer;
+    };
+
+    /* The default sink of an interpreter */
+    class StdoutSink: public BufferedFileSink
+    {
+        public:
+            explicit StdoutSink(FlushPolicy policy = FlushPolicy::WHEN_FULL);
+    };
+
+    /* It writes to a file it opens (and truncates) and closes */
+    class FileSink: public BufferedFileSink
+    {
+        public:
+            explicit FileSink(const std::string& path, FlushPolicy policy = FlushPolicy::WHEN_FULL);
+
+            ~FileSink() override;
+    };
+
+    /* It keeps everything in memory until take() */
+    class MemorySink: public OutputSink
+    {
+        public:
+            void write(std::string_view text) override;
+
+            void flush() override;
+
+            /* What was written since the last call */
+            std::string take();
+
+        private:
+            std::string m_text;
+    };
+
+    /* It forwards to a std::ostream the caller owns */
+    class StreamSink: public OutputSink
+    {
+        public:
+            explicit StreamSink(std::ostream& out);
+
+            void write(std::string_view text) override;
+
+            void flush() override;
+
+        private:
+            std::ostream& m_out;
+    };
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <interpreter/interpreter.hpp>
+#include <thread_pool/thread_pool.hpp>
+
+#include <unordered_set>
+
+namespace lang
+{
+    /*
+        Data parallel natives over an integer range:
+
+            parallel_map(fn, start, end)              [fn(start), fn(start + 1), ..., fn(end - 1)] as an array
+            parallel_reduce(fn, start, end)           fn(start) + fn(start + 1) + ... + fn(end - 1)
+            parallel_reduce(fn, start, end, combine)  the results folded with combine(a, b), from left to right
+
+        The range is split in chunks that the workers of pool() take one at a time. Every worker calls the
+        function in its own Interpreter, in an environment copied from the function's closure (see
+        lang::tasks::ValueCloner), so it only gives the same answer as a loop if the function is pure:
+        PurityChecker proves that before anything runs.
+    */
+    namespace parallel
+    {
+        /*
+            It checks that a function (and every global function it calls, transitively) does not print, does not
+            write a variable or an array it did not declare itself, does not use classes or instances, and only
+            calls natives without side effects and that take no function. Function values that cannot be resolved (parameters, results of
+            calls) are not allowed to be called.
+        */
+        class PurityChecker: public lang::ast::BaseVisitorForExpression, public lang::ast::BaseVisitorForStatement
+        {
+            public:
+                /* An empty string if the function is pure, otherwise the reason it is not */
+                static std::string check(lang::util::LLCallable* function);
+
+            private:
+                enum class LocalKind { VALUE, FUNCTION };
+
+                explicit PurityChecker(lang::util::LLCallable* function);
+
+                void check_function(lang::ast::FunctionStatement* function);
+
+                void declare(std::string_view name, LocalKind kind);
+
+                /* nullptr if the name is not declared inside the function being checked */
+                const LocalKind* find_local(std::string_view name) const;
+
+                /* A variable the function finds outside its body: one it captured or one of its closure, nullptr if there is none */
+                lang::util::object_t* find_variable(std::string_view name) const;
+
+                void check_call(lang::ast::CallExpression* expression);
+
+                void fail(std::string reason);
+
+                void visit_statements(const std::vector<lang::ast::Statement*>& statements);
+
+                /*************************************************************************************************************/
+                lang::util::object_t visit(lang::ast::BinaryExpression* expression) override;
+                lang::util::object_t visit(lang::ast::GroupingExpression* expression) override;
+                lang::util::object_t visit(lang::ast::LiteralExpression* expression) override;
+                lang::util::object_t visit(lang::ast::UnaryExpression* expression) override;
+                lang::util::object_t visit(lang::ast::VariableExpression* expression) override;
+                lang::util::object_t visit(lang::ast::AssignmentExpression* expression) override;
+                lang::util::object_t visit(lang::ast::LogicalExpression* expression) override;
+                lang::util::object_t visit(lang::ast::CallExpression* expression) override;
+                lang::util::object_t visit(lang::ast::ArrayExpression* expression) override;
+                lang::util::object_t visit(lang::ast::IndexExpression* expression) override;
+                lang::util::object_t visit(lang::ast::IndexAssignmentExpression* expression) override;
+                lang::util::object_t visit(lang::ast::GetExpression* expression) override;
+                lang::util::object_t visit(lang::ast::SetExpression* expression) override;
+                lang::util::object_t visit(lang::ast::ThisExpression* expression) override;
+                lang::util::object_t visit(lang::ast::SuperExpression* expression) override;
+
+                void visit(lang::ast::ExpressionStatement* statement) override;
+                void visit(lang::ast::PrintStatement* statement) override;
+                void visit(lang::ast::VarStatement* statement) override;
+                void visit(lang::ast::BlockStatement* statement) override;
+                void visit(lang::ast::IfStatement* statement) override;
+                void visit(lang::ast::WhileStatement* statement) override;
+                void visit(lang::ast::FunctionStatement* statement) override;
+                void visit(lang::ast::ReturnStatement* statement) override;
+                void visit(lang::ast::NumericForStatement* statement) override;
+                void visit(lang::ast::ClassStatement* statement) override;
+
+            private:
+                /* The function checked, the names that are not local are looked up in its upvalues and its closure */
+                lang::util::LLCallable* m_function = nullptr;
+
+                /* One scope per function being checked, the nested functions of the checked function see its locals */
+                std::vector<std::unordered_map<std::string_view, LocalKind>> m_scopes;
+
+                /* The global functions checked (or being checked, so recursion terminates), shared with the nested checkers */
+                std::unordered_set<const lang::ast::FunctionStatement*>* m_checked = nullptr;
+
+                std::string m_failure;
+        };
+
+        /* The pool of the parallel natives, one thread per hardware thread unless set_thread_count() was called */
+        lang::ThreadPool& pool();
+
+        /* It replaces the pool, it must not be called while a parallel native is running */
+        void set_thread_count(std::size_t thread_count);
+
+        /* parallel_map() and parallel_reduce() */
+        void register_natives(lang::Interpreter& interpreter);
+    }
+}
@@ -3,6 +3,7 @@
 #include <types/types.hpp>
 #include <token/token.hpp>
 #include <ast/ast.hpp>
+#include <environment/environment.hpp>
 
 namespace lang
 {
@@ -12,18 +13,38 @@ namespace lang
             Parser()
             {}
 
-            std::pair<std::vector<lang::ast::Statement*>, std::vector<std::string>> parse(std::vector<lang::Token>&& tokens);
+            /*
+                A program that runs in the same interpreter run after another one (see lang::snapshot) is parsed
+                with the inline_cache_count() and a copy of the symbols() of that one: its property access sites
+                are numbered after the ones of the other program and its global names get the same ids.
+            */
+            std::pair<std::vector<lang::ast::Statement*>, std::vector<std::string>> parse(std::vector<lang::Token>&& tokens, std::size_t first_inline_cache = 0, lang::env::SymbolTable symbols = {});
+
+            /* One past the number of the last property access site (GetExpression/SetExpression) of the last parse */
+            std::size_t inline_cache_count() const;
+
+            /* The function declarations and methods of the last parse, in source order */
+            const std::vector<lang::ast::FunctionStatement*>& functions() const;
+
+            /* The ids of the global names of the last parse, see lang::Resolver */
+            const lang::env::SymbolTable& symbols() const;
 
         private:
             lang::ast::Statement* parse_declaration();
 
             lang::ast::Statement* parse_var_declaration();
 
+            lang::ast::Statement* parse_class_declaration();
+
             lang::ast::Statement* parse_statement();
             lang::ast::Statement* parse_print_statement();
             lang::ast::Statement* parse_expression_statement();
             std::vector<lang::ast::Statement*> parse_block();
             lang::ast::Statement* parse_while_statement();
+            lang::ast::Statement* parse_for_statement();
+
+            /* It returns a NumericForStatement if the for loop has the counted shape, otherwise nullptr */
+            lang::ast::Statement* make_numeric_for_statement(lang::ast::Statement* initializer, lang::ast::Expression* condition, lang::ast::Expression* increment, lang::ast::Statement* body, lang::ast::Statement* generic_loop);
             lang::ast::Statement* parse_function_statement();
 
             lang::ast::Statement* parse_if_statement();
@@ -70,6 +91,13 @@ namespace lang
 
             lang::ast::Expression* finish_call(lang::ast::Expression* callee);
 
+            lang::ast::Expression* finish_index(lang::ast::Expression* object);
+
+            lang::ast::Expression* finish_array();
+
+            /* Equal string literals share one LLString buffer, so its cached hash is computed once for all of them */
+            const lang::util::LLString& intern_string(std::string_view contents);
+
         private:
             std::vector<lang::Token> m_tokens;
             int m_current{0};
@@ -81,5 +109,14 @@ namespace lang
 
             std::vector<lang::ast::Statement*> m_statements;
 
+            /* The keys are views into the source buffer of the tokens being parsed */
+            std::unordered_map<std::string_view, lang::util::LLString> m_interned_strings;
+
+            std::size_t m_inline_cache_count{0};
+
+            std::vector<lang::ast::FunctionStatement*> m_functions;
+
+            lang::env::SymbolTable m_symbols;
+
     };
 }
\ No newline at end of file
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace lang
+{
+    namespace ast
+    {
+        struct Statement;
+        struct Expression;
+    }
+
+    namespace profiler
+    {
+        /*
+            Exact execution counts of every statement and expression and the time spent on every source line
+            ($ ./main.out --profile=lines file). Interpreter::execute and Interpreter::evaluate report each node
+            they run, the lines come from the tokens of the AST when the report is written.
+
+            The hooks are only compiled with -DENABLE_LINE_PROFILER=ON (which defines LANG_LINE_PROFILER), in other
+            builds the macros below expand to nothing and the interpreter pays nothing. Like the sampling profiler
+            only the interpreter it is given to is profiled, spawned tasks and parallel workers are not.
+
+            The time of a line is self time: a statement is charged from its start to its end minus the statements
+            run inside it (a loop body, the body of a function it calls), which are charged to their own lines.
+        */
+        class LineProfiler
+        {
+            public:
+#ifdef LANG_LINE_PROFILER
+                static constexpr bool ENABLED = true;
+#else
+                static constexpr bool ENABLED = false;
+#endif
+
+                struct NodeCounters
+                {
+                    std::uint64_t count{0};
+                    std::chrono::nanoseconds self_time{0}; /* statements only */
+                };
+
+                void enter(const lang::ast::Statement* statement)
+                {
+                    auto now = std::chrono::steady_clock::now();
+                    this->charge(now);
+
+                    NodeCounters& counters = m_nodes[statement];
+                    counters.count++;
+                    m_running.push_back(&counters);
+                }
+
+                void leave()
+                {
+                    this->charge(std::chrono::steady_clock::now());
+                    m_running.pop_back();
+                }
+
+                void count(const lang::ast::Expression* expression)
+                {
+                    m_nodes[expression].count++;
+                }
+
+                /*
+                    The hottest lines with their source text, then the count of every node that ran, by line.
+                    The statements must be those of the program that was run (the nodes are found by walking them),
+                    the nodes of other programs (a snapshot prelude) are only summed up.
+                */
+                void write_report(std::ostream& out, const std::vector<lang::ast::Statement*>& statements, std::string_view source, const std::string& source_name) const;
+
+                void clear();
+
+            private:
+                void charge(std::chrono::steady_clock::time_point now)
+                {
+                    if(!m_running.empty())
+                    {
+                        m_running.back()->self_time += now - m_last_switch;
+                    }
+
+                    m_last_switch = now;
+                }
+
+            private:
+                std::unordered_map<const void*, NodeCounters> m_nodes;
+
+                /* The statements being executed, the innermost last (the references of an unordered_map are stable) */
+                std::vector<NodeCounters*> m_running;
+                std::chrono::steady_clock::time_point m_last_switch;
+        };
+
+        /* It charges a statement for its lifetime, nothing if there is no profiler */
+        class LineScope
+        {
+            public:
+                LineScope(LineProfiler* profiler, const lang::ast::Statement* statement)
+                    : m_profiler(profiler)
+                {
+                    if(m_profiler != nullptr)
+                    {
+                        m_profiler->enter(statement);
+                    }
+                }
+
+                ~LineScope()
+                {
+                    if(m_profiler != nullptr)
+                    {
+                        m_profiler->leave();
+                    }
+                }
+
+                LineScope(const LineScope&) = delete;
+
+                LineScope& operator=(const LineScope&) = delete;
+
+            private:
+                LineProfiler* m_profiler;
+        };
+    }
+}
+
+#ifdef LANG_LINE_PROFILER
+    #define LANG_PROFILE_STATEMENT(line_profiler, statement) lang::profiler::LineScope line_profiler_scope((line_profiler), (statement))
+    #define LANG_PROFILE_EXPRESSION(line_profiler, expression) if((line_profiler) != nullptr) (line_profiler)->count(expression)
+#else
+    #define LANG_PROFILE_STATEMENT(line_profiler, statement)
+    #define LANG_PROFILE_EXPRESSION(line_profiler, expression)
+#endif
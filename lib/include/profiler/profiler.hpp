@@ -0,0 +1,172 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace lang
+{
+    namespace ast
+    {
+        struct FunctionStatement;
+    }
+
+    /*
+        A sampling profiler for the functions of the script. The interpreter keeps a shadow stack of the
+        script functions being executed (LLCallable::call pushes and pops it), a timer sends SIGPROF to the
+        profiled thread every interval of its CPU time and the signal handler records its shadow stack. Only the
+        thread that called Profiler::start() is sampled, spawned tasks and parallel workers are not.
+
+        The handler does not allocate: identical stacks are counted in a fixed size hash table and the frames of
+        each distinct stack are stored once in a fixed size pool. Samples that do not fit are counted as dropped.
+    */
+    namespace profiler
+    {
+        class ShadowStack
+        {
+            public:
+                static constexpr std::size_t MAX_DEPTH = 256;
+
+                void push(const lang::ast::FunctionStatement* function)
+                {
+                    if(m_depth < MAX_DEPTH)
+                    {
+                        m_frames[m_depth] = function;
+                    }
+
+                    /* The signal handler runs on this thread, the frame must be stored before it is counted */
+                    std::atomic_signal_fence(std::memory_order_release);
+                    m_depth = m_depth + 1;
+                }
+
+                void pop()
+                {
+                    m_depth = m_depth - 1;
+                }
+
+                /* The number of frames a sample can see, deeper ones are cut */
+                std::size_t visible_depth() const
+                {
+                    std::size_t depth = m_depth;
+                    return (depth < MAX_DEPTH) ? depth : MAX_DEPTH;
+                }
+
+                const lang::ast::FunctionStatement* frame(std::size_t index) const
+                {
+                    return m_frames[index];
+                }
+
+            private:
+                const lang::ast::FunctionStatement* m_frames[MAX_DEPTH] = {};
+                volatile std::size_t m_depth{0};
+        };
+
+        /* It pushes a frame for its lifetime, nothing if there is no shadow stack */
+        class ShadowFrame
+        {
+            public:
+                ShadowFrame(ShadowStack* stack, const lang::ast::FunctionStatement* function)
+                    : m_stack(stack)
+                {
+                    if(m_stack != nullptr)
+                    {
+                        m_stack->push(function);
+                    }
+                }
+
+                ~ShadowFrame()
+                {
+                    if(m_stack != nullptr)
+                    {
+                        m_stack->pop();
+                    }
+                }
+
+                ShadowFrame(const ShadowFrame&) = delete;
+
+                ShadowFrame& operator=(const ShadowFrame&) = delete;
+
+            private:
+                ShadowStack* m_stack;
+        };
+
+        class Profiler
+        {
+            public:
+                /* source_name is shown with the line of every function */
+                explicit Profiler(std::string source_name, std::chrono::microseconds interval = std::chrono::microseconds(1000));
+
+                ~Profiler();
+
+                Profiler(const Profiler&) = delete;
+
+                Profiler& operator=(const Profiler&) = delete;
+
+                /* The stack to give to the interpreter being profiled (Interpreter::set_shadow_stack) */
+                ShadowStack& shadow_stack();
+
+                /* It starts sampling the calling thread, only one profiler can run at a time */
+                void start();
+
+                void stop();
+
+                /*
+                    One line per distinct stack, the outermost frame first and the number of samples last:
+                        <script>;main (main.ll:10);fib (main.ll:1) 42
+                    which is the input of flamegraph.pl and of most flame graph viewers.
+                    The programs that were profiled must still exist, the frames point into their AST.
+                */
+                void write_folded(std::ostream& out) const;
+
+                std::size_t samples() const;
+
+                std::size_t dropped_samples() const;
+
+            private:
+                static void handle_signal(int signal);
+
+                /* Called in the signal handler */
+                void record();
+
+            private:
+                static constexpr std::size_t TABLE_SIZE = 1 << 14;      /* distinct stacks, a power of 2 */
+                static constexpr std::size_t FRAME_POOL_SIZE = 1 << 20; /* frames of all the distinct stacks */
+
+                struct StackEntry
+                {
+                    std::uint64_t hash;
+                    std::uint32_t first_frame;  /* into m_frame_pool */
+                    std::uint32_t depth;
+                    std::uint64_t count;        /* 0 for an unused entry */
+                };
+
+                /* The entry has the frames of the shadow stack, whose depth it has */
+                bool same_frames(const StackEntry& entry) const;
+
+            private:
+                std::string m_source_name;
+                std::chrono::microseconds m_interval;
+
+                ShadowStack m_shadow_stack;
+
+                std::vector<StackEntry> m_table;
+                std::vector<const lang::ast::FunctionStatement*> m_frame_pool;
+                std::size_t m_frames_used{0};
+
+                /* Lock free, so the handler can update them on any thread */
+                std::atomic<std::size_t> m_samples{0};
+                std::atomic<std::size_t> m_dropped{0};
+
+                static_assert(std::atomic<std::size_t>::is_always_lock_free);
+
+                timer_t m_timer{};
+                bool m_running{false};
+        };
+    }
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <ast/ast.hpp>
+
+#include <deque>
+#include <unordered_set>
+
+namespace lang
+{
+    namespace env
+    {
+        class SymbolTable;
+    }
+
+    /*
+        The static analysis of a parsed program, Parser::parse runs it. It decides what every function closes
+        over and which environments can be taken from the interpreter's environment stack.
+
+        A function captures only the variables of the enclosing functions and blocks that its body (or a function
+        nested in it) uses, as upvalues shared with the other closures of the same variable: the function gets
+        FunctionStatement::captures and the VariableExpressions and AssignmentExpressions that use a captured
+        variable get its upvalue_index. The ones that use a global variable (or a builtin) get the symbol id of
+        its name as global_slot instead: the interpreter binds the slot to the variable the first time it is
+        read, so a function can still call a global function declared after it.
+
+        Names are resolved dynamically in this language, a closure sees a variable that its scope declares after
+        the closure was created (lang/source_file/main3.ll) and methods find "this" and "super" in their
+        environment. A function whose body relies on that captures its whole environment (captures_environment),
+        and so does every function between it and the scope of the variable. A scope in which such a function is
+        declared outlives its execution, the others live on the environment stack.
+    */
+    class Resolver: public lang::ast::BaseVisitorForExpression, public lang::ast::BaseVisitorForStatement
+    {
+        public:
+            /* The ids of the global names are taken from "symbols" */
+            explicit Resolver(lang::env::SymbolTable& symbols);
+
+            void resolve(const std::vector<lang::ast::Statement*>& statements);
+
+        private:
+            struct Function
+            {
+                lang::ast::FunctionStatement* statement; /* nullptr for the top level */
+                Function* enclosing;
+                bool captures_environment;
+
+                std::unordered_set<std::string_view> globals{}; /* FunctionStatement::globals */
+            };
+
+            struct Scope
+            {
+                Function* function;
+                bool* escapes; /* The flag of the statement that creates the environment, nullptr for the globals */
+
+                std::unordered_set<std::string_view> declared{};      /* up to the statement being resolved */
+                std::unordered_set<std::string_view> declarations{};  /* all of them */
+
+                /* The functions declared in it or in a block inside it, the environment escapes if one captures it */
+                std::vector<Function*> functions{};
+            };
+
+            /* A use of a variable of a scope of another function */
+            struct Reference
+            {
+                std::string_view name;
+                int* upvalue_index; /* nullptr for "this" and "super" */
+                Function* from;
+                Function* to; /* The function of the scope of the variable */
+                bool needs_environment; /* only a lookup by name can find the variable */
+            };
+
+            struct ScopeFunctions
+            {
+                bool* escapes;
+                std::vector<Function*> functions;
+            };
+
+            void begin_scope(bool* escapes, const std::vector<lang::ast::Statement*>& statements);
+
+            void end_scope();
+
+            void declare(std::string_view name);
+
+            void resolve_variable(const lang::Token& name, int* upvalue_index, int* global_slot);
+
+            /* The name can be a global variable, for the running function and the ones around it */
+            void use_global(std::string_view name);
+
+            /* "this" and "super" are found in the environment of the method */
+            void resolve_method_environment();
+
+            void resolve_function(lang::ast::FunctionStatement* statement, bool is_method);
+
+            void visit_statements(const std::vector<lang::ast::Statement*>& statements);
+
+            /* It marks the functions from "from" to the one declared in the scope of "to", it returns true if one was not marked */
+            static bool capture_environments(Function* from, Function* to);
+
+            /* The position of "name" in the captures of the function, it is added if needed */
+            static int capture_index(Function* function, std::string_view name, int enclosing_index);
+
+            /* Once everything is resolved: which functions capture their environment, the captures and the escaping scopes */
+            void bind();
+
+            /*************************************************************************************************************/
+            lang::util::object_t visit(lang::ast::BinaryExpression* expression) override;
+            lang::util::object_t visit(lang::ast::GroupingExpression* expression) override;
+            lang::util::object_t visit(lang::ast::LiteralExpression* expression) override;
+            lang::util::object_t visit(lang::ast::UnaryExpression* expression) override;
+            lang::util::object_t visit(lang::ast::VariableExpression* expression) override;
+            lang::util::object_t visit(lang::ast::AssignmentExpression* expression) override;
+            lang::util::object_t visit(lang::ast::LogicalExpression* expression) override;
+            lang::util::object_t visit(lang::ast::CallExpression* expression) override;
+            lang::util::object_t visit(lang::ast::ArrayExpression* expression) override;
+            lang::util::object_t visit(lang::ast::IndexExpression* expression) override;
+            lang::util::object_t visit(lang::ast::IndexAssignmentExpression* expression) override;
+            lang::util::object_t visit(lang::ast::GetExpression* expression) override;
+            lang::util::object_t visit(lang::ast::SetExpression* expression) override;
+            lang::util::object_t visit(lang::ast::ThisExpression* expression) override;
+            lang::util::object_t visit(lang::ast::SuperExpression* expression) override;
+
+            void visit(lang::ast::ExpressionStatement* statement) override;
+            void visit(lang::ast::PrintStatement* statement) override;
+            void visit(lang::ast::VarStatement* statement) override;
+            void visit(lang::ast::BlockStatement* statement) override;
+            void visit(lang::ast::IfStatement* statement) override;
+            void visit(lang::ast::WhileStatement* statement) override;
+            void visit(lang::ast::FunctionStatement* statement) override;
+            void visit(lang::ast::ReturnStatement* statement) override;
+            void visit(lang::ast::NumericForStatement* statement) override;
+            void visit(lang::ast::ClassStatement* statement) override;
+
+        private:
+            /* The top level first, the addresses must not change */
+            std::deque<Function> m_functions;
+            Function* m_function = nullptr;
+
+            /* The scopes around the statement being resolved, the global one first */
+            std::vector<Scope> m_scopes;
+
+            std::vector<ScopeFunctions> m_finished_scopes;
+
+            std::vector<Reference> m_references;
+
+            lang::env::SymbolTable& m_symbols;
+
+            /* The methods being resolved, the innermost last */
+            std::vector<Function*> m_methods;
+    };
+}
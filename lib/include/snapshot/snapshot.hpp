@@ -0,0 +1,59 @@
+#pragma once
+
+#include <lang/lang.hpp>
+
+namespace lang
+{
+    /*
+        Startup snapshots: a prelude (the fun/var/class declarations scripts begin with) runs once and the global
+        environment it leaves is written to a file. Later runs map the file in and restore the globals from it
+        instead of running the prelude again.
+
+        The file holds the source of the prelude and the graph of values reachable from its globals: numbers,
+        strings, arrays, maps, functions with their closure environments and upvalues, classes and instances. A
+        function is recorded as the position of its declaration among the prelude's FunctionStatements (see
+        Parser::functions) and loading parses the embedded source again to get the same AST, natives are recorded
+        by name.
+        Aliasing and cycles (a recursive function is in its own closure) are kept.
+
+        A snapshot is only valid for the build that wrote it.
+    */
+    namespace snapshot
+    {
+        /* It runs the prelude and writes its globals to "path". It returns the errors of the prelude, if any, and then nothing is written */
+        std::vector<std::string> create(std::string prelude_source, const std::string& path);
+
+        class Snapshot
+        {
+            public:
+                /* It maps the file in and parses the prelude, it throws std::runtime_error if the file is not a valid snapshot */
+                static std::shared_ptr<const Snapshot> load(const std::string& path);
+
+                ~Snapshot();
+
+                Snapshot(const Snapshot&) = delete;
+
+                Snapshot& operator=(const Snapshot&) = delete;
+
+                /* A program to run after the snapshot, its property access sites are numbered after the prelude's */
+                std::shared_ptr<const CompiledProgram> compile(std::string source) const;
+
+                /* It defines the globals of the prelude in the current run of the interpreter (after begin_run()) */
+                void restore(lang::Interpreter& interpreter) const;
+
+                const CompiledProgram& prelude() const;
+
+            private:
+                Snapshot() = default;
+
+            private:
+                const unsigned char* m_data = nullptr;
+                std::size_t m_size{0};
+
+                /* Where the value graph starts, after the embedded source */
+                std::size_t m_graph_offset{0};
+
+                std::shared_ptr<const CompiledProgram> m_prelude;
+        };
+    }
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <interpreter/interpreter.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace lang
+{
+    /*
+        Lightweight tasks for the language: spawn(fn, args...) returns a handle and join(handle) returns what fn returned.
+
+        Every task has its own Interpreter (so its own frames, environments and heap) and it only sees copies of the
+        values it was given: the arguments, the variables the function closes over and the globals it uses are
+        copied into it with a ValueCloner when it is spawned, the result is copied back when it is joined. Nothing
+        mutable is shared between tasks, so they run in parallel without any global lock. The interpreters of
+        finished tasks are kept by the Scheduler for the next ones.
+
+        A task runs to completion on one thread of the Scheduler. join() does not block a worker while the task
+        is pending: the joining thread runs other queued tasks in the meantime (its own deque first, then
+        stealing from the others), so any number of tasks can be multiplexed over a few threads.
+
+        The handles belong to the spawning interpreter (see Interpreter::adopt_task), a script cannot join the
+        tasks of another one. A task that is not joined is cancelled when the run that spawned it ends.
+    */
+    namespace tasks
+    {
+        /*
+            It copies values of one interpreter into another one (the target). Copies are deep for arrays and maps,
+            strings share their immutable buffer and functions are copied with their closure chain and their
+            upvalues (the natives map to the target's own builtins). Only the global variables the copied functions
+            use are copied (see FunctionStatement::globals), not the whole global environment. Aliasing inside one
+            ValueCloner is kept: the same array copied twice gives the same copy.
+            Classes, instances and methods cannot be copied.
+        */
+        class ValueCloner
+        {
+            public:
+                explicit ValueCloner(lang::Interpreter& target);
+
+                /* It returns false if the value (or something inside it) cannot be copied */
+                bool clone(const lang::util::object_t& value, lang::util::object_t& result);
+
+                /*
+                    The variables that cannot be copied are left out of the copy. The copy of a global environment
+                    starts empty, see clone_globals().
+                */
+                lang::env::Environment* clone_environment(lang::env::Environment* environment);
+
+            private:
+                /* The variables "names" of a global environment that were not copied yet */
+                void clone_globals(lang::env::Environment* global, const std::vector<std::string_view>& names);
+
+                bool clone_callable(lang::util::LLCallable* callable, lang::util::object_t& result);
+
+                /* nullptr if its value cannot be copied */
+                std::shared_ptr<lang::util::Upvalue> clone_upvalue(lang::util::Upvalue* upvalue);
+
+            private:
+                lang::Interpreter& m_target;
+
+                std::unordered_map<const void*, lang::util::object_t> m_copies;
+
+                std::unordered_map<lang::env::Environment*, lang::env::Environment*> m_environments;
+
+                std::unordered_map<const lang::util::Upvalue*, std::shared_ptr<lang::util::Upvalue>> m_upvalues;
+
+                /* The names of each global environment that were copied (or could not be) */
+                std::unordered_map<lang::env::Environment*, std::unordered_set<std::string_view>> m_globals;
+        };
+
+        class Scheduler;
+
+        struct Task
+        {
+            /* The programs of the spawner, declared first so they outlive the interpreter that runs their AST */
+            std::vector<std::shared_ptr<const void>> programs;
+
+            /* It gets the interpreter back when the task is destroyed */
+            Scheduler* scheduler = nullptr;
+            std::unique_ptr<lang::Interpreter> interpreter;
+
+            /* They belong to the task's interpreter */
+            lang::util::LLCallable* function = nullptr;
+            std::vector<lang::util::object_t> arguments;
+
+            lang::util::object_t result;
+            std::string failure; /* The first error of a failed task */
+
+            std::atomic<bool> done{false};
+
+            ~Task();
+
+            void run();
+        };
+
+        class Scheduler
+        {
+            public:
+                explicit Scheduler(std::size_t worker_count);
+
+                ~Scheduler();
+
+                Scheduler(const Scheduler&) = delete;
+                Scheduler& operator=(const Scheduler&) = delete;
+
+                /* The scheduler used by interpreters without their own, it has one worker per hardware thread */
+                static Scheduler& shared();
+
+                std::size_t worker_count() const;
+
+                void submit(std::shared_ptr<Task> task);
+
+                /* It waits for the task, running other tasks meanwhile */
+                void wait(Task& task);
+
+                /* An interpreter for a task, an idle one if there is one: a new one registers every builtin */
+                std::unique_ptr<lang::Interpreter> acquire_interpreter();
+
+                /* The interpreter of a task that is over, its run is released and it waits for the next task */
+                void release_interpreter(std::unique_ptr<lang::Interpreter> interpreter);
+
+            private:
+                struct Worker
+                {
+                    std::mutex mutex;
+                    std::deque<std::shared_ptr<Task>> deque;
+                };
+
+                static constexpr std::size_t NOT_A_WORKER = static_cast<std::size_t>(-1);
+
+                void worker_loop(std::size_t worker);
+
+                /* It runs one queued task, it returns false if there was none */
+                bool run_one(std::size_t worker);
+
+                /* The worker index of the calling thread in this scheduler or NOT_A_WORKER */
+                std::size_t current_worker() const;
+
+            private:
+                std::vector<std::unique_ptr<Worker>> m_workers;
+
+                /* The tasks spawned by threads that are not workers */
+                Worker m_injection;
+
+                std::vector<std::thread> m_threads;
+
+                std::atomic<std::size_t> m_queued{0};
+                std::mutex m_sleep_mutex;
+                std::condition_variable m_wakeup;
+                bool m_stop{false};
+
+                /* At most IDLE_INTERPRETERS_PER_WORKER per worker are kept */
+                static constexpr std::size_t IDLE_INTERPRETERS_PER_WORKER = 4;
+
+                std::mutex m_idle_mutex;
+                std::vector<std::unique_ptr<lang::Interpreter>> m_idle_interpreters;
+        };
+
+        /* spawn() and join() */
+        void register_natives(lang::Interpreter& interpreter);
+    }
+}
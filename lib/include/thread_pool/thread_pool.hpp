@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lang
+{
+    /*
+        A fixed set of worker threads that run data parallel loops.
+
+        parallel_for(count, task) calls task(worker, index) once for every index in [0, count): the workers take
+        the next index from a shared counter until none is left, so uneven tasks balance themselves. "worker" is
+        in [0, size()) and lets a task use per worker state (an Isolate, an accumulator) without locking.
+        The calling thread waits for the loop to finish, the first exception thrown by a task is rethrown to it.
+    */
+    class ThreadPool
+    {
+        public:
+            explicit ThreadPool(std::size_t thread_count);
+
+            ~ThreadPool();
+
+            ThreadPool(const ThreadPool&) = delete;
+            ThreadPool& operator=(const ThreadPool&) = delete;
+
+            std::size_t size() const;
+
+            void parallel_for(std::size_t count, const std::function<void(std::size_t worker, std::size_t index)>& task);
+
+        private:
+            void worker_loop(std::size_t worker);
+
+        private:
+            std::vector<std::thread> m_threads;
+
+            /* Only one loop runs at a time */
+            std::mutex m_loop_mutex;
+
+            std::mutex m_mutex;
+            std::condition_variable m_work_ready;
+            std::condition_variable m_work_done;
+
+            /* The loop being run, they are written under m_mutex before m_generation changes */
+            const std::function<void(std::size_t, std::size_t)>* m_task = nullptr;
+            std::size_t m_count{0};
+            std::atomic<std::size_t> m_next{0};
+
+            std::uint64_t m_generation{0};
+            std::size_t m_running{0};
+            bool m_stop{false};
+
+            std::exception_ptr m_exception;
+    };
+}
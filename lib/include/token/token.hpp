@@ -8,23 +8,26 @@ namespace lang
     struct Token
     {
         lang::TokenType m_type;
-        std::string m_lexeme; /* It stores the value represented by the Token. It is in std::string */
-        lang::util::object_t m_literal; /* It corresponds to the type casted value of m_lexeme. e.g "5" -> 5, "wiz" -> "wiz", "var" -> lang::util::null */
+        std::string_view m_lexeme; /* It is a view into the source buffer owned by the Lexer. No copy of the text is made */
+        lang::util::object_t m_literal; /* It corresponds to the type casted value of m_lexeme. e.g "5" -> 5, "var" -> lang::util::null. For STRING it stays lang::util::null, use string_contents() */
         int m_line;
 
-        Token(TokenType type, const std::string& lexeme, lang::util::object_t literal, int line)
+        Token(TokenType type, std::string_view lexeme, lang::util::object_t literal, int line)
             : m_type(type), m_lexeme(lexeme), m_literal(literal), m_line(line)
         {}
-    };
 
-    /* This anonymouse namespace solves the problem of multiple definitions of operator<< */
-    namespace
-    {
-        std::ostream& operator<<(std::ostream& o,const lang::Token& token)
+        /* For a STRING token it gives the characters between the quotes, still as a view into the source buffer */
+        std::string_view string_contents() const
         {
-            std::cout << lang::tokenType_map_to_string[token.m_type] << " '" << token.m_lexeme << "' ";
-            std::visit(lang::util::PrintVisitor{}, token.m_literal);
-            return o;
+            return m_lexeme.substr(1, m_lexeme.size() - 2);
         }
+    };
+
+    inline std::ostream& operator<<(std::ostream& o,const lang::Token& token)
+    {
+        o << lang::tokenType_map_to_string.at(token.m_type) << " '" << token.m_lexeme << "' ";
+        std::string literal;
+        std::visit(lang::util::PrintVisitor{literal}, token.m_literal);
+        return o << literal;
     }
 }
\ No newline at end of file
@@ -4,7 +4,10 @@
 #include <filesystem>
 #include <fstream>
 #include <string>
+#include <string_view>
+#include <charconv>
 #include <vector>
+#include <array>
 #include <variant>
 #include <unordered_map>
 #include <sstream>
@@ -12,6 +15,12 @@
 #include <iomanip>
 #include <algorithm>
 #include <functional>
+#include <memory>
+#include <atomic>
+#include <new>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
 
 namespace lang
 {
@@ -34,26 +43,214 @@ namespace lang
         };
 
         struct LLCallable;
+        struct LLArray;
+        struct LLMap;
+        struct LLClass;
+        struct LLInstance;
 
-        /* This anonymouse namespace solves the problem of multiple definitions of null_t */
-        namespace
+        /* Lets std::string keyed maps be searched with a std::string_view (e.g Token::m_lexeme) without building a std::string */
+        struct string_hash
         {
-            using null_t = lang::util::MYTYPE;
-            null_t null = MYTYPE::NIL;
+            using is_transparent = void;
 
-            using object_t = std::variant<double, null_t, std::string, bool, lang::util::LLCallable*>;
-        }
+            std::size_t operator()(std::string_view text) const
+            {
+                return std::hash<std::string_view>{}(text);
+            }
+        };
+
+        /*
+            The language's string value. It is immutable and cheap to copy no matter how long it is.
+
+            Up to INLINE_CAPACITY characters are stored inline in the value itself. Longer strings live in a
+            shared heap buffer with an atomic reference count, and the value is the prefix of m_size characters
+            of that buffer. Copying a value copies a pointer and bumps the count.
+
+            A buffer only ever grows at its end. When the left operand of "+" ends exactly where its buffer ends
+            and the buffer has room, the right operand is appended in place and the result shares the buffer. Values
+            that already exist only see their own prefix, so they never change. This keeps the usual
+            "s = s + piece;" loop amortized linear.
+
+            The hash of a value that spans the whole initial contents of its buffer (e.g. interned string
+            literals and map keys) is computed once and cached in the buffer.
+        */
+        class LLString
+        {
+            public:
+                static constexpr std::size_t INLINE_CAPACITY = 16;
+
+                LLString();
+
+                explicit LLString(std::string_view text);
+
+                LLString(const LLString& other);
+
+                LLString(LLString&& other) noexcept;
+
+                LLString& operator=(const LLString& other);
+
+                LLString& operator=(LLString&& other) noexcept;
+
+                ~LLString();
+
+                std::string_view view() const
+                {
+                    return std::string_view(this->is_inline() ? m_inline : this->heap_data(), m_size);
+                }
+
+                std::size_t size() const
+                {
+                    return m_size;
+                }
+
+                std::uint64_t hash() const;
+
+                /* It returns a value with its own exactly sized buffer, so it does not keep a large shared buffer alive */
+                LLString compacted() const;
+
+                static LLString concatenate(const LLString& left, std::string_view right);
+
+                bool operator==(const LLString& other) const
+                {
+                    return this->view() == other.view();
+                }
+
+            private:
+                struct Buffer;
+
+                bool is_inline() const
+                {
+                    return m_size <= INLINE_CAPACITY;
+                }
+
+                const char* heap_data() const;
+
+                void release();
+
+                union
+                {
+                    char m_inline[INLINE_CAPACITY];
+                    Buffer* m_buffer;
+                };
+                std::size_t m_size{0};
+        };
+
+        using null_t = lang::util::MYTYPE;
+
+        /* One immutable definition shared by every translation unit (and thread) */
+        inline constexpr null_t null = MYTYPE::NIL;
+
+        using object_t = std::variant<double, null_t, lang::util::LLString, bool, lang::util::LLCallable*, std::shared_ptr<lang::util::LLArray>, std::shared_ptr<lang::util::LLMap>, lang::util::LLClass*, std::shared_ptr<lang::util::LLInstance>>;
+
+        /* A non owning view of the evaluated arguments of a call, they live in the caller's ArgumentBuffer */
+        struct Arguments
+        {
+            lang::util::object_t* data = nullptr;
+            std::size_t size{0};
+
+            lang::util::object_t& operator[](std::size_t index) const
+            {
+                return data[index];
+            }
+        };
+
+        /*
+            The storage for the evaluated arguments of one call. Up to INLINE_CAPACITY arguments are kept
+            inline (on the caller's stack), so a call does not allocate on the heap.
+        */
+        class ArgumentBuffer
+        {
+            public:
+                static constexpr std::size_t INLINE_CAPACITY = 8;
+
+                explicit ArgumentBuffer(std::size_t count)
+                {
+                    if(count > INLINE_CAPACITY)
+                    {
+                        m_overflow.reserve(count);
+                    }
+                }
+
+                void push_back(lang::util::object_t&& value)
+                {
+                    if(m_size < INLINE_CAPACITY && m_overflow.capacity() == 0)
+                    {
+                        m_inline[m_size++] = std::move(value);
+                        return;
+                    }
+
+                    m_overflow.push_back(std::move(value));
+                    m_size++;
+                }
+
+                Arguments view()
+                {
+                    return Arguments{m_overflow.capacity() == 0 ? m_inline.data() : m_overflow.data(), m_size};
+                }
+
+            private:
+                std::array<lang::util::object_t, INLINE_CAPACITY> m_inline;
+                std::vector<lang::util::object_t> m_overflow;
+                std::size_t m_size{0};
+        };
+
+        /*
+            A variable captured by a closure (see lang::ast::FunctionStatement::captures). While the environment
+            that declares the variable exists the upvalue is open and "location" points into it. An environment of
+            the interpreter's environment stack closes its upvalues when it is popped: the value moves into
+            "closed" and "location" points there. The closures that capture one variable share its upvalue, so
+            they keep seeing each other's assignments after it is closed.
+        */
+        struct Upvalue
+        {
+            lang::util::object_t* location;
+            lang::util::object_t closed;
+            lang::env::Environment* environment; /* The environment of the variable, nullptr once closed */
+
+            Upvalue(lang::util::object_t* location, lang::env::Environment* environment)
+                : location(location), environment(environment)
+            {}
+
+            /* A closed upvalue that holds "value" */
+            explicit Upvalue(const lang::util::object_t& value)
+                : location(&closed), closed(value), environment(nullptr)
+            {}
+
+            Upvalue(const Upvalue&) = delete;
+
+            Upvalue& operator=(const Upvalue&) = delete;
+
+            void close()
+            {
+                closed = *location;
+                location = &closed;
+                environment = nullptr;
+            }
+        };
 
         struct LLCallable
         {
+            /* The entry point of a native function, see lang::native::adapter */
+            using native_fn_t = lang::util::object_t (*)(const LLCallable* callable, lang::util::Arguments arguments);
+
             size_t arity{0};
-            lang::util::object_t (*call_fn)(std::vector<lang::util::object_t>&& arguments) = nullptr;
+            native_fn_t call_fn = nullptr;
+            void (*native_target)() = nullptr; /* The type erased C++ function a native adapter calls */
+            std::string native_name;
             bool flag_is_native_function{false};
+            bool flag_is_variadic{false}; /* A native taking "arity" or more arguments */
+            bool flag_takes_callable{false}; /* A native that can call a function it gets, a raw one always can */
+            bool flag_is_initializer{false}; /* An "init" method, calling it always returns "this" */
             lang::Interpreter* interpreter = nullptr;
             lang::ast::FunctionStatement* function_declaration_statement = nullptr;
             lang::env::Environment* closure = nullptr;
 
-            lang::env::Environment* new_environment = nullptr;
+            /*
+                The captured variables, in the order of function_declaration_statement->captures. A function that
+                captures its whole environment (FunctionStatement::captures_environment) has none, otherwise its
+                closure is only the global environment
+            */
+            std::vector<std::shared_ptr<lang::util::Upvalue>> upvalues;
 
             LLCallable(
                 
@@ -61,28 +258,234 @@ namespace lang
                     lang::ast::FunctionStatement* function_declaration_statement, 
                     bool flag_is_native_function,
                     size_t arity,
-                    lang::util::object_t (*call_fn)(std::vector<lang::util::object_t>&& arguments),
+                    native_fn_t call_fn,
                     lang::env::Environment* closure
 
             );
 
             ~LLCallable();
 
-            lang::util::object_t call(std::vector<lang::util::object_t>&& arguments);
+            /* Counted as lang::memory::Subsystem::CALLABLES, like LLClass */
+            static void* operator new(std::size_t size);
+
+            static void operator delete(void* memory);
+
+            lang::util::object_t call(lang::util::Arguments arguments);
+
+            /* A call of a script function with another closure, for a method it has "this" (see Interpreter::call_method) */
+            lang::util::object_t call(lang::util::Arguments arguments, lang::env::Environment* closure);
+        };
+
+        /* A contiguous array of unboxed doubles. It is shared by reference, copying the object_t only copies the pointer */
+        struct LLArray
+        {
+            std::vector<double> values;
+
+            LLArray() = default;
+
+            LLArray(std::vector<double>&& values)
+                : values(std::move(values))
+            {}
+        };
+
+        /*
+            A hash map keyed by numbers and strings.
+
+            Entries are kept densely in insertion order in "entries" (which also gives cheap iteration by position),
+            and an open addressing table of small slots with linear probing points into it. A slot stores the entry
+            position and the upper bits of the key's hash, so most probes never touch the entries at all.
+            Every entry remembers its full hash, so growing the table never hashes a key again.
+        */
+        struct LLMap
+        {
+            struct Entry
+            {
+                lang::util::object_t key;
+                lang::util::object_t value;
+                std::uint64_t hash;
+            };
+
+            std::vector<Entry> entries;
+
+            /* Only numbers and strings can be keys. String keys are stored compacted, see LLString::compacted() */
+            static bool is_valid_key(const lang::util::object_t& key);
+
+            /* It returns nullptr if the key is not present */
+            lang::util::object_t* get(const lang::util::object_t& key);
+
+            void set(const lang::util::object_t& key, const lang::util::object_t& value);
+
+            /* It returns false if the key was not present. The last entry takes the place of the removed one */
+            bool remove(const lang::util::object_t& key);
+
+            std::size_t size() const
+            {
+                return entries.size();
+            }
+
+            private:
+                struct Slot
+                {
+                    std::int32_t position; /* index into entries or one of EMPTY/TOMBSTONE */
+                    std::uint32_t hash_tag;
+                };
+
+                static constexpr std::int32_t EMPTY = -1;
+                static constexpr std::int32_t TOMBSTONE = -2;
+
+                static std::uint64_t hash_key(const lang::util::object_t& key);
+
+                static bool keys_equal(const lang::util::object_t& key_A, const lang::util::object_t& key_B);
+
+                /* It returns the slot holding the key or nullptr */
+                Slot* find_slot(const lang::util::object_t& key, std::uint64_t hash);
+
+                /* It returns the slot pointing at entries[position], the entry must be present */
+                Slot* find_slot_of_position(std::uint64_t hash, std::size_t position);
+
+                void insert_slot(std::uint64_t hash, std::size_t position);
+
+                void rehash(std::size_t capacity);
+
+                std::vector<Slot> m_slots;
+                std::size_t m_used_slots{0}; /* live entries and tombstones */
+        };
+
+        /*
+            A hidden class. It describes which fields an instance has and at which position of LLInstance::fields
+            each one is stored. Instances that got the same fields in the same order share one shape, so a shape
+            pointer is enough to know where a field is (see lang::ast::InlineCache).
+
+            Every class has its own root shape and shapes form a tree of transitions: adding field "x" to an
+            instance with shape S moves it to S's child for "x". Shapes are owned by their parent, the root by the class.
+        */
+        struct LLShape
+        {
+            LLClass* klass;
+            std::unordered_map<std::string, std::size_t, lang::util::string_hash, std::equal_to<>> field_slots;
+            std::unordered_map<std::string, std::unique_ptr<LLShape>, lang::util::string_hash, std::equal_to<>> transitions;
+
+            LLShape(LLClass* klass)
+                : klass(klass)
+            {}
+
+            /* It returns the position of the field or nullptr */
+            const std::size_t* find_field(std::string_view name) const;
+
+            /* The shape of an instance of this shape after field "name" is added. Its position is field_slots.size() of this shape */
+            LLShape* add_field(std::string_view name);
+        };
+
+        struct LLClass
+        {
+            std::string name;
+            LLClass* superclass = nullptr;
+            std::unordered_map<std::string, lang::util::LLCallable*, lang::util::string_hash, std::equal_to<>> methods;
+            LLShape root_shape{this};
+
+            LLClass(std::string_view name, LLClass* superclass)
+                : name(name), superclass(superclass)
+            {}
+
+            static void* operator new(std::size_t size);
+
+            static void operator delete(void* memory);
+
+            /* It looks in the class and then in its superclasses, nullptr if there is no such method */
+            lang::util::LLCallable* find_method(std::string_view name) const;
+        };
+
+        struct LLInstance
+        {
+            LLShape* shape;
+            std::vector<lang::util::object_t> fields;
+
+            LLInstance(LLClass* klass)
+                : shape(&klass->root_shape)
+            {}
         };
 
+        /*
+            The shortest text that reads back as the same double. Like JavaScript, numbers between 1e-7 and 1e21
+            are never in exponent form: 500000 and 0.1, but 1e+21.
+        */
+        inline void append_number(std::string& out, double value)
+        {
+            char buffer[64];
+            double magnitude = std::abs(value);
+
+            auto [end, error] = (magnitude == 0.0 || (magnitude >= 1e-7 && magnitude < 1e21))
+                ? std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed)
+                : std::to_chars(buffer, buffer + sizeof(buffer), value);
+
+            out.append(buffer, end);
+        }
+
+        /* It appends a value without a trailing newline, used for the elements of containers */
+        struct FormatVisitor
+        {
+            std::string& out;
+
+            void operator()(double value) const { lang::util::append_number(out, value); }
+            void operator()(const lang::util::LLString& value) const
+            {
+                /* The quoting of std::quoted */
+                out += '"';
+                for(char c: value.view())
+                {
+                    if(c == '"' || c == '\\')
+                    {
+                        out += '\\';
+                    }
+                    out += c;
+                }
+                out += '"';
+            }
+            void operator()(bool value) const { out += value ? "true" : "false"; }
+            void operator()(lang::util::LLCallable* llcallable) const { out += "<NATIVE FN>"; }
+            void operator()(null_t value) const { out += "MYTYPE::NIL"; }
+            void operator()(lang::util::LLClass* klass) const { out += "<CLASS " + klass->name + ">"; }
+            void operator()(const std::shared_ptr<lang::util::LLInstance>& instance) const { out += "<" + instance->shape->klass->name + " INSTANCE>"; }
+            void operator()(const std::shared_ptr<lang::util::LLArray>& array) const
+            {
+                out += "[";
+                for(std::size_t i = 0; i < array->values.size(); i++)
+                {
+                    out += (i == 0 ? "" : ", ");
+                    lang::util::append_number(out, array->values[i]);
+                }
+                out += "]";
+            }
+            void operator()(const std::shared_ptr<lang::util::LLMap>& map) const
+            {
+                out += "{";
+                for(std::size_t i = 0; i < map->entries.size(); i++)
+                {
+                    out += (i == 0 ? "" : ", ");
+                    std::visit(*this, map->entries[i].key);
+                    out += ": ";
+                    std::visit(*this, map->entries[i].value);
+                }
+                out += "}";
+            }
+        };
+
+        /* It appends a value the way the print statement shows it, strings are not quoted */
         struct PrintVisitor
         {
-            void operator()(double value) const { std::cout << value << "\n"; }
-            void operator()(const std::string& value) const { std::cout << value << "\n"; }
-            void operator()(bool value) const { std::cout << std::boolalpha << value << "\n"; }
-            void operator()(lang::util::LLCallable* llcallable)
+            std::string& out;
+
+            void operator()(const lang::util::LLString& value) const
             {
-                std::cout << "<NATIVE FN>\n";
+                out.append(value.view());
+                out += '\n';
             }
-            void operator()(null_t value) const
+
+            template<typename T>
+            void operator()(const T& value) const
             {
-                std::cout << "MYTYPE::NIL\n";
+                lang::util::FormatVisitor{out}(value);
+                out += '\n';
             }
         };
 
@@ -118,6 +521,72 @@ namespace lang
                 std::string msg;
         };
 
+        /* Custom Exception. Native functions throw it, the interpreter reports it with the line of the call */
+        class native_error: public std::exception
+        {
+            public:
+                /* Constructor with a message */
+                native_error(const std::string& message): msg(message){}
+
+                /* Override what() method to provide error message */
+                virtual const char* what() const throw() {
+                    return msg.c_str();
+                }
+            
+            private:
+                std::string msg;
+        };
+
+        /*
+            Custom Exception. The interpreter throws it when the execution budget or the deadline of a run is used up.
+            Only the top of the run catches it, every function it unwinds through adds itself to the report.
+        */
+        class execution_aborted: public std::exception
+        {
+            public:
+                static constexpr std::size_t MAX_REPORTED_FRAMES = 16;
+
+                execution_aborted(int line, const std::string& message)
+                    : line(line), msg(message)
+                {}
+
+                virtual const char* what() const throw() {
+                    return msg.c_str();
+                }
+
+                void add_frame(std::string_view function_name)
+                {
+                    if(frames.size() < MAX_REPORTED_FRAMES)
+                    {
+                        frames.emplace_back(function_name);
+                    }
+                    frame_count++;
+                }
+
+                /* "[line 3] Error : Deadline of 100 ms exceeded in fib() <- fib() <- <script>" */
+                std::string report() const
+                {
+                    std::string text = "[line " + std::to_string(line) + "] Error : " + msg + " in ";
+                    for(const auto& frame: frames)
+                    {
+                        text += frame + "() <- ";
+                    }
+                    if(frame_count > frames.size())
+                    {
+                        text += "... " + std::to_string(frame_count - frames.size()) + " more <- ";
+                    }
+                    text += "<script>\n";
+
+                    return text;
+                }
+
+            private:
+                int line;
+                std::string msg;
+                std::vector<std::string> frames; /* the innermost first */
+                std::size_t frame_count{0};
+        };
+
         class return_statement_throw: public std::exception
         {
             public:
@@ -0,0 +1,181 @@
+#include <batch/batch.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace lang
+{
+    namespace batch
+    {
+        std::uint64_t ProgramCache::content_hash(std::string_view source)
+        {
+            std::uint64_t hash{14695981039346656037ull};
+            for(unsigned char character: source)
+            {
+                hash ^= character;
+                hash *= 1099511628211ull;
+            }
+
+            return hash;
+        }
+
+        std::shared_ptr<const CompiledProgram> ProgramCache::get(std::string source)
+        {
+            std::uint64_t hash = content_hash(source);
+            std::promise<std::shared_ptr<const CompiledProgram>> promise;
+
+            /* The programs of the bucket are waited for without the lock, another worker may still be compiling one */
+            std::size_t checked{0};
+            while(true)
+            {
+                std::vector<std::shared_future<std::shared_ptr<const CompiledProgram>>> candidates;
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+
+                    auto& bucket = m_programs[hash];
+                    if(bucket.size() == checked)
+                    {
+                        bucket.push_back(promise.get_future().share());
+                        m_compilations++;
+                        break;
+                    }
+
+                    candidates.assign(bucket.begin() + checked, bucket.end());
+                }
+
+                for(const auto& candidate: candidates)
+                {
+                    const auto& program = candidate.get();
+                    if(program->source() == source)
+                    {
+                        return program;
+                    }
+                }
+
+                checked += candidates.size();
+            }
+
+            auto program = lang::Lang::compile(std::move(source));
+            promise.set_value(program);
+
+            return program;
+        }
+
+        std::size_t ProgramCache::compilations() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            return m_compilations;
+        }
+
+        std::vector<std::string> collect_scripts(const std::string& directory_or_list)
+        {
+            std::vector<std::string> paths;
+
+            if(std::filesystem::is_directory(directory_or_list))
+            {
+                for(const auto& entry: std::filesystem::recursive_directory_iterator(directory_or_list))
+                {
+                    if(entry.is_regular_file() && entry.path().extension() == ".ll")
+                    {
+                        paths.push_back(entry.path().string());
+                    }
+                }
+
+                std::sort(paths.begin(), paths.end());
+                return paths;
+            }
+
+            std::ifstream list(directory_or_list);
+            if(!list.is_open())
+            {
+                throw std::runtime_error("Error opening the list " + directory_or_list);
+            }
+
+            std::filesystem::path base = std::filesystem::path(directory_or_list).parent_path();
+
+            std::string line;
+            while(std::getline(list, line))
+            {
+                if(line.empty())
+                {
+                    continue;
+                }
+
+                std::filesystem::path path(line);
+                paths.push_back((path.is_relative() ? base / path : path).string());
+            }
+
+            return paths;
+        }
+
+        namespace
+        {
+            bool read_file(const std::string& path, std::string& content)
+            {
+                std::ifstream file(path, std::ios::binary);
+                if(!file.is_open())
+                {
+                    return false;
+                }
+
+                std::stringstream buffer;
+                buffer << file.rdbuf();
+                content = std::move(buffer).str();
+
+                return true;
+            }
+        }
+
+        std::vector<ScriptReport> run(const std::vector<std::string>& paths, std::size_t thread_count, ProgramCache& cache, const lang::ExecutionLimits& limits)
+        {
+            std::vector<ScriptReport> reports(paths.size());
+
+            lang::ThreadPool pool(thread_count);
+            std::vector<std::unique_ptr<lang::Isolate>> isolates(pool.size());
+
+            pool.parallel_for(paths.size(), [&](std::size_t worker, std::size_t index)
+            {
+                ScriptReport& report = reports[index];
+                report.path = paths[index];
+
+                std::string source;
+                if(!read_file(paths[index], source))
+                {
+                    report.output = "Provided file does not exists\n";
+                    return;
+                }
+
+                auto program = cache.get(std::move(source));
+                if(!program->ok())
+                {
+                    std::ostringstream errors;
+                    lang::Lang::write_compile_errors(*program, errors);
+                    report.output = std::move(errors).str();
+                    return;
+                }
+
+                if(isolates[worker] == nullptr)
+                {
+                    isolates[worker] = std::make_unique<lang::Isolate>();
+                    isolates[worker]->set_limits(limits);
+                }
+
+                lang::Isolate& isolate = *isolates[worker];
+
+                ExecutionResult result = isolate.execute(*program);
+
+                std::ostringstream output;
+                output << isolate.take_output();
+                lang::Lang::write_execution_errors(result, output);
+
+                report.output = std::move(output).str();
+                report.succeeded = result.ok();
+            });
+
+            return reports;
+        }
+    }
+}
@@ -1,12 +1,62 @@
 #include <environment/environment.hpp>
+#include <memory/memory.hpp>
 
 namespace lang
 {
     namespace env
     {
-        Environment::Environment(Environment* enclosing): m_enclosing(enclosing) {}
+        namespace
+        {
+            /* The environment with the slots of the chain that "enclosing" starts, for a new environment "environment" */
+            Environment* global_of(Environment* environment, Environment* enclosing)
+            {
+                if(enclosing == nullptr)
+                {
+                    return nullptr;
+                }
+
+                /* The builtins environment is the only one without an enclosing one */
+                return enclosing->enclosing() == nullptr ? environment : enclosing->global_environment();
+            }
+        }
+
+        std::size_t SymbolTable::id(std::string_view name)
+        {
+            auto it = m_ids.find(name);
+            if(it != m_ids.end())
+            {
+                return it->second;
+            }
+
+            return m_ids.emplace(std::string(name), m_ids.size()).first->second;
+        }
+
+        std::size_t SymbolTable::size() const
+        {
+            return m_ids.size();
+        }
+
+        Environment::Environment(Environment* enclosing): m_enclosing(enclosing), m_global(global_of(this, enclosing)) {}
 
         Environment::~Environment(){}
+
+        void Environment::reset(Environment* enclosing)
+        {
+            m_values.clear();
+            m_enclosing = enclosing;
+            m_global = global_of(this, enclosing);
+        }
+
+        void* Environment::operator new(std::size_t size)
+        {
+            return lang::memory::allocate(size, lang::memory::Subsystem::ENVIRONMENTS);
+        }
+
+        void Environment::operator delete(void* memory)
+        {
+            lang::memory::deallocate(memory);
+        }
+
         lang::util::object_t Environment::get(const lang::Token& name)
         {   
             auto it = m_values.find(name.m_lexeme);
@@ -20,7 +70,7 @@ namespace lang
                 return m_enclosing->get(name);
             }
 
-            throw std::runtime_error("Undefined variable '" + name.m_lexeme + "'.");
+            throw std::runtime_error("Undefined variable '" + std::string(name.m_lexeme) + "'.");
         }
 
         void Environment::assign(const lang::Token& name, const lang::util::object_t& value)
@@ -28,7 +78,7 @@ namespace lang
             auto it = m_values.find(name.m_lexeme);
             if(it != m_values.end())
             {
-                m_values[name.m_lexeme] = value;
+                it->second = value;
                 return;
             }
 
@@ -38,12 +88,148 @@ namespace lang
                 return;
             }
 
-            throw std::runtime_error("Undefined variable '" + name.m_lexeme + "'.");
+            throw std::runtime_error("Undefined variable '" + std::string(name.m_lexeme) + "'.");
+        }
+
+        void Environment::define(std::string_view name, const lang::util::object_t& value)
+        {
+            auto it = m_values.find(name);
+            if(it != m_values.end())
+            {
+                it->second = value;
+                return;
+            }
+
+            lang::memory::Scope memory_scope(lang::memory::Subsystem::ENVIRONMENTS);
+            m_values.emplace(std::string(name), value);
+
+            /* A slot can be bound to a builtin that the new variable hides */
+            std::fill(m_slots.begin(), m_slots.end(), nullptr);
         }
 
-        void Environment::define(const std::string& name, const lang::util::object_t& value)
+        lang::util::object_t* Environment::find_local(std::string_view name)
         {
-            m_values[name] = value;
+            auto it = m_values.find(name);
+            if(it != m_values.end())
+            {
+                return &it->second;
+            }
+
+            return nullptr;
+        }
+
+        const Environment::values_t& Environment::values() const
+        {
+            return m_values;
+        }
+
+        Environment* Environment::enclosing() const
+        {
+            return m_enclosing;
+        }
+
+        Environment* Environment::global_environment()
+        {
+            return m_global != nullptr ? m_global : this;
+        }
+
+        lang::util::object_t* Environment::bind_global(std::size_t slot, std::string_view name)
+        {
+            lang::util::object_t* variable = nullptr;
+            for(Environment* environment = m_global; environment != nullptr && variable == nullptr; environment = environment->m_enclosing)
+            {
+                variable = environment->find_local(name);
+            }
+
+            /* The variables of an environment are never removed and their storage does not move */
+            if(variable != nullptr)
+            {
+                std::vector<lang::util::object_t*>& slots = m_global->m_slots;
+                if(slot >= slots.size())
+                {
+                    lang::memory::Scope memory_scope(lang::memory::Subsystem::ENVIRONMENTS);
+                    slots.resize(slot + 1, nullptr);
+                }
+
+                slots[slot] = variable;
+            }
+
+            return variable;
+        }
+
+        std::string_view Environment::name_of(const lang::util::object_t* variable) const
+        {
+            for(const auto& [name, value]: m_values)
+            {
+                if(&value == variable)
+                {
+                    return name;
+                }
+            }
+
+            return {};
+        }
+
+        bool Environment::is_pooled() const
+        {
+            return m_pooled;
+        }
+
+        Environment* EnvironmentStack::push(Environment* enclosing)
+        {
+            if(m_depth == m_environments.size())
+            {
+                m_environments.emplace_back(enclosing);
+                m_environments.back().m_pooled = true;
+            }
+            else
+            {
+                m_environments[m_depth].reset(enclosing);
+            }
+
+            return &m_environments[m_depth++];
+        }
+
+        void EnvironmentStack::pop()
+        {
+            Environment* environment = &m_environments[--m_depth];
+
+            /* Upvalues are not ordered by environment, a closure can capture a variable of any scope around it */
+            if(!m_open_upvalues.empty())
+            {
+                auto closed = std::remove_if(m_open_upvalues.begin(), m_open_upvalues.end(), [&](const std::shared_ptr<lang::util::Upvalue>& upvalue){
+                    if(upvalue->environment != environment)
+                    {
+                        return false;
+                    }
+
+                    upvalue->close();
+                    return true;
+                });
+                m_open_upvalues.erase(closed, m_open_upvalues.end());
+            }
+
+            environment->reset(nullptr);
+        }
+
+        std::size_t EnvironmentStack::depth() const
+        {
+            return m_depth;
+        }
+
+        std::shared_ptr<lang::util::Upvalue> EnvironmentStack::capture(Environment* environment, lang::util::object_t* variable)
+        {
+            for(auto upvalue = m_open_upvalues.rbegin(); upvalue != m_open_upvalues.rend(); upvalue++)
+            {
+                if((*upvalue)->location == variable)
+                {
+                    return *upvalue;
+                }
+            }
+
+            m_open_upvalues.push_back(std::allocate_shared<lang::util::Upvalue>(upvalue_allocator_t{}, variable, environment));
+
+            return m_open_upvalues.back();
         }
     }
-}
\ No newline at end of file
+}
@@ -1,61 +1,638 @@
 #include <interpreter/interpreter.hpp>
+#include <kernels/kernels.hpp>
+#include <memory/memory.hpp>
+#include <tasks/tasks.hpp>
+#include <parallel/parallel.hpp>
+
+#include <chrono>
+#include <cmath>
 
 namespace lang
 {
 
-    lang::env::Environment* Interpreter::get_environment()
-    {
-        return m_environment;
-    }
-
     /*****************************************native functions*******************************************/
-    lang::util::object_t native_clock_function(std::vector<lang::util::object_t>&& arguments)
+    /*
+        Natives are plain C++ functions, Interpreter::register_native derives their arity and the checks
+        of the argument types from the signature (see native/native.hpp).
+    */
+    namespace
     {
-        return 89.9;
+        using array_t = std::shared_ptr<lang::util::LLArray>;
+        using map_t = std::shared_ptr<lang::util::LLMap>;
+
+        /* Seconds from a monotonic clock, only differences between two calls are meaningful */
+        double native_clock_function()
+        {
+            auto since_epoch = std::chrono::steady_clock::now().time_since_epoch();
+
+            return std::chrono::duration<double>(since_epoch).count();
+        }
+
+        /* Nanoseconds from the same monotonic clock */
+        double native_nanotime_function()
+        {
+            auto since_epoch = std::chrono::steady_clock::now().time_since_epoch();
+
+            return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch).count());
+        }
+
+        const lang::util::object_t& expect_key(const lang::util::object_t& argument, const char* function_name)
+        {
+            if(lang::util::LLMap::is_valid_key(argument))
+            {
+                return argument;
+            }
+
+            throw lang::util::native_error(std::string(function_name) + "() expects a number or string key");
+        }
+
+        /* Positions used by key_at()/value_at() to iterate over a map */
+        std::size_t expect_map_position(const map_t& map, std::size_t position, const char* function_name)
+        {
+            if(position >= map->size())
+            {
+                throw lang::util::native_error(std::string(function_name) + "() position out of range");
+            }
+
+            return position;
+        }
+
+        /* array(size, fill) */
+        array_t native_array_function(std::size_t size, double fill)
+        {
+            return std::make_shared<lang::util::LLArray>(std::vector<double>(size, fill));
+        }
+
+        double native_len_function(const lang::util::object_t& argument)
+        {
+            if(auto* data = std::get_if<lang::util::LLString>(&argument))
+            {
+                return static_cast<double>(data->size());
+            }
+
+            if(auto* data = std::get_if<map_t>(&argument))
+            {
+                return static_cast<double>((*data)->size());
+            }
+
+            if(auto* data = std::get_if<array_t>(&argument))
+            {
+                return static_cast<double>((*data)->values.size());
+            }
+
+            throw lang::util::native_error("len() expects a string, an array or a map as argument 1");
+        }
+
+        double native_sum_function(const array_t& array)
+        {
+            return lang::kernels::sum(array->values.data(), array->values.size());
+        }
+
+        double native_dot_function(const array_t& a, const array_t& b)
+        {
+            if(a->values.size() != b->values.size())
+            {
+                throw lang::util::native_error("dot() expects arrays of the same length");
+            }
+
+            return lang::kernels::dot(a->values.data(), b->values.data(), a->values.size());
+        }
+
+        double native_min_function(const array_t& array)
+        {
+            if(array->values.empty())
+            {
+                throw lang::util::native_error("min() of an empty array");
+            }
+
+            return lang::kernels::min(array->values.data(), array->values.size());
+        }
+
+        double native_max_function(const array_t& array)
+        {
+            if(array->values.empty())
+            {
+                throw lang::util::native_error("max() of an empty array");
+            }
+
+            return lang::kernels::max(array->values.data(), array->values.size());
+        }
+
+        /* scale(array, factor) returns a new array */
+        array_t native_scale_function(const array_t& array, double factor)
+        {
+            auto result = std::make_shared<lang::util::LLArray>(std::vector<double>(array->values.size()));
+            lang::kernels::scale(array->values.data(), factor, result->values.data(), array->values.size());
+
+            return result;
+        }
+
+        /* add(a, b) returns a new array with the element wise sum */
+        array_t native_add_function(const array_t& a, const array_t& b)
+        {
+            if(a->values.size() != b->values.size())
+            {
+                throw lang::util::native_error("add() expects arrays of the same length");
+            }
+
+            auto result = std::make_shared<lang::util::LLArray>(std::vector<double>(a->values.size()));
+            lang::kernels::add(a->values.data(), b->values.data(), result->values.data(), a->values.size());
+
+            return result;
+        }
+
+        map_t native_map_function()
+        {
+            return std::make_shared<lang::util::LLMap>();
+        }
+
+        /* get(map, key) returns nil for a missing key */
+        lang::util::object_t native_get_function(const map_t& map, const lang::util::object_t& key)
+        {
+            lang::util::object_t* value = map->get(expect_key(key, "get"));
+
+            if(value == nullptr)
+            {
+                return lang::util::null;
+            }
+
+            return *value;
+        }
+
+        /* set(map, key, value) returns the value */
+        lang::util::object_t native_set_function(const map_t& map, const lang::util::object_t& key, const lang::util::object_t& value)
+        {
+            map->set(expect_key(key, "set"), value);
+
+            return value;
+        }
+
+        bool native_has_function(const map_t& map, const lang::util::object_t& key)
+        {
+            return map->get(expect_key(key, "has")) != nullptr;
+        }
+
+        /* delete(map, key) returns false if the key was not present */
+        bool native_delete_function(const map_t& map, const lang::util::object_t& key)
+        {
+            return map->remove(expect_key(key, "delete"));
+        }
+
+        /* key_at(map, position) and value_at(map, position) iterate a map for position in [0, len(map)) */
+        lang::util::object_t native_key_at_function(const map_t& map, std::size_t position)
+        {
+            return map->entries[expect_map_position(map, position, "key_at")].key;
+        }
+
+        lang::util::object_t native_value_at_function(const map_t& map, std::size_t position)
+        {
+            return map->entries[expect_map_position(map, position, "value_at")].value;
+        }
+
+        /*
+            bench(fn, iterations) calls the zero argument function fn for iterations/10 warm-up rounds (at least one),
+            then "iterations" measured rounds. It returns a map with the per iteration
+            "min_ns", "median_ns", "p99_ns", "mean_ns" and "allocations" (average heap allocations).
+        */
+        map_t native_bench_function(lang::util::LLCallable* function, std::size_t count)
+        {
+            if(function->arity != 0)
+            {
+                throw lang::util::native_error("bench() expects a function without parameters");
+            }
+
+            if(count < 1)
+            {
+                throw lang::util::native_error("bench() expects a positive integer iteration count");
+            }
+
+            std::size_t warm_up = std::max<std::size_t>(1, count / 10);
+
+            for(std::size_t i = 0; i < warm_up; i++)
+            {
+                (void)function->call(lang::util::Arguments{});
+            }
+
+            std::vector<double> timings_ns(count);
+            std::uint64_t allocations{0};
+
+            for(std::size_t i = 0; i < count; i++)
+            {
+                std::uint64_t allocations_before = lang::memory::thread_counters().allocations;
+                auto start = std::chrono::steady_clock::now();
+
+                (void)function->call(lang::util::Arguments{});
+
+                auto end = std::chrono::steady_clock::now();
+                allocations += lang::memory::thread_counters().allocations - allocations_before;
+
+                timings_ns[i] = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+            }
+
+            std::sort(timings_ns.begin(), timings_ns.end());
+
+            double total_ns{0};
+            for(double timing: timings_ns)
+            {
+                total_ns += timing;
+            }
+
+            /* Nearest rank percentile */
+            std::size_t p99_rank = static_cast<std::size_t>(std::ceil(0.99 * count));
+
+            auto report = std::make_shared<lang::util::LLMap>();
+            report->set(lang::util::LLString("iterations"), static_cast<double>(count));
+            report->set(lang::util::LLString("min_ns"), timings_ns.front());
+            report->set(lang::util::LLString("median_ns"), timings_ns[count / 2]);
+            report->set(lang::util::LLString("p99_ns"), timings_ns[p99_rank - 1]);
+            report->set(lang::util::LLString("mean_ns"), total_ns / count);
+            report->set(lang::util::LLString("allocations"), static_cast<double>(allocations) / count);
+
+            return report;
+        }
     }
     /*****************************************native functions*******************************************/
 
 
-    std::vector<std::string> Interpreter::interpret(std::vector<lang::ast::Statement*>&& statements)
+    Interpreter::Interpreter()
     {
-        m_errors.clear();
-
-        auto environment = std::make_unique<lang::env::Environment>(nullptr);
-        m_environment = environment.get();
+        this->register_native("clock", &native_clock_function);
+        this->register_native("nanotime", &native_nanotime_function);
+        this->register_native("bench", &native_bench_function);
+
+        this->register_native("array", &native_array_function);
+        this->register_native("len", &native_len_function);
+        this->register_native("sum", &native_sum_function);
+        this->register_native("dot", &native_dot_function);
+        this->register_native("min", &native_min_function);
+        this->register_native("max", &native_max_function);
+        this->register_native("scale", &native_scale_function);
+        this->register_native("add", &native_add_function);
+
+        this->register_native("map", &native_map_function);
+        this->register_native("get", &native_get_function);
+        this->register_native("set", &native_set_function);
+        this->register_native("has", &native_has_function);
+        this->register_native("delete", &native_delete_function);
+        this->register_native("key_at", &native_key_at_function);
+        this->register_native("value_at", &native_value_at_function);
+
+        lang::tasks::register_natives(*this);
+        lang::parallel::register_natives(*this);
+    }
 
-        /*******************************************************************************************************************************************/
-        lang::util::LLCallable* clock_callable = new lang::util::LLCallable(this, nullptr, true, 0, &native_clock_function, nullptr);
+    Interpreter::~Interpreter()
+    {
+        this->release_run_state();
 
-        m_environment->define("clock", clock_callable);
+        for(auto const& func_pointer: m_builtin_llcallables)
+        {
+            delete func_pointer;
+        }
+    }
 
-        m_temp_llcallables.push_back(clock_callable);
+    std::vector<std::string> Interpreter::interpret(const std::vector<lang::ast::Statement*>& statements, std::size_t inline_cache_count, const lang::globals_t& globals)
+    {
+        this->begin_run(inline_cache_count);
 
-        /*******************************************************************************************************************************************/
+        for(const auto& [name, value]: globals)
+        {
+            m_globals->define(name, value);
+        }
 
-        m_temp_envs.emplace_back(std::move(environment));
+        return this->continue_run(statements);
+    }
 
+    std::vector<std::string> Interpreter::continue_run(const std::vector<lang::ast::Statement*>& statements)
+    {
         try
         {
             for(const auto& stmt: statements)
             {
                 this->execute(stmt);
             }
-
-            return std::move(m_errors);
+        }
+        catch(const lang::util::execution_aborted& e)
+        {
+            m_errors.push_back(e.report());
         }
         catch(const std::exception& e)
         {
-            return std::move(m_errors);
+            /* The error is already in m_errors */
+        }
+
+        this->end_run();
+
+        return std::move(m_errors);
+    }
+
+    void Interpreter::end_run()
+    {
+        this->settle_steps();
+
+        /* Nothing the run spawned keeps running (or printing) once it returned */
+        this->cancel_tasks();
+
+        m_output->flush();
+    }
+
+    void Interpreter::begin_run(std::size_t inline_cache_count)
+    {
+        this->release_run_state();
+
+        m_errors.clear();
+        m_inline_caches.assign(inline_cache_count, lang::ast::InlineCache{});
+
+        m_globals = this->make_environment(m_builtins.get());
+        m_environment = m_globals;
+
+        m_cancelled.store(false, std::memory_order_relaxed);
+        m_steps_taken = std::make_shared<std::atomic<std::uint64_t>>(0);
+        m_deadline = std::chrono::steady_clock::now() + m_limits.timeout;
+        this->reload_step_counter();
+    }
+
+    void Interpreter::release_run()
+    {
+        this->release_run_state();
+
+        m_errors.clear();
+        m_inline_caches.clear();
+        m_programs.clear();
+    }
+
+    void Interpreter::set_limits(const lang::ExecutionLimits& limits)
+    {
+        m_limits = limits;
+    }
+
+    const lang::ExecutionLimits& Interpreter::limits() const
+    {
+        return m_limits;
+    }
+
+    void Interpreter::inherit_limits(const Interpreter& caller)
+    {
+        m_limits = caller.m_limits;
+        m_steps_taken = caller.m_steps_taken;
+        m_deadline = caller.m_deadline;
+
+        /* A period of one step: what is left is known when it runs, not when it was spawned */
+        m_steps_between_checks = 1;
+        m_steps_until_check = 1;
+    }
+
+    std::uint64_t Interpreter::steps_taken() const
+    {
+        return m_steps_taken->load(std::memory_order_relaxed) + static_cast<std::uint64_t>(m_steps_between_checks - m_steps_until_check);
+    }
+
+    void Interpreter::settle_steps()
+    {
+        m_steps_taken->fetch_add(static_cast<std::uint64_t>(m_steps_between_checks - m_steps_until_check), std::memory_order_relaxed);
+
+        m_steps_between_checks = 1;
+        m_steps_until_check = 1;
+    }
+
+    void Interpreter::set_shadow_stack(lang::profiler::ShadowStack* shadow_stack)
+    {
+        m_shadow_stack = shadow_stack;
+    }
+
+    void Interpreter::set_line_profiler(lang::profiler::LineProfiler* line_profiler)
+    {
+        m_line_profiler = line_profiler;
+    }
+
+    void Interpreter::reload_step_counter()
+    {
+        /* Even without limits, for cancel() */
+        std::int64_t steps = DEADLINE_CHECK_STEPS;
+
+        if(m_limits.max_steps > 0)
+        {
+            /* The step after the last allowed one is the one that reaches zero */
+            std::uint64_t taken = m_steps_taken->load(std::memory_order_relaxed);
+            std::uint64_t left = (taken <= m_limits.max_steps) ? m_limits.max_steps - taken + 1 : 1;
+            steps = static_cast<std::int64_t>(std::min<std::uint64_t>(static_cast<std::uint64_t>(steps), left));
         }
+
+        m_steps_between_checks = steps;
+        m_steps_until_check = steps;
+    }
+
+    void Interpreter::check_limits(int line)
+    {
+        /* Nothing is left of the period, for steps_taken() if a limit stops the run */
+        std::uint64_t taken = m_steps_taken->fetch_add(static_cast<std::uint64_t>(m_steps_between_checks), std::memory_order_relaxed) + static_cast<std::uint64_t>(m_steps_between_checks);
+        m_steps_between_checks = 0;
+        m_steps_until_check = 0;
+
+        if(m_cancelled.load(std::memory_order_relaxed))
+        {
+            throw lang::util::execution_aborted(line, "Execution cancelled");
+        }
+
+        if(m_limits.max_steps > 0 && taken > m_limits.max_steps)
+        {
+            throw lang::util::execution_aborted(line, "Execution budget of " + std::to_string(m_limits.max_steps) + " steps exhausted");
+        }
+
+        if(m_limits.timeout.count() > 0 && std::chrono::steady_clock::now() >= m_deadline)
+        {
+            throw lang::util::execution_aborted(line, "Deadline of " + std::to_string(m_limits.timeout.count()) + " ms exceeded");
+        }
+
+        this->reload_step_counter();
+    }
+
+    std::size_t Interpreter::inline_cache_count() const
+    {
+        return m_inline_caches.size();
+    }
+
+    const std::vector<std::string>& Interpreter::errors() const
+    {
+        return m_errors;
+    }
+
+    lang::env::Environment* Interpreter::builtins()
+    {
+        return m_builtins.get();
+    }
+
+    lang::env::Environment* Interpreter::globals()
+    {
+        return m_globals;
+    }
+
+    void Interpreter::adopt_callable(lang::util::LLCallable* callable)
+    {
+        m_temp_llcallables.push_back(callable);
+    }
+
+    void Interpreter::adopt_class(lang::util::LLClass* klass)
+    {
+        m_temp_llclasses.push_back(klass);
+    }
+
+    lang::tasks::Scheduler& Interpreter::scheduler()
+    {
+        return (m_scheduler != nullptr) ? *m_scheduler : lang::tasks::Scheduler::shared();
+    }
+
+    void Interpreter::set_scheduler(lang::tasks::Scheduler* scheduler)
+    {
+        m_scheduler = scheduler;
+    }
+
+    void Interpreter::set_programs(std::vector<std::shared_ptr<const void>> programs)
+    {
+        m_programs = std::move(programs);
+    }
+
+    const std::vector<std::shared_ptr<const void>>& Interpreter::programs() const
+    {
+        return m_programs;
+    }
+
+    std::uint64_t Interpreter::adopt_task(std::shared_ptr<lang::tasks::Task> task)
+    {
+        std::uint64_t handle = m_next_task_handle++;
+        m_tasks.emplace(handle, std::move(task));
+
+        return handle;
+    }
+
+    std::shared_ptr<lang::tasks::Task> Interpreter::take_task(std::uint64_t handle)
+    {
+        auto it = m_tasks.find(handle);
+        if(it == m_tasks.end())
+        {
+            return nullptr;
+        }
+
+        std::shared_ptr<lang::tasks::Task> task = std::move(it->second);
+        m_tasks.erase(it);
+
+        return task;
+    }
+
+    void Interpreter::cancel()
+    {
+        m_cancelled.store(true, std::memory_order_relaxed);
+    }
+
+    bool Interpreter::cancelled() const
+    {
+        return m_cancelled.load(std::memory_order_relaxed);
+    }
+
+    void Interpreter::cancel_tasks()
+    {
+        /* All of them are told first, so they stop in parallel */
+        for(const auto& [handle, task]: m_tasks)
+        {
+            task->interpreter->cancel();
+        }
+
+        for(const auto& [handle, task]: m_tasks)
+        {
+            this->scheduler().wait(*task);
+        }
+
+        m_tasks.clear();
+    }
+
+    void Interpreter::release_run_state()
+    {
+        this->cancel_tasks();
+
+        /* Values stored in the environments may hold instances and functions, so the environments go first */
+        m_environment = nullptr;
+        m_globals = nullptr;
+        m_temp_envs.clear();
+
+        for(auto const& func_pointer: m_temp_llcallables)
+        {
+            delete func_pointer;
+        }
+        m_temp_llcallables.clear();
+
+        for(auto const& class_pointer: m_temp_llclasses)
+        {
+            delete class_pointer;
+        }
+        m_temp_llclasses.clear();
+    }
+
+    const lang::util::object_t* Interpreter::get_global(std::string_view name)
+    {
+        if(m_globals == nullptr)
+        {
+            return nullptr;
+        }
+
+        return m_globals->find_local(name);
+    }
+
+    void Interpreter::set_output(std::unique_ptr<lang::OutputSink> sink)
+    {
+        m_output->flush();
+        m_output = std::move(sink);
+    }
+
+    void Interpreter::set_output(std::ostream& out)
+    {
+        this->set_output(std::make_unique<lang::StreamSink>(out));
+    }
+
+    lang::OutputSink& Interpreter::output()
+    {
+        return *m_output;
+    }
+
+    lang::env::Environment* Interpreter::make_environment(lang::env::Environment* enclosing)
+    {
+        lang::memory::Scope memory_scope(lang::memory::Subsystem::ENVIRONMENTS);
+
+        auto environment = std::make_unique<lang::env::Environment>(enclosing);
+        lang::env::Environment* temp = environment.get();
+
+        m_temp_envs.emplace_back(std::move(environment));
+
+        return temp;
+    }
+
+    void Interpreter::define_native(std::string_view name, size_t arity, lang::util::LLCallable::native_fn_t call_fn, void (*native_target)())
+    {
+        lang::util::LLCallable* native_callable = new lang::util::LLCallable(this, nullptr, true, arity, call_fn, nullptr);
+        native_callable->native_target = native_target;
+        native_callable->native_name = std::string(name);
+
+        m_builtins->define(name, native_callable);
+
+        m_builtin_llcallables.push_back(native_callable);
+    }
+
+    void Interpreter::register_raw_native(std::string_view name, size_t arity, bool variadic, lang::util::LLCallable::native_fn_t call_fn)
+    {
+        this->define_native(name, arity, call_fn, nullptr);
+
+        m_builtin_llcallables.back()->flag_is_variadic = variadic;
+        m_builtin_llcallables.back()->flag_takes_callable = true;
     }
 
     lang::util::object_t Interpreter::evaluate(lang::ast::Expression* expression)
     {
+        LANG_PROFILE_EXPRESSION(m_line_profiler, expression);
         return expression->accept(this);
     }
 
     void Interpreter::execute(lang::ast::Statement* statement)
     {
+        LANG_PROFILE_STATEMENT(m_line_profiler, statement);
         statement->accept(this);
     }
 
@@ -134,8 +711,8 @@ namespace lang
                     auto* left_data_double = std::get_if<double>(&left);
                     auto* right_data_double = std::get_if<double>(&right);
 
-                    auto* left_data_string = std::get_if<std::string>(&left);
-                    auto* right_data_string = std::get_if<std::string>(&right);
+                    auto* left_data_string = std::get_if<lang::util::LLString>(&left);
+                    auto* right_data_string = std::get_if<lang::util::LLString>(&right);
 
                     if(left_data_double && right_data_double)
                     {
@@ -143,7 +720,8 @@ namespace lang
                     }
                     else if(left_data_string && right_data_string)
                     {
-                        result = (*left_data_string) + (*right_data_string);
+                        /* The right side is appended in place when possible, see LLString */
+                        result = lang::util::LLString::concatenate(*left_data_string, right_data_string->view());
                     }
                     else
                     {
@@ -225,7 +803,9 @@ namespace lang
     void Interpreter::visit(lang::ast::PrintStatement* statement)
     {
         lang::util::object_t value = this->evaluate(statement->expr);
-        std::visit(lang::util::PrintVisitor{}, value); /* This is our language's print statement */
+        m_print_buffer.clear();
+        std::visit(lang::util::PrintVisitor{m_print_buffer}, value); /* This is our language's print statement */
+        m_output->write(m_print_buffer);
 
         return;
     }
@@ -274,21 +854,68 @@ namespace lang
 
     void Interpreter::visit(lang::ast::BlockStatement* statement)
     {
-        auto environment = std::make_unique<lang::env::Environment>(m_environment);
-        lang::env::Environment* temp = environment.get();
-
-        m_temp_envs.emplace_back(std::move(environment));
+        lang::FrameEnvironment environment(*this, m_environment, statement->scope_escapes);
 
-        this->execute_block(statement->statements, temp);
+        this->execute_block(statement->statements, environment.get());
     }
 
     void Interpreter::visit(lang::ast::FunctionStatement* statement)
     {
-        lang::util::LLCallable* user_defined_function_callable = new lang::util::LLCallable(this, statement, false, statement->params.size(), nullptr, m_environment);
+        /* With upvalues the function only needs the global variables from its scope */
+        lang::env::Environment* closure = statement->captures_environment ? m_environment : m_environment->global_environment();
+
+        lang::util::LLCallable* user_defined_function_callable = new lang::util::LLCallable(this, statement, false, statement->params.size(), nullptr, closure);
         
         m_environment->define(statement->name.m_lexeme, user_defined_function_callable);
         
         m_temp_llcallables.push_back(user_defined_function_callable);
+
+        /* After the definition, so a recursive function captures itself */
+        if(!statement->captures.empty())
+        {
+            this->capture_upvalues(user_defined_function_callable);
+        }
+    }
+
+    void Interpreter::capture_upvalues(lang::util::LLCallable* function)
+    {
+        const auto& captures = function->function_declaration_statement->captures;
+
+        lang::memory::Scope memory_scope(lang::memory::Subsystem::CALLABLES);
+        function->upvalues.reserve(captures.size());
+
+        for(const auto& capture: captures)
+        {
+            if(capture.enclosing_index >= 0)
+            {
+                function->upvalues.push_back((*m_upvalues)[capture.enclosing_index]);
+                continue;
+            }
+
+            lang::env::Environment* environment = m_environment;
+            lang::util::object_t* variable = environment->find_local(capture.name);
+            while(variable == nullptr && environment->enclosing() != nullptr)
+            {
+                environment = environment->enclosing();
+                variable = environment->find_local(capture.name);
+            }
+
+            /* The resolver only captures variables declared before the function */
+            if(variable == nullptr)
+            {
+                this->generate_error(function->function_declaration_statement->name.m_line, "Undefined variable '" + std::string(capture.name) + "'.");
+            }
+
+            if(environment->is_pooled())
+            {
+                function->upvalues.push_back(m_environment_stack.capture(environment, variable));
+            }
+            else
+            {
+                /* A heap environment lives until the end of the run, its upvalues stay open */
+                function->upvalues.push_back(std::allocate_shared<lang::util::Upvalue>(lang::env::upvalue_allocator_t{}, variable, environment));
+            }
+        }
     }
 
     void Interpreter::visit(lang::ast::WhileStatement* statement)
@@ -310,6 +937,8 @@ namespace lang
         {
             this->execute(statement->body);
 
+            this->count_step(statement->keyword.m_line);
+
             /*********************************************************************************************************************/
             temp_evaluated_condition_result = this->evaluate(statement->condition);
             temp_truthy_value = this->is_truthy(temp_evaluated_condition_result);
@@ -322,9 +951,90 @@ namespace lang
                 /* If our lang::util::object_t contains anything except lang::util::null then it is a TRUTHY */
                 bool_result = true;
             }
-            /*********************************************************************************************************************/
+            /*********************************************************************************************************************/
+
+        }
+    }
+
+    void Interpreter::visit(lang::ast::NumericForStatement* statement)
+    {
+        lang::util::object_t initial_value = this->evaluate(statement->initializer);
+
+        /* Same scoping as the desugared loop: the variable lives in an environment around the whole loop */
+        lang::FrameEnvironment environment(*this, m_environment, statement->scope_escapes);
+        lang::env::Environment* loop_environment = environment.get();
+
+        loop_environment->define(statement->name.m_lexeme, initial_value);
+
+        lang::env::Environment* temp_env = m_environment;
+        try
+        {
+            m_environment = loop_environment;
+
+            if(auto* data = std::get_if<double>(&initial_value))
+            {
+                this->run_numeric_for(statement, loop_environment->find_local(statement->name.m_lexeme), *data);
+            }
+            else
+            {
+                this->execute(statement->generic_loop);
+            }
+        }
+        catch(...)
+        {
+            /* finally */
+            m_environment = temp_env; /* Restore back our environment */
+
+            throw;
+        }
+
+        /* finally */
+        m_environment = temp_env; /* Restore back our environment */
+    }
+
+    void Interpreter::run_numeric_for(lang::ast::NumericForStatement* statement, lang::util::object_t* slot, double counter)
+    {
+        while(true)
+        {
+            lang::util::object_t limit_value = this->evaluate(statement->limit);
+            auto* limit = std::get_if<double>(&limit_value);
+            if(limit == nullptr)
+            {
+                this->generate_error(statement->comparison.m_line, "For loop limit must be a number.");
+            }
+
+            bool condition_result{false};
+            switch(statement->comparison.m_type)
+            {
+                case lang::TokenType::LESS: condition_result = counter < *limit; break;
+                case lang::TokenType::LESS_EQUAL: condition_result = counter <= *limit; break;
+                case lang::TokenType::GREATER: condition_result = counter > *limit; break;
+                case lang::TokenType::GREATER_EQUAL: condition_result = counter >= *limit; break;
+                default: break;
+            }
+
+            if(!condition_result)
+            {
+                break;
+            }
+
+            /* The body sees (and may change) the variable through the environment */
+            *slot = counter;
+
+            this->execute(statement->body);
+
+            auto* data = std::get_if<double>(slot);
+            if(data == nullptr)
+            {
+                this->generate_error(statement->name.m_line, "For loop variable '" + std::string(statement->name.m_lexeme) + "' must be a number.");
+            }
 
+            counter = *data + statement->step;
+
+            this->count_step(statement->name.m_line);
         }
+
+        *slot = counter;
     }
 
     void Interpreter::visit(lang::ast::ReturnStatement* statement)
@@ -356,6 +1066,13 @@ namespace lang
             
             throw;
         }
+        catch(const lang::util::execution_aborted& e)
+        {
+            /* finally */
+            m_environment = temp_env; /* Restore back our environment */
+
+            throw;
+        }
         catch(...)
         {
             
@@ -367,6 +1084,26 @@ namespace lang
 
     lang::util::object_t Interpreter::visit(lang::ast::VariableExpression* expression)
     {
+        if(expression->upvalue_index >= 0)
+        {
+            return *(*m_upvalues)[expression->upvalue_index]->location;
+        }
+
+        if(expression->global_slot >= 0)
+        {
+            lang::util::object_t* variable = m_environment->global_variable(expression->global_slot);
+            if(variable == nullptr)
+            {
+                variable = m_environment->bind_global(expression->global_slot, expression->name.m_lexeme);
+            }
+
+            /* An undefined one is reported by the lookup by name */
+            if(variable != nullptr)
+            {
+                return *variable;
+            }
+        }
+
         lang::util::object_t value = lang::util::null;
         try
         {
@@ -384,6 +1121,27 @@ namespace lang
     {
         lang::util::object_t value = this->evaluate(expression->value);
 
+        if(expression->upvalue_index >= 0)
+        {
+            *(*m_upvalues)[expression->upvalue_index]->location = value;
+            return value;
+        }
+
+        if(expression->global_slot >= 0)
+        {
+            lang::util::object_t* variable = m_environment->global_variable(expression->global_slot);
+            if(variable == nullptr)
+            {
+                variable = m_environment->bind_global(expression->global_slot, expression->name.m_lexeme);
+            }
+
+            if(variable != nullptr)
+            {
+                *variable = value;
+                return value;
+            }
+        }
+
         try
         {
             m_environment->assign(expression->name, value);
@@ -439,12 +1197,43 @@ namespace lang
 
     lang::util::object_t Interpreter::visit(lang::ast::CallExpression* expression)
     {
-        lang::util::object_t callee = this->evaluate(expression->callee);
+        /* The instance of a method that is called without binding it */
+        std::shared_ptr<lang::util::LLInstance> receiver;
+        lang::util::LLCallable* method = nullptr;
 
-        std::vector<lang::util::object_t> evaluated_arguments_value;
+        lang::util::object_t callee = lang::util::null;
+        if(expression->get_callee != nullptr)
+        {
+            LANG_PROFILE_EXPRESSION(m_line_profiler, expression->callee);
+            callee = this->get_property(expression->get_callee, receiver, method);
+        }
+        else if(expression->super_callee != nullptr)
+        {
+            LANG_PROFILE_EXPRESSION(m_line_profiler, expression->callee);
+            method = this->find_super_method(expression->super_callee, receiver);
+        }
+        else
+        {
+            callee = this->evaluate(expression->callee);
+        }
+
+        if(method != nullptr)
+        {
+            callee = method;
+        }
+
+        /* The arguments live in this frame, the callee gets a view of them */
+        lang::util::ArgumentBuffer evaluated_arguments_value(expression->arguments.size());
         for(auto const& argument: expression->arguments)
         {
-            evaluated_arguments_value.emplace_back(this->evaluate(argument));
+            evaluated_arguments_value.push_back(this->evaluate(argument));
+        }
+
+        lang::util::Arguments arguments = evaluated_arguments_value.view();
+
+        if(auto* data = std::get_if<lang::util::LLClass*>(&callee))
+        {
+            return this->call_class(*data, arguments, expression->closing_paren.m_line);
         }
 
         lang::util::LLCallable* function = nullptr;
@@ -457,14 +1246,362 @@ namespace lang
             this->generate_error(expression->closing_paren.m_line, "Can only call functions");
         }
 
-        if(evaluated_arguments_value.size() != function->arity)
+        if(function->flag_is_variadic && arguments.size < function->arity)
+        {
+            std::stringstream buffer;
+            buffer << "Expected at least " << function->arity << " arguments but got " << arguments.size << ".";
+            
+            this->generate_error(expression->closing_paren.m_line, buffer.str());
+        }
+        else if(!function->flag_is_variadic && arguments.size != function->arity)
         {
             std::stringstream buffer;
-            buffer << "Expected " << function->arity << " arguments but got " << evaluated_arguments_value.size() << ".";
+            buffer << "Expected " << function->arity << " arguments but got " << arguments.size << ".";
             
             this->generate_error(expression->closing_paren.m_line, buffer.str());
         }
-        return function->call(std::move(evaluated_arguments_value));
+
+        if(function->flag_is_native_function)
+        {
+            try
+            {
+                return function->call(arguments);
+
+            } catch(const lang::util::native_error& e)
+            {
+                this->generate_error(expression->closing_paren.m_line, e.what());
+            }
+        }
+
+        if(method != nullptr)
+        {
+            return this->call_method(method, receiver, arguments);
+        }
+
+        return function->call(arguments);
+    }
+
+    lang::util::object_t Interpreter::call_class(lang::util::LLClass* klass, lang::util::Arguments arguments, int line)
+    {
+        auto instance = std::make_shared<lang::util::LLInstance>(klass);
+
+        lang::util::LLCallable* initializer = klass->find_method("init");
+        size_t arity = (initializer != nullptr) ? initializer->arity : 0;
+
+        if(arguments.size != arity)
+        {
+            std::stringstream buffer;
+            buffer << "Expected " << arity << " arguments but got " << arguments.size << ".";
+            
+            this->generate_error(line, buffer.str());
+        }
+
+        if(initializer != nullptr)
+        {
+            (void)this->call_method(initializer, instance, arguments);
+        }
+
+        return instance;
+    }
+
+    lang::util::LLCallable* Interpreter::bind_method(lang::util::LLCallable* method, const std::shared_ptr<lang::util::LLInstance>& instance)
+    {
+        lang::env::Environment* environment = this->make_environment(method->closure);
+        environment->define("this", instance);
+
+        lang::util::LLCallable* bound_method = new lang::util::LLCallable(this, method->function_declaration_statement, false, method->arity, nullptr, environment);
+        bound_method->flag_is_initializer = method->flag_is_initializer;
+
+        m_temp_llcallables.push_back(bound_method);
+
+        return bound_method;
+    }
+
+    lang::util::object_t Interpreter::call_method(lang::util::LLCallable* method, const std::shared_ptr<lang::util::LLInstance>& instance, lang::util::Arguments arguments)
+    {
+        lang::FrameEnvironment this_environment(*this, method->closure, method->function_declaration_statement->frame_escapes);
+        this_environment.get()->define("this", instance);
+
+        return method->call(arguments, this_environment.get());
+    }
+
+    void Interpreter::visit(lang::ast::ClassStatement* statement)
+    {
+        lang::util::LLClass* superclass = nullptr;
+        if(statement->superclass != nullptr)
+        {
+            lang::util::object_t value = this->evaluate(statement->superclass);
+            if(auto* data = std::get_if<lang::util::LLClass*>(&value))
+            {
+                superclass = *data;
+            }
+            else
+            {
+                this->generate_error(statement->superclass->name.m_line, "Superclass must be a class.");
+            }
+        }
+
+        m_environment->define(statement->name.m_lexeme, lang::util::null);
+
+        /* With a superclass the methods are closed over an extra environment holding "super" */
+        lang::env::Environment* method_closure = m_environment;
+        if(superclass != nullptr)
+        {
+            method_closure = this->make_environment(m_environment);
+            method_closure->define("super", superclass);
+        }
+
+        /* The method table and the shapes of the class */
+        lang::memory::Scope memory_scope(lang::memory::Subsystem::CALLABLES);
+
+        lang::util::LLClass* klass = new lang::util::LLClass(statement->name.m_lexeme, superclass);
+        m_temp_llclasses.push_back(klass);
+
+        for(auto const& method: statement->methods)
+        {
+            lang::util::LLCallable* method_callable = new lang::util::LLCallable(this, method, false, method->params.size(), nullptr, method_closure);
+            method_callable->flag_is_initializer = (method->name.m_lexeme == "init");
+
+            klass->methods.emplace(std::string(method->name.m_lexeme), method_callable);
+            m_temp_llcallables.push_back(method_callable);
+        }
+
+        m_environment->assign(statement->name, klass);
+    }
+
+    lang::util::object_t Interpreter::visit(lang::ast::GetExpression* expression)
+    {
+        std::shared_ptr<lang::util::LLInstance> instance;
+        lang::util::LLCallable* method = nullptr;
+
+        lang::util::object_t value = this->get_property(expression, instance, method);
+        if(method != nullptr)
+        {
+            return this->bind_method(method, instance);
+        }
+
+        return value;
+    }
+
+    lang::util::object_t Interpreter::get_property(lang::ast::GetExpression* expression, std::shared_ptr<lang::util::LLInstance>& instance, lang::util::LLCallable*& method)
+    {
+        lang::util::object_t object = this->evaluate(expression->object);
+
+        auto* data = std::get_if<std::shared_ptr<lang::util::LLInstance>>(&object);
+        if(data == nullptr)
+        {
+            this->generate_error(expression->name.m_line, "Only instances have properties.");
+        }
+
+        lang::util::LLShape* shape = (*data)->shape;
+
+        const lang::ast::InlineCache::Entry* entry = m_inline_caches[expression->cache_index].find(shape);
+        if(entry == nullptr)
+        {
+            entry = this->lookup_property(expression, shape);
+        }
+
+        if(entry->method != nullptr)
+        {
+            instance = std::move(*data);
+            method = entry->method;
+            return lang::util::null;
+        }
+
+        return (*data)->fields[entry->slot];
+    }
+
+    const lang::ast::InlineCache::Entry* Interpreter::lookup_property(lang::ast::GetExpression* expression, lang::util::LLShape* shape)
+    {
+        lang::ast::InlineCache::Entry entry;
+        entry.shape = shape;
+
+        /* Fields shadow methods */
+        if(const std::size_t* slot = shape->find_field(expression->name.m_lexeme))
+        {
+            entry.slot = *slot;
+        }
+        else if(lang::util::LLCallable* method = shape->klass->find_method(expression->name.m_lexeme))
+        {
+            entry.method = method;
+        }
+        else
+        {
+            this->generate_error(expression->name.m_line, "Undefined property '" + std::string(expression->name.m_lexeme) + "'.");
+        }
+
+        return m_inline_caches[expression->cache_index].insert(entry);
+    }
+
+    lang::util::object_t Interpreter::visit(lang::ast::SetExpression* expression)
+    {
+        lang::util::object_t object = this->evaluate(expression->object);
+
+        auto* instance = std::get_if<std::shared_ptr<lang::util::LLInstance>>(&object);
+        if(instance == nullptr)
+        {
+            this->generate_error(expression->name.m_line, "Only instances have fields.");
+        }
+
+        lang::util::object_t value = this->evaluate(expression->value);
+        lang::util::LLShape* shape = (*instance)->shape;
+
+        const lang::ast::InlineCache::Entry* entry = m_inline_caches[expression->cache_index].find(shape);
+        if(entry == nullptr)
+        {
+            lang::ast::InlineCache::Entry new_entry;
+            new_entry.shape = shape;
+
+            if(const std::size_t* slot = shape->find_field(expression->name.m_lexeme))
+            {
+                new_entry.slot = *slot;
+                new_entry.next_shape = shape;
+            }
+            else
+            {
+                /* The store adds the field, it moves the instance to the next shape */
+                new_entry.slot = shape->field_slots.size();
+                new_entry.next_shape = shape->add_field(expression->name.m_lexeme);
+            }
+
+            entry = m_inline_caches[expression->cache_index].insert(new_entry);
+        }
+
+        if(entry->next_shape != shape)
+        {
+            (*instance)->fields.push_back(value);
+            (*instance)->shape = entry->next_shape;
+        }
+        else
+        {
+            (*instance)->fields[entry->slot] = value;
+        }
+
+        return value;
+    }
+
+    lang::util::object_t Interpreter::visit(lang::ast::ThisExpression* expression)
+    {
+        lang::util::object_t value = lang::util::null;
+        try
+        {
+            value = m_environment->get(expression->keyword);
+
+        } catch(const std::exception& e)
+        {
+            this->generate_error(expression->keyword.m_line, "Can't use 'this' outside of a class.");
+        }
+
+        return value;
+    }
+
+    lang::util::object_t Interpreter::visit(lang::ast::SuperExpression* expression)
+    {
+        std::shared_ptr<lang::util::LLInstance> instance;
+        lang::util::LLCallable* method = this->find_super_method(expression, instance);
+
+        return this->bind_method(method, instance);
+    }
+
+    lang::util::LLCallable* Interpreter::find_super_method(lang::ast::SuperExpression* expression, std::shared_ptr<lang::util::LLInstance>& instance)
+    {
+        lang::util::object_t superclass_value = lang::util::null;
+        lang::util::object_t this_value = lang::util::null;
+        try
+        {
+            superclass_value = m_environment->get(expression->keyword);
+            this_value = m_environment->get(lang::Token{lang::TokenType::THIS, "this", lang::util::null, expression->keyword.m_line});
+
+        } catch(const std::exception& e)
+        {
+            this->generate_error(expression->keyword.m_line, "Can't use 'super' in a class with no superclass.");
+        }
+
+        lang::util::LLClass* superclass = std::get<lang::util::LLClass*>(superclass_value);
+        lang::util::LLCallable* method = superclass->find_method(expression->method.m_lexeme);
+
+        if(method == nullptr)
+        {
+            this->generate_error(expression->method.m_line, "Undefined property '" + std::string(expression->method.m_lexeme) + "'.");
+        }
+
+        instance = std::get<std::shared_ptr<lang::util::LLInstance>>(this_value);
+        return method;
+    }
+
+    lang::util::object_t Interpreter::visit(lang::ast::ArrayExpression* expression)
+    {
+        std::vector<double> values;
+        values.reserve(expression->elements.size());
+
+        for(auto const& element: expression->elements)
+        {
+            lang::util::object_t value = this->evaluate(element);
+
+            if(auto* data = std::get_if<double>(&value))
+            {
+                values.push_back(*data);
+            }
+            else
+            {
+                this->generate_error(expression->closing_bracket.m_line, "Array elements must be numbers");
+            }
+        }
+
+        return std::make_shared<lang::util::LLArray>(std::move(values));
+    }
+
+    lang::util::object_t Interpreter::visit(lang::ast::IndexExpression* expression)
+    {
+        lang::util::object_t object = this->evaluate(expression->object);
+        lang::util::object_t index = this->evaluate(expression->index);
+
+        std::size_t position = this->array_position(object, index, expression->closing_bracket.m_line);
+
+        return std::get<std::shared_ptr<lang::util::LLArray>>(object)->values[position];
+    }
+
+    lang::util::object_t Interpreter::visit(lang::ast::IndexAssignmentExpression* expression)
+    {
+        lang::util::object_t object = this->evaluate(expression->object);
+        lang::util::object_t index = this->evaluate(expression->index);
+        lang::util::object_t value = this->evaluate(expression->value);
+
+        std::size_t position = this->array_position(object, index, expression->closing_bracket.m_line);
+
+        if(auto* data = std::get_if<double>(&value))
+        {
+            std::get<std::shared_ptr<lang::util::LLArray>>(object)->values[position] = *data;
+        }
+        else
+        {
+            this->generate_error(expression->closing_bracket.m_line, "Array elements must be numbers");
+        }
+
+        return value;
+    }
+
+    std::size_t Interpreter::array_position(const lang::util::object_t& object, const lang::util::object_t& index, int line)
+    {
+        auto* array = std::get_if<std::shared_ptr<lang::util::LLArray>>(&object);
+        if(array == nullptr)
+        {
+            this->generate_error(line, "Only arrays can be indexed");
+        }
+
+        /* NaN fails the first check and infinity the second one, so the cast below is always defined */
+        auto* position = std::get_if<double>(&index);
+        if(position == nullptr || !(*position >= 0) || std::floor(*position) != *position)
+        {
+            this->generate_error(line, "Array index must be a non negative integer");
+        }
+
+        if(!std::isfinite(*position) || *position >= static_cast<double>((*array)->values.size()))
+        {
+            this->generate_error(line, "Array index out of range");
+        }
+
+        return static_cast<std::size_t>(*position);
     }
 
     lang::util::object_t Interpreter::is_truthy(const lang::util::object_t& object)
@@ -502,8 +1639,8 @@ namespace lang
         auto *A_data_bool_object = std::get_if<bool>(&object_A);
         auto *B_data_bool_object = std::get_if<bool>(&object_B);
 
-        auto *A_data_string_object = std::get_if<std::string>(&object_A);
-        auto *B_data_string_object = std::get_if<std::string>(&object_B);
+        auto *A_data_string_object = std::get_if<lang::util::LLString>(&object_A);
+        auto *B_data_string_object = std::get_if<lang::util::LLString>(&object_B);
 
         auto *A_data_object_double = std::get_if<double>(&object_A);
         auto *B_data_object_double = std::get_if<double>(&object_B);
@@ -521,6 +1658,40 @@ namespace lang
             return (*A_data_object_double) == (*B_data_object_double);
         }
 
+        auto *A_data_array_object = std::get_if<std::shared_ptr<lang::util::LLArray>>(&object_A);
+        auto *B_data_array_object = std::get_if<std::shared_ptr<lang::util::LLArray>>(&object_B);
+
+        if(A_data_array_object && B_data_array_object)
+        {
+            /* Arrays are compared by identity */
+            return (*A_data_array_object) == (*B_data_array_object);
+        }
+
+        auto *A_data_instance_object = std::get_if<std::shared_ptr<lang::util::LLInstance>>(&object_A);
+        auto *B_data_instance_object = std::get_if<std::shared_ptr<lang::util::LLInstance>>(&object_B);
+
+        if(A_data_instance_object && B_data_instance_object)
+        {
+            return (*A_data_instance_object) == (*B_data_instance_object);
+        }
+
+        auto *A_data_class_object = std::get_if<lang::util::LLClass*>(&object_A);
+        auto *B_data_class_object = std::get_if<lang::util::LLClass*>(&object_B);
+
+        if(A_data_class_object && B_data_class_object)
+        {
+            return (*A_data_class_object) == (*B_data_class_object);
+        }
+
+        auto *A_data_map_object = std::get_if<std::shared_ptr<lang::util::LLMap>>(&object_A);
+        auto *B_data_map_object = std::get_if<std::shared_ptr<lang::util::LLMap>>(&object_B);
+
+        if(A_data_map_object && B_data_map_object)
+        {
+            /* Maps are compared by identity */
+            return (*A_data_map_object) == (*B_data_map_object);
+        }
+
         return false;
     }
 
@@ -0,0 +1,60 @@
+#include <isolate/isolate.hpp>
+
+namespace lang
+{
+    Isolate::Isolate()
+    {
+        auto sink = std::make_unique<lang::MemorySink>();
+        m_output = sink.get();
+
+        m_runtime.set_output(std::move(sink));
+    }
+
+    ExecutionResult Isolate::execute(const CompiledProgram& program, const lang::globals_t& globals)
+    {
+        return m_runtime.execute(program, globals);
+    }
+
+    std::string Isolate::take_output()
+    {
+        return m_output->take();
+    }
+
+    void Isolate::set_limits(const lang::ExecutionLimits& limits)
+    {
+        m_runtime.set_limits(limits);
+    }
+
+    const lang::util::object_t* Isolate::get_global(std::string_view name)
+    {
+        return m_runtime.get_global(name);
+    }
+
+    ScriptRunner::ScriptRunner(std::size_t thread_count) : m_pool(thread_count)
+    {
+        for(std::size_t worker = 0; worker < m_pool.size(); worker++)
+        {
+            m_isolates.emplace_back(std::make_unique<Isolate>());
+        }
+    }
+
+    std::vector<ScriptResult> ScriptRunner::run(const std::vector<Script>& scripts)
+    {
+        std::vector<ScriptResult> results(scripts.size());
+
+        m_pool.parallel_for(scripts.size(), [&](std::size_t worker, std::size_t index)
+        {
+            Isolate& isolate = *m_isolates[worker];
+
+            results[index].errors = isolate.execute(*scripts[index].program, scripts[index].globals).errors;
+            results[index].output = isolate.take_output();
+        });
+
+        return results;
+    }
+
+    std::size_t ScriptRunner::thread_count() const
+    {
+        return m_pool.size();
+    }
+}
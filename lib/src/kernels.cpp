@@ -0,0 +1,94 @@
+#include <kernels/kernels.hpp>
+
+/*
+    This file is always compiled with -O3 -fopenmp-simd (see lib/CMakeLists.txt), even in a Debug build.
+    The "omp simd" pragmas allow the compiler to reorder the floating point reductions so they can be vectorized.
+    On x86-64 every kernel is also cloned for AVX2 and the best version is picked at load time.
+*/
+#if defined(__GNUC__) && defined(__x86_64__)
+    #define LANG_SIMD_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+    #define LANG_SIMD_CLONES
+#endif
+
+namespace lang
+{
+    namespace kernels
+    {
+        LANG_SIMD_CLONES
+        double sum(const double* data, std::size_t size)
+        {
+            double result{0};
+
+            #pragma omp simd reduction(+:result)
+            for(std::size_t i = 0; i < size; i++)
+            {
+                result += data[i];
+            }
+
+            return result;
+        }
+
+        LANG_SIMD_CLONES
+        double dot(const double* a, const double* b, std::size_t size)
+        {
+            double result{0};
+
+            #pragma omp simd reduction(+:result)
+            for(std::size_t i = 0; i < size; i++)
+            {
+                result += a[i] * b[i];
+            }
+
+            return result;
+        }
+
+        LANG_SIMD_CLONES
+        double min(const double* data, std::size_t size)
+        {
+            double result = data[0];
+
+            #pragma omp simd reduction(min:result)
+            for(std::size_t i = 1; i < size; i++)
+            {
+                result = data[i] < result ? data[i] : result;
+            }
+
+            return result;
+        }
+
+        LANG_SIMD_CLONES
+        double max(const double* data, std::size_t size)
+        {
+            double result = data[0];
+
+            #pragma omp simd reduction(max:result)
+            for(std::size_t i = 1; i < size; i++)
+            {
+                result = data[i] > result ? data[i] : result;
+            }
+
+            return result;
+        }
+
+        LANG_SIMD_CLONES
+        void scale(const double* data, double factor, double* out, std::size_t size)
+        {
+            #pragma omp simd
+            for(std::size_t i = 0; i < size; i++)
+            {
+                out[i] = data[i] * factor;
+            }
+        }
+
+        LANG_SIMD_CLONES
+        void add(const double* a, const double* b, double* out, std::size_t size)
+        {
+            #pragma omp simd
+            for(std::size_t i = 0; i < size; i++)
+            {
+                out[i] = a[i] + b[i];
+            }
+        }
+    }
+}
@@ -1,8 +1,9 @@
 #include <lang/lang.hpp>
+#include <snapshot/snapshot.hpp>
 
 namespace lang
 {
-    void Lang::run_source_code(const char* absolute_path_of_source_code)
+    void Lang::run_source_code(const char* absolute_path_of_source_code, const lang::snapshot::Snapshot* snapshot)
     {
         std::ifstream file(absolute_path_of_source_code);
 
@@ -23,52 +24,191 @@ namespace lang
         file.close();
         
         /* run the file contents */
-        this->run(std::move(file_content));
+        this->run(std::move(file_content), snapshot);
     }
 
-    void Lang::run(std::string&& source)
+    const std::vector<lang::ast::Statement*>& CompiledProgram::statements() const
     {
-        /********************************************************************************************************/
-        auto [tokens, tokenization_errors] = m_lexer->tokenize(std::move(source));
-        
-        if(tokenization_errors.size() > 0)
+        return m_statements;
+    }
+
+    std::size_t CompiledProgram::inline_cache_count() const
+    {
+        return m_parser->inline_cache_count();
+    }
+
+    const std::vector<lang::ast::FunctionStatement*>& CompiledProgram::functions() const
+    {
+        return m_parser->functions();
+    }
+
+    const std::vector<std::string>& CompiledProgram::tokenization_errors() const
+    {
+        return m_tokenization_errors;
+    }
+
+    const std::vector<std::string>& CompiledProgram::parsing_errors() const
+    {
+        return m_parsing_errors;
+    }
+
+    const std::string& CompiledProgram::source() const
+    {
+        return m_lexer->source();
+    }
+
+    bool CompiledProgram::ok() const
+    {
+        return m_tokenization_errors.empty() && m_parsing_errors.empty() && !m_statements.empty();
+    }
+
+    std::shared_ptr<const CompiledProgram> Lang::compile(std::string source, const CompiledProgram* previous)
+    {
+        auto program = std::make_shared<CompiledProgram>();
+        program->m_previous = (previous != nullptr) ? previous->shared_from_this() : nullptr;
+
+        auto [tokens, tokenization_errors] = program->m_lexer->tokenize(std::move(source));
+        program->m_tokenization_errors = std::move(tokenization_errors);
+
+        if(program->m_tokenization_errors.size() > 0)
         {
-            std::cout << "\nERROR FOUND DURING TOKENIZATION:\n";
-            for(const auto& error: tokenization_errors)
-            {
-                std::cout << error << "\n";
-            }
-            
-            return;
+            return program;
+        }
+
+        auto [statements, parsing_errors] = (previous != nullptr)
+            ? program->m_parser->parse(std::move(tokens), previous->inline_cache_count(), previous->m_parser->symbols())
+            : program->m_parser->parse(std::move(tokens));
+        program->m_statements = std::move(statements);
+        program->m_parsing_errors = std::move(parsing_errors);
+
+        return program;
+    }
+
+    ExecutionResult Lang::execute(const CompiledProgram& program, const lang::globals_t& globals)
+    {
+        if(!program.ok())
+        {
+            return ExecutionResult{{"The program has tokenization or parsing errors"}};
         }
 
-        /********************************************************************************************************/
-        auto [statements, parsing_errors] = m_parser->parse(std::move(tokens));
+        m_interpreter->set_programs({program.weak_from_this().lock()});
+
+        return ExecutionResult{m_interpreter->interpret(program.statements(), program.inline_cache_count(), globals)};
+    }
+
+    ExecutionResult Lang::execute(const CompiledProgram& program, const lang::snapshot::Snapshot& snapshot, const lang::globals_t& globals)
+    {
+        if(!program.ok())
+        {
+            return ExecutionResult{{"The program has tokenization or parsing errors"}};
+        }
+
+        /* Its global names must have the ids of the prelude's ones, or the two would read each other's variables */
+        if(program.m_previous.get() != &snapshot.prelude())
+        {
+            return ExecutionResult{{"The program was not compiled by Snapshot::compile of this snapshot"}};
+        }
+
+        /* The functions of the prelude run too */
+        m_interpreter->set_programs({program.weak_from_this().lock(), snapshot.prelude().weak_from_this().lock()});
+
+        m_interpreter->begin_run(program.inline_cache_count());
+        snapshot.restore(*m_interpreter);
 
-        if(statements.size() == 0 || parsing_errors.size() > 0)
+        for(const auto& [name, value]: globals)
         {
-            std::cout << "\nERROR FOUND DURING PARSING:\n";
-            for(const auto& error: parsing_errors)
+            m_interpreter->globals()->define(name, value);
+        }
+
+        return ExecutionResult{m_interpreter->continue_run(program.statements())};
+    }
+
+    const lang::util::object_t* Lang::get_global(std::string_view name)
+    {
+        return m_interpreter->get_global(name);
+    }
+
+    void Lang::set_output(std::unique_ptr<lang::OutputSink> sink)
+    {
+        m_interpreter->set_output(std::move(sink));
+    }
+
+    void Lang::set_output(std::ostream& out)
+    {
+        m_interpreter->set_output(out);
+    }
+
+    void Lang::set_limits(const lang::ExecutionLimits& limits)
+    {
+        m_interpreter->set_limits(limits);
+    }
+
+    void Lang::set_shadow_stack(lang::profiler::ShadowStack* shadow_stack)
+    {
+        m_interpreter->set_shadow_stack(shadow_stack);
+    }
+
+    void Lang::set_line_profiler(lang::profiler::LineProfiler* line_profiler)
+    {
+        m_interpreter->set_line_profiler(line_profiler);
+    }
+
+    const CompiledProgram* Lang::last_program() const
+    {
+        return m_program.get();
+    }
+
+    void Lang::set_scheduler(lang::tasks::Scheduler* scheduler)
+    {
+        m_interpreter->set_scheduler(scheduler);
+    }
+
+    void Lang::write_compile_errors(const CompiledProgram& program, std::ostream& out)
+    {
+        if(program.tokenization_errors().size() > 0)
+        {
+            out << "\nERROR FOUND DURING TOKENIZATION:\n";
+            for(const auto& error: program.tokenization_errors())
             {
-                std::cout << error << "\n";
+                out << error << "\n";
             }
             
             return;
         }
-        
-        /********************************************************************************************************/
 
-        auto evaluation_errors = m_interpreter->interpret(std::move(statements));
+        if(program.statements().size() == 0 || program.parsing_errors().size() > 0)
+        {
+            out << "\nERROR FOUND DURING PARSING:\n";
+            for(const auto& error: program.parsing_errors())
+            {
+                out << error << "\n";
+            }
+        }
+    }
 
-        if(evaluation_errors.size() > 0)
+    void Lang::write_execution_errors(const ExecutionResult& result, std::ostream& out)
+    {
+        if(result.errors.size() > 0)
         {
-            std::cout << "\nERROR FOUND DURING EVALUATION:\n";
-            for(const auto& error: evaluation_errors)
+            out << "\nERROR FOUND DURING EVALUATION:\n";
+            for(const auto& error: result.errors)
             {
-                std::cout << error << "\n";
+                out << error << "\n";
             }
-            
+        }
+    }
+
+    void Lang::run(std::string&& source, const lang::snapshot::Snapshot* snapshot)
+    {
+        m_program = (snapshot != nullptr) ? snapshot->compile(std::move(source)) : Lang::compile(std::move(source));
+        const CompiledProgram* program = m_program.get();
+
+        if(!program->ok())
+        {
+            Lang::write_compile_errors(*program, std::cout);
             return;
         }
+
+        Lang::write_execution_errors((snapshot != nullptr) ? this->execute(*program, *snapshot) : this->execute(*program), std::cout);
     }
 }
\ No newline at end of file
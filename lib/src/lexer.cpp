@@ -1,9 +1,12 @@
 #include <lexer/lexer.hpp>
+#include <memory/memory.hpp>
 
 namespace lang
 {
     std::pair<std::vector<lang::Token>, std::vector<std::string>> Lexer::tokenize(std::string&& source)
     {   
+        lang::memory::Scope memory_scope(lang::memory::Subsystem::TOKENS);
+
         /* Initialize */
         m_source = std::move(source);
         m_source_size = m_source.size();
@@ -38,6 +41,11 @@ namespace lang
         );
     }
 
+    const std::string& Lexer::source() const
+    {
+        return m_source;
+    }
+
     void Lexer::scan_token()
     {   
         /* advance() is for input and add_token() is for output */
@@ -49,6 +57,8 @@ namespace lang
             case ')': this->add_token(TokenType::RIGHT_PAREN); break;
             case '{': this->add_token(TokenType::LEFT_BRACE); break;
             case '}': this->add_token(TokenType::RIGHT_BRACE); break;
+            case '[': this->add_token(TokenType::LEFT_BRACKET); break;
+            case ']': this->add_token(TokenType::RIGHT_BRACKET); break;
             case ',': this->add_token(TokenType::COMMA); break;
             case '.': this->add_token(TokenType::DOT); break;
             case '-': this->add_token(TokenType::MINUS); break;
@@ -139,20 +149,61 @@ namespace lang
         }
 
         int length = m_current - m_start;
-        std::string text = m_source.substr(m_start, length);
-        TokenType type{};
+        std::string_view text = std::string_view(m_source).substr(m_start, length);
+        TokenType type = Lexer::identifier_type(text);
+        
+        this->add_token(type);
+    }
 
-        auto it = m_keywords.find(text);
-        if(it != m_keywords.end())
+    TokenType Lexer::identifier_type(std::string_view text)
+    {
+        switch(text[0])
         {
-            type = it->second;
+            case 'a': return Lexer::check_keyword(text, 1, "nd", TokenType::AND);
+            case 'c': return Lexer::check_keyword(text, 1, "lass", TokenType::CLASS);
+            case 'e': return Lexer::check_keyword(text, 1, "lse", TokenType::ELSE);
+            case 'f':
+                if(text.size() > 1)
+                {
+                    switch(text[1])
+                    {
+                        case 'a': return Lexer::check_keyword(text, 2, "lse", TokenType::FALSE);
+                        case 'o': return Lexer::check_keyword(text, 2, "r", TokenType::FOR);
+                        case 'u': return Lexer::check_keyword(text, 2, "n", TokenType::FUN);
+                    }
+                }
+                break;
+            case 'i': return Lexer::check_keyword(text, 1, "f", TokenType::IF);
+            case 'n': return Lexer::check_keyword(text, 1, "il", TokenType::NIL);
+            case 'o': return Lexer::check_keyword(text, 1, "r", TokenType::OR);
+            case 'p': return Lexer::check_keyword(text, 1, "rint", TokenType::PRINT);
+            case 'r': return Lexer::check_keyword(text, 1, "eturn", TokenType::RETURN);
+            case 's': return Lexer::check_keyword(text, 1, "uper", TokenType::SUPER);
+            case 't':
+                if(text.size() > 1)
+                {
+                    switch(text[1])
+                    {
+                        case 'h': return Lexer::check_keyword(text, 2, "is", TokenType::THIS);
+                        case 'r': return Lexer::check_keyword(text, 2, "ue", TokenType::TRUE);
+                    }
+                }
+                break;
+            case 'v': return Lexer::check_keyword(text, 1, "ar", TokenType::VAR);
+            case 'w': return Lexer::check_keyword(text, 1, "hile", TokenType::WHILE);
         }
-        else
+
+        return TokenType::IDENTIFIER;
+    }
+
+    TokenType Lexer::check_keyword(std::string_view text, std::size_t start, std::string_view rest, TokenType type)
+    {
+        if(text.size() == start + rest.size() && text.substr(start) == rest)
         {
-            type = TokenType::IDENTIFIER;
+            return type;
         }
-        
-        this->add_token(type);
+
+        return TokenType::IDENTIFIER;
     }
 
     /*
@@ -172,6 +223,8 @@ namespace lang
         if(this->peek() == '.' && this->is_digit(this->peekNext()))
         {
             /* Consume the "." */
+            this->advance();
+
             while(this->is_digit(this->peek()))
             {
                 this->advance();
@@ -189,8 +242,19 @@ namespace lang
         */
 
 
-        int length = m_current - m_start;
-        this->add_token(TokenType::NUMBER, std::stod(m_source.substr(m_start, length)));
+        /* std::from_chars parses straight from the source buffer, there is no temporary std::string like std::stod needs */
+        double value{0};
+        const char* first = m_source.data() + m_start;
+        const char* last = m_source.data() + m_current;
+        auto [ptr, ec] = std::from_chars(first, last, value);
+
+        if(ec != std::errc{} || ptr != last)
+        {
+            this->generate_error(m_line, "Invalid number literal");
+            return;
+        }
+
+        this->add_token(TokenType::NUMBER, value);
     }
 
     void Lexer::read_string_literal()
@@ -220,10 +284,11 @@ namespace lang
         /* Consume the closing " */
         this->advance();
 
-        /* Trim the starting quote and ending quote */
-        int length = (m_current - 1) - (m_start + 1);
-        std::string value = m_source.substr(m_start + 1, length);
-        this->add_token(TokenType::STRING, value);
+        /* 
+            The lexeme keeps the starting quote and ending quote. The contents are taken as a view
+            with Token::string_contents() when the parser builds the LiteralExpression
+        */
+        this->add_token(TokenType::STRING);
     }
 
     /* It consumes the next character in the source file and returns it */
@@ -283,9 +348,9 @@ namespace lang
     void Lexer::add_token(TokenType type, lang::util::object_t literal)
     {
         int length = m_current - m_start;
-        std::string extracted_lexeme = m_source.substr(m_start, length);
+        std::string_view extracted_lexeme = std::string_view(m_source).substr(m_start, length);
 
-        m_tokens.emplace_back(Token{type, extracted_lexeme, literal, m_line});
+        m_tokens.emplace_back(type, extracted_lexeme, literal, m_line);
     }
 
     /* It returns true if current reaches end of file */
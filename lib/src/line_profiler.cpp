@@ -0,0 +1,472 @@
+#include <profiler/line_profiler.hpp>
+#include <ast/ast.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <unordered_set>
+
+namespace lang
+{
+    namespace profiler
+    {
+        namespace
+        {
+            struct NodeInfo
+            {
+                const void* node;
+                const char* kind;
+                int line;
+                bool is_statement;
+            };
+
+            /*
+                It lists the nodes of a program in source order with the line each one is on: the line of its own
+                token (an operator, a name, a keyword) or else of its first child. A node with no token in its
+                subtree (a literal) gets the line of the last token before it.
+            */
+            class NodeDescriber: public lang::ast::BaseVisitorForExpression, public lang::ast::BaseVisitorForStatement
+            {
+                public:
+                    std::vector<NodeInfo> describe(const std::vector<lang::ast::Statement*>& statements)
+                    {
+                        for(auto* statement: statements)
+                        {
+                            this->statement(statement);
+                        }
+
+                        return std::move(m_nodes);
+                    }
+
+                private:
+                    /* The line of the node or 0 if it has no token in its subtree */
+                    int statement(lang::ast::Statement* statement)
+                    {
+                        if(statement == nullptr)
+                        {
+                            return 0;
+                        }
+
+                        m_line = 0;
+                        statement->accept(this);
+                        return m_line;
+                    }
+
+                    int expression(lang::ast::Expression* expression)
+                    {
+                        if(expression == nullptr)
+                        {
+                            return 0;
+                        }
+
+                        m_line = 0;
+                        expression->accept(this);
+                        return m_line;
+                    }
+
+                    /* The place of the node in the list, its parent comes before it. NO_SLOT for a node already listed */
+                    std::size_t open(const void* node)
+                    {
+                        /* The body of a numeric for loop is shared with its generic fallback */
+                        if(!m_seen.insert(node).second)
+                        {
+                            return NO_SLOT;
+                        }
+
+                        m_nodes.push_back(NodeInfo{node, nullptr, 0, false});
+                        return m_nodes.size() - 1;
+                    }
+
+                    /* A token of the node that comes before its children in the source */
+                    void note(int line)
+                    {
+                        m_last_token_line = std::max(m_last_token_line, line);
+                    }
+
+                    /* own_line is 0 for a node without a token of its own */
+                    void record(std::size_t slot, const char* kind, int own_line, int first_child_line, bool is_statement)
+                    {
+                        int line = (own_line != 0) ? own_line : (first_child_line != 0) ? first_child_line : m_last_token_line;
+                        if(own_line != 0)
+                        {
+                            this->note(own_line);
+                        }
+
+                        if(slot != NO_SLOT)
+                        {
+                            m_nodes[slot] = NodeInfo{m_nodes[slot].node, kind, line, is_statement};
+                        }
+
+                        m_line = line;
+                    }
+
+                    lang::util::object_t visit(lang::ast::BinaryExpression* expression) override
+                    {
+                        std::size_t slot = this->open(expression);
+                        int line = this->expression(expression->left);
+                        this->note(expression->op.m_line);
+                        this->expression(expression->right);
+                        this->record(slot, "binary", expression->op.m_line, line, false);
+                        return {};
+                    }
+
+                    lang::util::object_t visit(lang::ast::GroupingExpression* expression) override
+                    {
+                        std::size_t slot = this->open(expression);
+                        this->record(slot, "grouping", 0, this->expression(expression->expr), false);
+                        return {};
+                    }
+
+                    lang::util::object_t visit(lang::ast::LiteralExpression* expression) override
+                    {
+                        std::size_t slot = this->open(expression);
+                        this->record(slot, "literal", 0, 0, false);
+                        return {};
+                    }
+
+                    lang::util::object_t visit(lang::ast::UnaryExpression* expression) override
+                    {
+                        std::size_t slot = this->open(expression);
+                        this->note(expression->op.m_line);
+                        this->expression(expression->value);
+                        this->record(slot, "unary", expression->op.m_line, 0, false);
+                        return {};
+                    }
+
+                    lang::util::object_t visit(lang::ast::VariableExpression* expression) override
+                    {
+                        std::size_t slot = this->open(expression);
+                        this->record(slot, "variable", expression->name.m_line, 0, false);
+                        return {};
+                    }
+
+                    lang::util::object_t visit(lang::ast::AssignmentExpression* expression) override
+                    {
+                        std::size_t slot = this->open(expression);
+                        this->note(expression->name.m_line);
+                        this->expression(expression->value);
+                        this->record(slot, "assignment", expression->name.m_line, 0, false);
+                        return {};
+                    }
+
+                    lang::util::object_t visit(lang::ast::LogicalExpression* expression) override
+                    {
+                        std::size_t slot = this->open(expression);
+                        int line = this->expression(expression->left);
+                        this->note(expression->op.m_line);
+                        this->expression(expression->right);
+                        this->record(slot, "logical", expression->op.m_line, line, false);
+                        return {};
+                    }
+
+                    lang::util::object_t visit(lang::ast::CallExpression* expression) override
+                    {
+                        std::size_t slot = this->open(expression);
+                        int line = this->expression(expression->callee);
+                        for(auto* argument: expression->arguments)
+                        {
+                            this->expression(argument);
+                        }
+
+                        /* The closing parenthesis can be lines after the callee */
+                        this->record(slot, "call", line, expression->closing_paren.m_line, false);
+                        return {};
+                    }
+
+                    lang::util::object_t visit(lang::ast::ArrayExpression* expression) override
+                    {
+                        std::size_t slot = this->open(expression);
+                        int line{0};
+                        for(auto* element: expression->elements)
+                        {
+                            int element_line = this->expression(element);
+                            line = (line != 0) ? line : element_line;
+                        }
+
+                        this->record(slot, "array", line, expression->closing_bracket.m_line, false);
+                        return {};
+                    }
+
+                    lang::util::object_t visit(lang::ast::IndexExpression* expression) override
+                    {
+                        std::size_t slot = this->open(expression);
+                        int line = this->expression(expression->object);
+                        this->expression(expression->index);
+                        this->record(slot, "index", line, expression->closing_bracket.m_line, false);
+                        return {};
+                    }
+
+                    lang::util::object_t visit(lang::ast::IndexAssignmentExpression* expression) override
+                    {
+                        std::size_t slot = this->open(expression);
+                        int line = this->expression(expression->object);
+                        this->expression(expression->index);
+                        this->expression(expression->value);
+                        this->record(slot, "index assignment", line, expression->closing_bracket.m_line, false);
+                        return {};
+                    }
+
+                    lang::util::object_t visit(lang::ast::GetExpression* expression) override
+                    {
+                        std::size_t slot = this->open(expression);
+                        this->expression(expression->object);
+                        this->record(slot, "property get", expression->name.m_line, 0, false);
+                        return {};
+                    }
+
+                    lang::util::object_t visit(lang::ast::SetExpression* expression) override
+                    {
+                        std::size_t slot = this->open(expression);
+                        this->expression(expression->object);
+                        int line = expression->name.m_line;
+                        this->note(line);
+                        this->expression(expression->value);
+                        this->record(slot, "property set", line, 0, false);
+                        return {};
+                    }
+
+                    lang::util::object_t visit(lang::ast::ThisExpression* expression) override
+                    {
+                        std::size_t slot = this->open(expression);
+                        this->record(slot, "this", expression->keyword.m_line, 0, false);
+                        return {};
+                    }
+
+                    lang::util::object_t visit(lang::ast::SuperExpression* expression) override
+                    {
+                        std::size_t slot = this->open(expression);
+                        this->record(slot, "super", expression->keyword.m_line, 0, false);
+                        return {};
+                    }
+
+                    void visit(lang::ast::ExpressionStatement* statement) override
+                    {
+                        std::size_t slot = this->open(statement);
+                        this->record(slot, "expression statement", 0, this->expression(statement->expr), true);
+                    }
+
+                    void visit(lang::ast::PrintStatement* statement) override
+                    {
+                        std::size_t slot = this->open(statement);
+                        this->record(slot, "print", 0, this->expression(statement->expr), true);
+                    }
+
+                    void visit(lang::ast::VarStatement* statement) override
+                    {
+                        std::size_t slot = this->open(statement);
+                        int line = statement->name.m_line;
+                        this->note(line);
+                        this->expression(statement->initializer);
+                        this->record(slot, "var", line, 0, true);
+                    }
+
+                    void visit(lang::ast::BlockStatement* statement) override
+                    {
+                        std::size_t slot = this->open(statement);
+                        int line{0};
+                        for(auto* inner: statement->statements)
+                        {
+                            int inner_line = this->statement(inner);
+                            line = (line != 0) ? line : inner_line;
+                        }
+
+                        this->record(slot, "block", 0, line, true);
+                    }
+
+                    void visit(lang::ast::IfStatement* statement) override
+                    {
+                        std::size_t slot = this->open(statement);
+                        int line = this->expression(statement->condition);
+                        this->statement(statement->thenBranch);
+                        this->statement(statement->elseBranch);
+                        this->record(slot, "if", 0, line, true);
+                    }
+
+                    void visit(lang::ast::WhileStatement* statement) override
+                    {
+                        std::size_t slot = this->open(statement);
+                        int line = statement->keyword.m_line;
+                        this->note(line);
+                        this->expression(statement->condition);
+                        this->statement(statement->body);
+                        this->record(slot, (statement->keyword.m_lexeme == "for") ? "for" : "while", line, 0, true);
+                    }
+
+                    void visit(lang::ast::FunctionStatement* statement) override
+                    {
+                        std::size_t slot = this->open(statement);
+                        int line = statement->name.m_line;
+                        this->note(line);
+                        for(auto* inner: statement->body_stmts)
+                        {
+                            this->statement(inner);
+                        }
+
+                        this->record(slot, "fun", line, 0, true);
+                    }
+
+                    void visit(lang::ast::ReturnStatement* statement) override
+                    {
+                        std::size_t slot = this->open(statement);
+                        int line = statement->keyword.m_line;
+                        this->note(line);
+                        this->expression(statement->value);
+                        this->record(slot, "return", line, 0, true);
+                    }
+
+                    void visit(lang::ast::NumericForStatement* statement) override
+                    {
+                        std::size_t slot = this->open(statement);
+                        int line = statement->name.m_line;
+                        this->note(line);
+                        this->expression(statement->initializer);
+                        this->expression(statement->limit);
+                        this->statement(statement->body);
+                        this->statement(statement->generic_loop);
+                        this->record(slot, "numeric for", line, 0, true);
+                    }
+
+                    void visit(lang::ast::ClassStatement* statement) override
+                    {
+                        std::size_t slot = this->open(statement);
+                        int line = statement->name.m_line;
+                        this->note(line);
+                        this->expression(statement->superclass);
+                        for(auto* method: statement->methods)
+                        {
+                            this->statement(method);
+                        }
+
+                        this->record(slot, "class", line, 0, true);
+                    }
+
+                private:
+                    static constexpr std::size_t NO_SLOT = static_cast<std::size_t>(-1);
+
+                    std::vector<NodeInfo> m_nodes;
+                    std::unordered_set<const void*> m_seen;
+
+                    int m_line{0};            /* the line of the node visited last */
+                    int m_last_token_line{0};
+            };
+
+            struct LineTotals
+            {
+                std::uint64_t statements{0};
+                std::uint64_t expressions{0};
+                std::chrono::nanoseconds self_time{0};
+            };
+
+            std::vector<std::string_view> split_lines(std::string_view source)
+            {
+                std::vector<std::string_view> lines;
+
+                while(!source.empty())
+                {
+                    std::size_t end = source.find('\n');
+                    std::string_view line = source.substr(0, end);
+
+                    std::size_t first = line.find_first_not_of(" \t");
+                    line = (first == std::string_view::npos) ? std::string_view{} : line.substr(first);
+                    if(!line.empty() && line.back() == '\r')
+                    {
+                        line.remove_suffix(1);
+                    }
+
+                    lines.push_back(line);
+                    source = (end == std::string_view::npos) ? std::string_view{} : source.substr(end + 1);
+                }
+
+                return lines;
+            }
+
+            double to_milliseconds(std::chrono::nanoseconds time)
+            {
+                return std::chrono::duration<double, std::milli>(time).count();
+            }
+        }
+
+        void LineProfiler::write_report(std::ostream& out, const std::vector<lang::ast::Statement*>& statements, std::string_view source, const std::string& source_name) const
+        {
+            std::vector<NodeInfo> nodes = NodeDescriber{}.describe(statements);
+            std::vector<std::string_view> source_lines = split_lines(source);
+
+            std::map<int, LineTotals> lines;
+            std::uint64_t statement_count{0};
+            std::uint64_t expression_count{0};
+            std::chrono::nanoseconds total_time{0};
+
+            std::uint64_t matched_count{0};
+            for(const auto& info: nodes)
+            {
+                auto found = m_nodes.find(info.node);
+                if(found == m_nodes.end())
+                {
+                    continue;
+                }
+
+                LineTotals& totals = lines[info.line];
+                (info.is_statement ? totals.statements : totals.expressions) += found->second.count;
+                totals.self_time += found->second.self_time;
+
+                (info.is_statement ? statement_count : expression_count) += found->second.count;
+                total_time += found->second.self_time;
+                matched_count++;
+            }
+
+            char row[256];
+
+            std::snprintf(row, sizeof(row), "LINE PROFILE OF %s: %llu statements and %llu expressions in %.3f ms\n", source_name.c_str(), static_cast<unsigned long long>(statement_count), static_cast<unsigned long long>(expression_count), to_milliseconds(total_time));
+            out << row;
+
+            if(matched_count < m_nodes.size())
+            {
+                out << (m_nodes.size() - matched_count) << " nodes of another program (a snapshot prelude) also ran and are not shown\n";
+            }
+
+            /* The annotated source, the hottest line first */
+            std::vector<std::pair<int, LineTotals>> hot_lines(lines.begin(), lines.end());
+            std::stable_sort(hot_lines.begin(), hot_lines.end(), [](const auto& a, const auto& b){
+                if(a.second.self_time != b.second.self_time)
+                {
+                    return a.second.self_time > b.second.self_time;
+                }
+                return (a.second.statements + a.second.expressions) > (b.second.statements + b.second.expressions);
+            });
+
+            out << "\nHOT LINES (self time, the hottest first)\n";
+            out << "     time ms       %   statements  expressions   line\n";
+            for(const auto& [line, totals]: hot_lines)
+            {
+                double share = (total_time.count() > 0) ? 100.0 * static_cast<double>(totals.self_time.count()) / static_cast<double>(total_time.count()) : 0.0;
+                std::string_view text = (line >= 1 && static_cast<std::size_t>(line) <= source_lines.size()) ? source_lines[line - 1] : std::string_view{};
+
+                std::snprintf(row, sizeof(row), "%12.3f  %5.1f%%  %11llu  %11llu  %5d | ", to_milliseconds(totals.self_time), share, static_cast<unsigned long long>(totals.statements), static_cast<unsigned long long>(totals.expressions), line);
+                out << row << text << "\n";
+            }
+
+            /* Every node that ran, in source order */
+            std::stable_sort(nodes.begin(), nodes.end(), [](const NodeInfo& a, const NodeInfo& b){ return a.line < b.line; });
+
+            out << "\nNODE COUNTS (by line)\n";
+            out << "   line  node                        count\n";
+            for(const auto& info: nodes)
+            {
+                auto found = m_nodes.find(info.node);
+                if(found == m_nodes.end())
+                {
+                    continue;
+                }
+
+                std::snprintf(row, sizeof(row), "  %5d  %-22s %11llu\n", info.line, info.kind, static_cast<unsigned long long>(found->second.count));
+                out << row;
+            }
+        }
+
+        void LineProfiler::clear()
+        {
+            m_nodes.clear();
+            m_running.clear();
+        }
+    }
+}
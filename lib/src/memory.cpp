@@ -0,0 +1,186 @@
+#include <memory/memory.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace lang
+{
+    namespace memory
+    {
+        namespace
+        {
+            thread_local AllocationCounters tls_counters;
+
+            /* In front of every block, it keeps the payload aligned like malloc does */
+            struct alignas(16) BlockHeader
+            {
+                std::size_t size;
+                Subsystem subsystem;
+                bool counted; /* allocated while the accounting was enabled */
+            };
+
+            static_assert(sizeof(BlockHeader) == 16 && __STDCPP_DEFAULT_NEW_ALIGNMENT__ <= alignof(BlockHeader));
+
+            /* One cache line per subsystem, threads working in different subsystems do not contend */
+            struct alignas(64) SharedCounters
+            {
+                std::atomic<std::int64_t> current_bytes{0};
+                std::atomic<std::int64_t> peak_bytes{0};
+                std::atomic<std::uint64_t> total_bytes{0};
+                std::atomic<std::uint64_t> allocations{0};
+                std::atomic<std::uint64_t> deallocations{0};
+            };
+
+            constexpr std::size_t SUBSYSTEM_COUNT = static_cast<std::size_t>(Subsystem::COUNT);
+
+            /* The subsystems and, last, their sum. Constant initialized, so they work for allocations before main() */
+            SharedCounters shared_counters[SUBSYSTEM_COUNT + 1];
+
+            std::atomic<bool> is_accounting_enabled{false};
+
+            void raise_peak(SharedCounters& counters, std::int64_t current)
+            {
+                std::int64_t peak = counters.peak_bytes.load(std::memory_order_relaxed);
+                while(current > peak && !counters.peak_bytes.compare_exchange_weak(peak, current, std::memory_order_relaxed))
+                {}
+            }
+
+            void count_allocation(SharedCounters& counters, std::size_t size)
+            {
+                std::int64_t bytes = static_cast<std::int64_t>(size);
+                raise_peak(counters, counters.current_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+                counters.total_bytes.fetch_add(size, std::memory_order_relaxed);
+                counters.allocations.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            void count_deallocation(SharedCounters& counters, std::size_t size)
+            {
+                counters.current_bytes.fetch_sub(static_cast<std::int64_t>(size), std::memory_order_relaxed);
+                counters.deallocations.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            SubsystemStats read(const SharedCounters& counters)
+            {
+                SubsystemStats stats;
+                stats.current_bytes = counters.current_bytes.load(std::memory_order_relaxed);
+                stats.peak_bytes = counters.peak_bytes.load(std::memory_order_relaxed);
+                stats.total_bytes = counters.total_bytes.load(std::memory_order_relaxed);
+                stats.allocations = counters.allocations.load(std::memory_order_relaxed);
+                stats.deallocations = counters.deallocations.load(std::memory_order_relaxed);
+                return stats;
+            }
+        }
+
+        AllocationCounters thread_counters()
+        {
+            return tls_counters;
+        }
+
+        const char* subsystem_name(Subsystem subsystem)
+        {
+            switch(subsystem)
+            {
+                case Subsystem::OTHER: return "other";
+                case Subsystem::TOKENS: return "tokens";
+                case Subsystem::AST: return "ast";
+                case Subsystem::ENVIRONMENTS: return "environments";
+                case Subsystem::CALLABLES: return "callables";
+                case Subsystem::STRINGS: return "strings";
+                case Subsystem::COUNT: break;
+            }
+
+            return "";
+        }
+
+        void* allocate(std::size_t size, Subsystem subsystem)
+        {
+            void* memory = std::malloc(sizeof(BlockHeader) + size);
+            if(memory == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+
+            tls_counters.allocations++;
+            tls_counters.allocated_bytes += size;
+
+            BlockHeader* header = ::new (memory) BlockHeader{size, subsystem, is_accounting_enabled.load(std::memory_order_relaxed)};
+            if(header->counted)
+            {
+                count_allocation(shared_counters[static_cast<std::size_t>(subsystem)], size);
+                count_allocation(shared_counters[SUBSYSTEM_COUNT], size);
+            }
+
+            return header + 1;
+        }
+
+        void deallocate(void* memory) noexcept
+        {
+            if(memory == nullptr)
+            {
+                return;
+            }
+
+            tls_counters.deallocations++;
+
+            BlockHeader* header = static_cast<BlockHeader*>(memory) - 1;
+            if(header->counted)
+            {
+                count_deallocation(shared_counters[static_cast<std::size_t>(header->subsystem)], header->size);
+                count_deallocation(shared_counters[SUBSYSTEM_COUNT], header->size);
+            }
+
+            std::free(header);
+        }
+
+        void enable_accounting()
+        {
+            is_accounting_enabled.store(true, std::memory_order_relaxed);
+        }
+
+        bool accounting_enabled()
+        {
+            return is_accounting_enabled.load(std::memory_order_relaxed);
+        }
+
+        SubsystemStats stats(Subsystem subsystem)
+        {
+            return read(shared_counters[static_cast<std::size_t>(subsystem)]);
+        }
+
+        SubsystemStats total_stats()
+        {
+            return read(shared_counters[SUBSYSTEM_COUNT]);
+        }
+
+        void reset_peaks()
+        {
+            for(auto& counters: shared_counters)
+            {
+                counters.peak_bytes.store(counters.current_bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+        }
+
+        void write_report(std::ostream& out)
+        {
+            char row[256];
+
+            out << "MEMORY BY SUBSYSTEM (bytes requested)\n";
+            out << "  subsystem          current          peak            total   allocations  deallocations\n";
+
+            auto write_row = [&](const char* name, const SubsystemStats& stats){
+                std::snprintf(row, sizeof(row), "  %-12s  %12lld  %12lld  %15llu  %12llu  %13llu\n", name,
+                    static_cast<long long>(stats.current_bytes), static_cast<long long>(stats.peak_bytes), static_cast<unsigned long long>(stats.total_bytes),
+                    static_cast<unsigned long long>(stats.allocations), static_cast<unsigned long long>(stats.deallocations));
+                out << row;
+            };
+
+            for(std::size_t i = 0; i < SUBSYSTEM_COUNT; i++)
+            {
+                write_row(subsystem_name(static_cast<Subsystem>(i)), stats(static_cast<Subsystem>(i)));
+            }
+            write_row("total", total_stats());
+        }
+    }
+}
@@ -0,0 +1,23 @@
+#include <memory/memory.hpp>
+
+#include <new>
+
+/*
+    Replacements of the global allocation functions, see lang::memory. They are not part of lang_lib: only the
+    programs that link lang_memory_hooks count every allocation. The array and nothrow forms of the standard
+    library forward to these ones, the aligned forms are left alone.
+*/
+void* operator new(std::size_t size)
+{
+    return lang::memory::allocate(size, lang::memory::tls_subsystem);
+}
+
+void operator delete(void* memory) noexcept
+{
+    lang::memory::deallocate(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    lang::memory::deallocate(memory);
+}
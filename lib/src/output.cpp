@@ -0,0 +1,106 @@
+#include <output/output.hpp>
+
+#include <stdexcept>
+#include <utility>
+
+namespace lang
+{
+    BufferedFileSink::BufferedFileSink(std::FILE* file, FlushPolicy policy, std::size_t capacity)
+        : m_file(file), m_policy(policy), m_capacity(capacity)
+    {
+        m_buffer.reserve(m_capacity);
+    }
+
+    BufferedFileSink::~BufferedFileSink()
+    {
+        this->flush();
+    }
+
+    void BufferedFileSink::write(std::string_view text)
+    {
+        if(m_buffer.size() + text.size() > m_capacity)
+        {
+            this->flush();
+
+            /* It would not fit even in the empty buffer */
+            if(text.size() > m_capacity)
+            {
+                std::fwrite(text.data(), 1, text.size(), m_file);
+                return;
+            }
+        }
+
+        m_buffer.append(text);
+
+        if(m_policy == FlushPolicy::EVERY_LINE && !text.empty() && text.back() == '\n')
+        {
+            this->flush();
+        }
+    }
+
+    void BufferedFileSink::flush()
+    {
+        if(m_file == nullptr)
+        {
+            return;
+        }
+
+        if(!m_buffer.empty())
+        {
+            std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file);
+            m_buffer.clear();
+        }
+
+        std::fflush(m_file);
+    }
+
+    StdoutSink::StdoutSink(FlushPolicy policy)
+        : BufferedFileSink(stdout, policy)
+    {}
+
+    FileSink::FileSink(const std::string& path, FlushPolicy policy)
+        : BufferedFileSink(std::fopen(path.c_str(), "wb"), policy)
+    {
+        if(m_file == nullptr)
+        {
+            throw std::runtime_error("Error opening the file " + path);
+        }
+    }
+
+    FileSink::~FileSink()
+    {
+        if(m_file != nullptr)
+        {
+            this->flush();
+            std::fclose(m_file);
+            m_file = nullptr;
+        }
+    }
+
+    void MemorySink::write(std::string_view text)
+    {
+        m_text.append(text);
+    }
+
+    void MemorySink::flush()
+    {}
+
+    std::string MemorySink::take()
+    {
+        return std::exchange(m_text, std::string{});
+    }
+
+    StreamSink::StreamSink(std::ostream& out)
+        : m_out(out)
+    {}
+
+    void StreamSink::write(std::string_view text)
+    {
+        m_out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+
+    void StreamSink::flush()
+    {
+        m_out.flush();
+    }
+}
@@ -0,0 +1,702 @@
+#include <parallel/parallel.hpp>
+#include <tasks/tasks.hpp>
+
+namespace lang
+{
+    namespace parallel
+    {
+        namespace
+        {
+            /* Natives with side effects, or that call a function they get: that function is never checked */
+            bool is_impure_native(const lang::util::LLCallable* native)
+            {
+                return native->flag_takes_callable || native->native_name == "join";
+            }
+
+            /* Natives that modify their first argument */
+            bool is_mutating_native(std::string_view name)
+            {
+                return name == "set" || name == "delete";
+            }
+
+            std::string at_line(int line)
+            {
+                return " at line " + std::to_string(line);
+            }
+        }
+
+        /*****************************************PurityChecker*******************************************/
+        PurityChecker::PurityChecker(lang::util::LLCallable* function) : m_function(function) {}
+
+        std::string PurityChecker::check(lang::util::LLCallable* function)
+        {
+            if(function->flag_is_native_function)
+            {
+                return is_impure_native(function) || is_mutating_native(function->native_name) ? "the native " + function->native_name + "()" : "";
+            }
+
+            if(function->closure->find_local("this") != nullptr)
+            {
+                return "a method";
+            }
+
+            std::unordered_set<const lang::ast::FunctionStatement*> checked{function->function_declaration_statement};
+
+            PurityChecker checker(function);
+            checker.m_checked = &checked;
+            checker.check_function(function->function_declaration_statement);
+
+            return checker.m_failure;
+        }
+
+        void PurityChecker::check_function(lang::ast::FunctionStatement* function)
+        {
+            m_scopes.emplace_back();
+
+            for(const auto& param: function->params)
+            {
+                this->declare(param.m_lexeme, LocalKind::VALUE);
+            }
+
+            this->visit_statements(function->body_stmts);
+
+            m_scopes.pop_back();
+        }
+
+        void PurityChecker::declare(std::string_view name, LocalKind kind)
+        {
+            m_scopes.back()[name] = kind;
+        }
+
+        const PurityChecker::LocalKind* PurityChecker::find_local(std::string_view name) const
+        {
+            for(auto scope = m_scopes.rbegin(); scope != m_scopes.rend(); scope++)
+            {
+                auto it = scope->find(name);
+                if(it != scope->end())
+                {
+                    return &it->second;
+                }
+            }
+
+            return nullptr;
+        }
+
+        lang::util::object_t* PurityChecker::find_variable(std::string_view name) const
+        {
+            const auto& captures = m_function->function_declaration_statement->captures;
+            for(std::size_t i = 0; i < captures.size(); i++)
+            {
+                if(captures[i].name == name)
+                {
+                    return m_function->upvalues[i]->location;
+                }
+            }
+
+            lang::util::object_t* value = nullptr;
+            for(lang::env::Environment* environment = m_function->closure; environment != nullptr && value == nullptr; environment = environment->enclosing())
+            {
+                value = environment->find_local(name);
+            }
+
+            return value;
+        }
+
+        void PurityChecker::fail(std::string reason)
+        {
+            if(m_failure.empty())
+            {
+                m_failure = std::move(reason);
+            }
+        }
+
+        void PurityChecker::visit_statements(const std::vector<lang::ast::Statement*>& statements)
+        {
+            for(const auto& statement: statements)
+            {
+                statement->accept(this);
+            }
+        }
+
+        void PurityChecker::check_call(lang::ast::CallExpression* expression)
+        {
+            int line = expression->closing_paren.m_line;
+
+            auto* variable = dynamic_cast<lang::ast::VariableExpression*>(expression->callee);
+            if(variable == nullptr)
+            {
+                expression->callee->accept(this);
+                this->fail("a call of a computed function" + at_line(line));
+                return;
+            }
+
+            std::string_view name = variable->name.m_lexeme;
+
+            if(const LocalKind* kind = this->find_local(name))
+            {
+                /* Functions declared inside the checked function are checked where they are declared */
+                if(*kind != LocalKind::FUNCTION)
+                {
+                    this->fail("a call of the function value '" + std::string(name) + "'" + at_line(line));
+                }
+                return;
+            }
+
+            lang::util::object_t* value = this->find_variable(name);
+
+            auto* callable = (value != nullptr) ? std::get_if<lang::util::LLCallable*>(value) : nullptr;
+            if(callable == nullptr)
+            {
+                this->fail("a call of '" + std::string(name) + "' which is not a function" + at_line(line));
+                return;
+            }
+
+            lang::util::LLCallable* function = *callable;
+
+            if(function->flag_is_native_function)
+            {
+                /* By the native itself, "name" can be another variable that holds it */
+                if(is_impure_native(function))
+                {
+                    this->fail("a call of " + function->native_name + "()" + at_line(line));
+                }
+                else if(is_mutating_native(function->native_name))
+                {
+                    auto* target = expression->arguments.empty() ? nullptr : dynamic_cast<lang::ast::VariableExpression*>(expression->arguments.front());
+                    if(target == nullptr || this->find_local(target->name.m_lexeme) == nullptr)
+                    {
+                        this->fail("a call of " + function->native_name + "() on a map it did not create" + at_line(line));
+                    }
+                }
+                return;
+            }
+
+            if(function->closure->find_local("this") != nullptr)
+            {
+                this->fail("a call of a method" + at_line(line));
+                return;
+            }
+
+            if(m_checked->insert(function->function_declaration_statement).second)
+            {
+                PurityChecker checker(function);
+                checker.m_checked = m_checked;
+                checker.check_function(function->function_declaration_statement);
+
+                if(!checker.m_failure.empty())
+                {
+                    this->fail(checker.m_failure);
+                }
+            }
+        }
+
+        lang::util::object_t PurityChecker::visit(lang::ast::BinaryExpression* expression)
+        {
+            expression->left->accept(this);
+            expression->right->accept(this);
+
+            return lang::util::null;
+        }
+
+        lang::util::object_t PurityChecker::visit(lang::ast::GroupingExpression* expression)
+        {
+            expression->expr->accept(this);
+
+            return lang::util::null;
+        }
+
+        lang::util::object_t PurityChecker::visit(lang::ast::LiteralExpression*)
+        {
+            return lang::util::null;
+        }
+
+        lang::util::object_t PurityChecker::visit(lang::ast::UnaryExpression* expression)
+        {
+            expression->value->accept(this);
+
+            return lang::util::null;
+        }
+
+        lang::util::object_t PurityChecker::visit(lang::ast::VariableExpression*)
+        {
+            /* Reading any variable is fine, the worker reads its own copy */
+            return lang::util::null;
+        }
+
+        lang::util::object_t PurityChecker::visit(lang::ast::AssignmentExpression* expression)
+        {
+            expression->value->accept(this);
+
+            if(this->find_local(expression->name.m_lexeme) == nullptr)
+            {
+                this->fail("an assignment to the outer variable '" + std::string(expression->name.m_lexeme) + "'" + at_line(expression->name.m_line));
+            }
+
+            return lang::util::null;
+        }
+
+        lang::util::object_t PurityChecker::visit(lang::ast::LogicalExpression* expression)
+        {
+            expression->left->accept(this);
+            expression->right->accept(this);
+
+            return lang::util::null;
+        }
+
+        lang::util::object_t PurityChecker::visit(lang::ast::CallExpression* expression)
+        {
+            for(const auto& argument: expression->arguments)
+            {
+                argument->accept(this);
+            }
+
+            this->check_call(expression);
+
+            return lang::util::null;
+        }
+
+        lang::util::object_t PurityChecker::visit(lang::ast::ArrayExpression* expression)
+        {
+            for(const auto& element: expression->elements)
+            {
+                element->accept(this);
+            }
+
+            return lang::util::null;
+        }
+
+        lang::util::object_t PurityChecker::visit(lang::ast::IndexExpression* expression)
+        {
+            expression->object->accept(this);
+            expression->index->accept(this);
+
+            return lang::util::null;
+        }
+
+        lang::util::object_t PurityChecker::visit(lang::ast::IndexAssignmentExpression* expression)
+        {
+            expression->index->accept(this);
+            expression->value->accept(this);
+
+            auto* target = dynamic_cast<lang::ast::VariableExpression*>(expression->object);
+            if(target == nullptr || this->find_local(target->name.m_lexeme) == nullptr)
+            {
+                this->fail("a store into an array it did not create" + at_line(expression->closing_bracket.m_line));
+            }
+
+            return lang::util::null;
+        }
+
+        lang::util::object_t PurityChecker::visit(lang::ast::GetExpression* expression)
+        {
+            this->fail("a property access" + at_line(expression->name.m_line));
+
+            return lang::util::null;
+        }
+
+        lang::util::object_t PurityChecker::visit(lang::ast::SetExpression* expression)
+        {
+            this->fail("a property store" + at_line(expression->name.m_line));
+
+            return lang::util::null;
+        }
+
+        lang::util::object_t PurityChecker::visit(lang::ast::ThisExpression* expression)
+        {
+            this->fail("a use of this" + at_line(expression->keyword.m_line));
+
+            return lang::util::null;
+        }
+
+        lang::util::object_t PurityChecker::visit(lang::ast::SuperExpression* expression)
+        {
+            this->fail("a use of super" + at_line(expression->keyword.m_line));
+
+            return lang::util::null;
+        }
+
+        void PurityChecker::visit(lang::ast::ExpressionStatement* statement)
+        {
+            statement->expr->accept(this);
+        }
+
+        void PurityChecker::visit(lang::ast::PrintStatement*)
+        {
+            this->fail("a print statement");
+        }
+
+        void PurityChecker::visit(lang::ast::VarStatement* statement)
+        {
+            if(statement->initializer != nullptr)
+            {
+                statement->initializer->accept(this);
+            }
+
+            this->declare(statement->name.m_lexeme, LocalKind::VALUE);
+        }
+
+        void PurityChecker::visit(lang::ast::BlockStatement* statement)
+        {
+            this->visit_statements(statement->statements);
+        }
+
+        void PurityChecker::visit(lang::ast::IfStatement* statement)
+        {
+            statement->condition->accept(this);
+            statement->thenBranch->accept(this);
+
+            if(statement->elseBranch != nullptr)
+            {
+                statement->elseBranch->accept(this);
+            }
+        }
+
+        void PurityChecker::visit(lang::ast::WhileStatement* statement)
+        {
+            statement->condition->accept(this);
+            statement->body->accept(this);
+        }
+
+        void PurityChecker::visit(lang::ast::FunctionStatement* statement)
+        {
+            this->declare(statement->name.m_lexeme, LocalKind::FUNCTION);
+            this->check_function(statement);
+        }
+
+        void PurityChecker::visit(lang::ast::ReturnStatement* statement)
+        {
+            if(statement->value != nullptr)
+            {
+                statement->value->accept(this);
+            }
+        }
+
+        void PurityChecker::visit(lang::ast::NumericForStatement* statement)
+        {
+            /* generic_loop is made of the same nodes */
+            statement->initializer->accept(this);
+            statement->limit->accept(this);
+
+            this->declare(statement->name.m_lexeme, LocalKind::VALUE);
+            statement->body->accept(this);
+        }
+
+        void PurityChecker::visit(lang::ast::ClassStatement* statement)
+        {
+            this->fail("a class declaration" + at_line(statement->name.m_line));
+        }
+
+        /*****************************************native functions*******************************************/
+        namespace
+        {
+            std::mutex pool_mutex;
+            std::unique_ptr<lang::ThreadPool> thread_pool;
+        }
+
+        lang::ThreadPool& pool()
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+
+            if(thread_pool == nullptr)
+            {
+                thread_pool = std::make_unique<lang::ThreadPool>(std::thread::hardware_concurrency());
+            }
+
+            return *thread_pool;
+        }
+
+        void set_thread_count(std::size_t thread_count)
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+
+            thread_pool = std::make_unique<lang::ThreadPool>(thread_count);
+        }
+
+        namespace
+        {
+            /* The interpreter of one worker, with its own copy of the functions */
+            struct WorkerContext
+            {
+                std::unique_ptr<lang::Interpreter> interpreter;
+                lang::util::LLCallable* function = nullptr;
+                lang::util::LLCallable* combine = nullptr;
+            };
+
+            struct Failure
+            {
+                long long index{0};
+                std::string message;
+            };
+
+            lang::util::LLCallable* expect_pure_function(const lang::util::object_t& argument, const char* function_name, std::size_t position, std::size_t arity)
+            {
+                auto* data = std::get_if<lang::util::LLCallable*>(&argument);
+                if(data == nullptr || (*data)->arity != arity)
+                {
+                    throw lang::util::native_error(std::string(function_name) + "() expects a function of " + std::to_string(arity) + " parameters as argument " + std::to_string(position));
+                }
+
+                std::string reason = PurityChecker::check(*data);
+                if(!reason.empty())
+                {
+                    throw lang::util::native_error(std::string(function_name) + "() expects a pure function as argument " + std::to_string(position) + ", found " + reason);
+                }
+
+                return *data;
+            }
+
+            long long expect_integer(const lang::util::object_t& argument, const char* function_name, std::size_t position)
+            {
+                auto* data = std::get_if<double>(&argument);
+                if(data == nullptr || *data != static_cast<double>(static_cast<long long>(*data)))
+                {
+                    throw lang::util::native_error(std::string(function_name) + "() expects an integer as argument " + std::to_string(position));
+                }
+
+                return static_cast<long long>(*data);
+            }
+
+            /*
+                The engine of both natives: the range [start, end) is cut in chunks, chunk(context, first, last)
+                runs one of them on a worker and returns false after a failure it recorded.
+                It throws the failure with the lowest index.
+            */
+            template<typename Chunk>
+            void run_chunks(const char* function_name, lang::Interpreter& caller, lang::util::LLCallable* function, lang::util::LLCallable* combine, long long start, long long end, std::vector<WorkerContext>& contexts, std::vector<Failure>& failures, Chunk&& chunk)
+            {
+                lang::ThreadPool& threads = pool();
+
+                std::size_t count = static_cast<std::size_t>(end - start);
+                std::size_t chunk_count = std::min<std::size_t>(count, threads.size() * 8);
+
+                contexts.resize(threads.size());
+                failures.assign(chunk_count, Failure{-1, ""});
+
+                threads.parallel_for(chunk_count, [&](std::size_t worker, std::size_t chunk_index)
+                {
+                    WorkerContext& context = contexts[worker];
+
+                    /* The caller only waits, so its environments can be read from every worker */
+                    if(context.interpreter == nullptr)
+                    {
+                        context.interpreter = std::make_unique<lang::Interpreter>();
+                        context.interpreter->begin_run(caller.inline_cache_count());
+                        context.interpreter->inherit_limits(caller);
+
+                        lang::tasks::ValueCloner cloner(*context.interpreter);
+                        lang::util::object_t copy;
+
+                        (void)cloner.clone(function, copy);
+                        context.function = std::get<lang::util::LLCallable*>(copy);
+
+                        if(combine != nullptr)
+                        {
+                            (void)cloner.clone(combine, copy);
+                            context.combine = std::get<lang::util::LLCallable*>(copy);
+                        }
+                    }
+
+                    long long first = start + static_cast<long long>(count * chunk_index / chunk_count);
+                    long long last = start + static_cast<long long>(count * (chunk_index + 1) / chunk_count);
+
+                    chunk(context, chunk_index, first, last);
+                });
+
+                /* The workers drew from the budget of the caller's run, what they took since their last check too */
+                for(auto& context: contexts)
+                {
+                    if(context.interpreter != nullptr)
+                    {
+                        context.interpreter->settle_steps();
+                    }
+                }
+                caller.settle_steps();
+
+                for(const auto& failure: failures)
+                {
+                    if(failure.index >= 0)
+                    {
+                        std::string message = failure.message;
+                        if(!message.empty() && message.back() == '\n')
+                        {
+                            message.pop_back();
+                        }
+
+                        throw lang::util::native_error(std::string(function_name) + "() failed for " + std::to_string(failure.index) + ": " + message);
+                    }
+                }
+            }
+
+            /* One call of a worker's copy of a function, false (with the failure recorded) if it failed */
+            bool call_in_worker(WorkerContext& context, lang::util::LLCallable* function, lang::util::Arguments arguments, long long index, Failure& failure, lang::util::object_t& result)
+            {
+                try
+                {
+                    result = function->call(arguments);
+                }
+                catch(const std::exception& e)
+                {
+                    failure = Failure{index, e.what()};
+                    return false;
+                }
+
+                if(!context.interpreter->errors().empty())
+                {
+                    failure = Failure{index, context.interpreter->errors().front()};
+                    return false;
+                }
+
+                return true;
+            }
+
+            /* parallel_map(fn, start, end) */
+            lang::util::object_t native_parallel_map_function(const lang::util::LLCallable* callable, lang::util::Arguments arguments)
+            {
+                lang::util::LLCallable* function = expect_pure_function(arguments[0], "parallel_map", 1, 1);
+                long long start = expect_integer(arguments[1], "parallel_map", 2);
+                long long end = std::max(start, expect_integer(arguments[2], "parallel_map", 3));
+
+                auto result = std::make_shared<lang::util::LLArray>(std::vector<double>(static_cast<std::size_t>(end - start)));
+                std::vector<WorkerContext> contexts;
+                std::vector<Failure> failures;
+
+                run_chunks("parallel_map", *callable->interpreter, function, nullptr, start, end, contexts, failures, [&](WorkerContext& context, std::size_t chunk_index, long long first, long long last)
+                {
+                    for(long long i = first; i < last; i++)
+                    {
+                        lang::util::object_t argument = static_cast<double>(i);
+                        lang::util::object_t value;
+
+                        if(!call_in_worker(context, context.function, lang::util::Arguments{&argument, 1}, i, failures[chunk_index], value))
+                        {
+                            return;
+                        }
+
+                        auto* number = std::get_if<double>(&value);
+                        if(number == nullptr)
+                        {
+                            failures[chunk_index] = Failure{i, "the function must return a number"};
+                            return;
+                        }
+
+                        result->values[static_cast<std::size_t>(i - start)] = *number;
+                    }
+                });
+
+                return result;
+            }
+
+            /* parallel_reduce(fn, start, end) and parallel_reduce(fn, start, end, combine) */
+            lang::util::object_t native_parallel_reduce_function(const lang::util::LLCallable* callable, lang::util::Arguments arguments)
+            {
+                if(arguments.size > 4)
+                {
+                    throw lang::util::native_error("parallel_reduce() expects 3 or 4 arguments");
+                }
+
+                lang::util::LLCallable* function = expect_pure_function(arguments[0], "parallel_reduce", 1, 1);
+                long long start = expect_integer(arguments[1], "parallel_reduce", 2);
+                long long end = std::max(start, expect_integer(arguments[2], "parallel_reduce", 3));
+                lang::util::LLCallable* combine = (arguments.size == 4) ? expect_pure_function(arguments[3], "parallel_reduce", 4, 2) : nullptr;
+
+                lang::Interpreter& caller = *callable->interpreter;
+
+                /* The partial result of every chunk, a value of the worker's interpreter until it is copied */
+                std::vector<lang::util::object_t> partials;
+                std::vector<WorkerContext> contexts;
+                std::vector<Failure> failures;
+
+                std::size_t chunk_count = std::min<std::size_t>(static_cast<std::size_t>(end - start), pool().size() * 8);
+                partials.resize(chunk_count);
+
+                run_chunks("parallel_reduce", caller, function, combine, start, end, contexts, failures, [&](WorkerContext& context, std::size_t chunk_index, long long first, long long last)
+                {
+                    lang::util::object_t accumulator;
+
+                    for(long long i = first; i < last; i++)
+                    {
+                        lang::util::object_t argument = static_cast<double>(i);
+                        lang::util::object_t value;
+
+                        if(!call_in_worker(context, context.function, lang::util::Arguments{&argument, 1}, i, failures[chunk_index], value))
+                        {
+                            return;
+                        }
+
+                        if(i == first)
+                        {
+                            accumulator = std::move(value);
+                        }
+                        else if(combine != nullptr)
+                        {
+                            lang::util::object_t pair[2] = {std::move(accumulator), std::move(value)};
+
+                            if(!call_in_worker(context, context.combine, lang::util::Arguments{pair, 2}, i, failures[chunk_index], accumulator))
+                            {
+                                return;
+                            }
+                        }
+                        else
+                        {
+                            auto* left = std::get_if<double>(&accumulator);
+                            auto* right = std::get_if<double>(&value);
+                            if(left == nullptr || right == nullptr)
+                            {
+                                failures[chunk_index] = Failure{i, "the function must return a number"};
+                                return;
+                            }
+
+                            *left += *right;
+                        }
+                    }
+
+                    if(combine == nullptr && !std::holds_alternative<double>(accumulator))
+                    {
+                        failures[chunk_index] = Failure{first, "the function must return a number"};
+                        return;
+                    }
+
+                    partials[chunk_index] = std::move(accumulator);
+                });
+
+                if(chunk_count == 0)
+                {
+                    return (combine == nullptr) ? lang::util::object_t{0.0} : lang::util::object_t{lang::util::null};
+                }
+
+                /* The partials in the order of the range */
+                lang::util::object_t result;
+                for(std::size_t chunk_index = 0; chunk_index < chunk_count; chunk_index++)
+                {
+                    lang::util::object_t partial;
+                    if(!lang::tasks::ValueCloner(caller).clone(partials[chunk_index], partial))
+                    {
+                        throw lang::util::native_error("parallel_reduce() got a result that cannot be shared between threads");
+                    }
+
+                    if(chunk_index == 0)
+                    {
+                        result = std::move(partial);
+                    }
+                    else if(combine != nullptr)
+                    {
+                        lang::util::object_t pair[2] = {std::move(result), std::move(partial)};
+                        result = combine->call(lang::util::Arguments{pair, 2});
+                    }
+                    else
+                    {
+                        result = std::get<double>(result) + std::get<double>(partial);
+                    }
+                }
+
+                return result;
+            }
+        }
+
+        void register_natives(lang::Interpreter& interpreter)
+        {
+            interpreter.register_raw_native("parallel_map", 3, false, &native_parallel_map_function);
+            interpreter.register_raw_native("parallel_reduce", 3, true, &native_parallel_reduce_function);
+        }
+    }
+}
@@ -1,15 +1,23 @@
 #include <parser/parser.hpp>
+#include <resolver/resolver.hpp>
+#include <memory/memory.hpp>
 
 namespace lang
 {
-    std::pair<std::vector<lang::ast::Statement*>, std::vector<std::string>> Parser::parse(std::vector<lang::Token>&& tokens)
+    std::pair<std::vector<lang::ast::Statement*>, std::vector<std::string>> Parser::parse(std::vector<lang::Token>&& tokens, std::size_t first_inline_cache, lang::env::SymbolTable symbols)
     {
+        lang::memory::Scope memory_scope(lang::memory::Subsystem::AST);
+
         m_tokens = std::move(tokens);
 
         m_current = 0;
         /* It is important because we are moving from this class to outside at the end of tokenize function */
         m_errors = std::vector<std::string>();
         m_temp_exprs.clear();
+        m_interned_strings.clear();
+        m_inline_cache_count = first_inline_cache;
+        m_functions.clear();
+        m_symbols = std::move(symbols);
         m_statements = std::vector<lang::ast::Statement*>();
 
         while(!this->is_at_end())
@@ -17,13 +25,38 @@ namespace lang
             m_statements.emplace_back(this->parse_declaration());
         }
 
+        /* A program with errors never runs, and its statements can be missing */
+        if(m_errors.empty())
+        {
+            lang::Resolver(m_symbols).resolve(m_statements);
+        }
+
         return std::make_pair(std::move(m_statements), std::move(m_errors));;
     }
 
+    std::size_t Parser::inline_cache_count() const
+    {
+        return m_inline_cache_count;
+    }
+
+    const std::vector<lang::ast::FunctionStatement*>& Parser::functions() const
+    {
+        return m_functions;
+    }
+
+    const lang::env::SymbolTable& Parser::symbols() const
+    {
+        return m_symbols;
+    }
+
     lang::ast::Statement* Parser::parse_declaration()
     {
         try
         {
+            if(this->match({lang::TokenType::CLASS}))
+            {
+                return this->parse_class_declaration();
+            }
             if(this->match({lang::TokenType::FUN}))
             {
                 return this->parse_function_statement();
@@ -71,11 +104,46 @@ namespace lang
         lang::ast::FunctionStatement* temp = function_statement.get();
 
         m_temp_stmts.emplace_back(std::move(function_statement));
+        m_functions.push_back(temp);
 
         return temp;
 
     }
 
+    lang::ast::Statement* Parser::parse_class_declaration()
+    {
+        lang::Token name = this->consume(lang::TokenType::IDENTIFIER, "Expect class name.");
+
+        lang::ast::VariableExpression* superclass = nullptr;
+        if(this->match({lang::TokenType::LESS}))
+        {
+            lang::Token superclass_name = this->consume(lang::TokenType::IDENTIFIER, "Expect superclass name.");
+
+            auto variable_expression = std::make_unique<lang::ast::VariableExpression>(superclass_name);
+            superclass = variable_expression.get();
+
+            m_temp_exprs.emplace_back(std::move(variable_expression));
+        }
+
+        (void)this->consume(lang::TokenType::LEFT_BRACE, "Expect '{' before class body.");
+
+        std::vector<lang::ast::FunctionStatement*> methods;
+        while(!this->check(lang::TokenType::RIGHT_BRACE) && !this->is_at_end())
+        {
+            /* A method is a function declaration without the "fun" keyword */
+            methods.emplace_back(static_cast<lang::ast::FunctionStatement*>(this->parse_function_statement()));
+        }
+
+        (void)this->consume(lang::TokenType::RIGHT_BRACE, "Expect '}' after class body.");
+
+        auto class_statement = std::make_unique<lang::ast::ClassStatement>(name, superclass, std::move(methods));
+        lang::ast::Statement* temp = class_statement.get();
+
+        m_temp_stmts.emplace_back(std::move(class_statement));
+
+        return temp;
+    }
+
     lang::ast::Statement* Parser::parse_var_declaration()
     {
         lang::Token name = this->consume(lang::TokenType::IDENTIFIER, "Expect variable name.");
@@ -118,6 +186,11 @@ namespace lang
             return this->parse_while_statement();
         }
 
+        if(this->match({lang::TokenType::FOR}))
+        {
+            return this->parse_for_statement();
+        }
+
         if(this->match({lang::TokenType::LEFT_BRACE}))
         {
             std::vector<lang::ast::Statement*> stmts = this->parse_block();
@@ -153,12 +226,13 @@ namespace lang
 
     lang::ast::Statement* Parser::parse_while_statement()
     {
+        lang::Token keyword = this->previous();
         (void)this->consume(lang::TokenType::LEFT_PAREN, "Expect '(' after 'while'.");
         lang::ast::Expression* condition = this->parse_expression();
         (void)this->consume(lang::TokenType::RIGHT_PAREN, "Expect ')' after condition.");
         lang::ast::Statement* body = this->parse_statement();
 
-        auto while_statement = std::make_unique<lang::ast::WhileStatement>(condition, body);
+        auto while_statement = std::make_unique<lang::ast::WhileStatement>(keyword, condition, body);
         lang::ast::Statement* temp = while_statement.get();
 
         m_temp_stmts.emplace_back(std::move(while_statement));
@@ -166,6 +240,157 @@ namespace lang
         return temp;
     }
 
+    lang::ast::Statement* Parser::parse_for_statement()
+    {
+        lang::Token keyword = this->previous();
+        (void)this->consume(lang::TokenType::LEFT_PAREN, "Expect '(' after 'for'.");
+
+        lang::ast::Statement* initializer = nullptr;
+        if(this->match({lang::TokenType::SEMICOLON}))
+        {
+            initializer = nullptr;
+        }
+        else if(this->match({lang::TokenType::VAR}))
+        {
+            initializer = this->parse_var_declaration();
+        }
+        else
+        {
+            initializer = this->parse_expression_statement();
+        }
+
+        lang::ast::Expression* condition = nullptr;
+        if(!this->check(lang::TokenType::SEMICOLON))
+        {
+            condition = this->parse_expression();
+        }
+        (void)this->consume(lang::TokenType::SEMICOLON, "Expect ';' after loop condition.");
+
+        lang::ast::Expression* increment = nullptr;
+        if(!this->check(lang::TokenType::RIGHT_PAREN))
+        {
+            increment = this->parse_expression();
+        }
+        (void)this->consume(lang::TokenType::RIGHT_PAREN, "Expect ')' after for clauses.");
+
+        lang::ast::Statement* body = this->parse_statement();
+
+        /*
+            The loop is desugared into the statements we already have:
+                { initializer; while (condition) { body; increment; } }
+        */
+        lang::ast::Statement* loop_body = body;
+        if(increment != nullptr)
+        {
+            auto increment_statement = std::make_unique<lang::ast::ExpressionStatement>(increment);
+            std::vector<lang::ast::Statement*> stmts{body, increment_statement.get()};
+            m_temp_stmts.emplace_back(std::move(increment_statement));
+
+            auto block_statement = std::make_unique<lang::ast::BlockStatement>(std::move(stmts));
+            loop_body = block_statement.get();
+            m_temp_stmts.emplace_back(std::move(block_statement));
+        }
+
+        lang::ast::Expression* loop_condition = condition;
+        if(loop_condition == nullptr)
+        {
+            auto literal_expression = std::make_unique<lang::ast::LiteralExpression>(true);
+            loop_condition = literal_expression.get();
+            m_temp_exprs.emplace_back(std::move(literal_expression));
+        }
+
+        auto while_statement = std::make_unique<lang::ast::WhileStatement>(keyword, loop_condition, loop_body);
+        lang::ast::Statement* generic_loop = while_statement.get();
+        m_temp_stmts.emplace_back(std::move(while_statement));
+
+        if(lang::ast::Statement* numeric_for = this->make_numeric_for_statement(initializer, condition, increment, body, generic_loop))
+        {
+            return numeric_for;
+        }
+
+        if(initializer == nullptr)
+        {
+            return generic_loop;
+        }
+
+        std::vector<lang::ast::Statement*> stmts{initializer, generic_loop};
+        auto block_statement = std::make_unique<lang::ast::BlockStatement>(std::move(stmts));
+        lang::ast::Statement* temp = block_statement.get();
+
+        m_temp_stmts.emplace_back(std::move(block_statement));
+
+        return temp;
+    }
+
+    lang::ast::Statement* Parser::make_numeric_for_statement(lang::ast::Statement* initializer, lang::ast::Expression* condition, lang::ast::Expression* increment, lang::ast::Statement* body, lang::ast::Statement* generic_loop)
+    {
+        /* var i = <initializer> */
+        auto* var_statement = dynamic_cast<lang::ast::VarStatement*>(initializer);
+        if(var_statement == nullptr || var_statement->initializer == nullptr)
+        {
+            return nullptr;
+        }
+        std::string_view name = var_statement->name.m_lexeme;
+
+        /* i < limit, i <= limit, i > limit, i >= limit */
+        auto* comparison = dynamic_cast<lang::ast::BinaryExpression*>(condition);
+        if(comparison == nullptr)
+        {
+            return nullptr;
+        }
+
+        auto* compared_variable = dynamic_cast<lang::ast::VariableExpression*>(comparison->left);
+        switch(comparison->op.m_type)
+        {
+            case lang::TokenType::LESS:
+            case lang::TokenType::LESS_EQUAL:
+            case lang::TokenType::GREATER:
+            case lang::TokenType::GREATER_EQUAL:
+                break;
+            default:
+                return nullptr;
+        }
+        if(compared_variable == nullptr || compared_variable->name.m_lexeme != name)
+        {
+            return nullptr;
+        }
+
+        /* i = i + k, i = i - k with a number literal k */
+        auto* assignment = dynamic_cast<lang::ast::AssignmentExpression*>(increment);
+        if(assignment == nullptr || assignment->name.m_lexeme != name)
+        {
+            return nullptr;
+        }
+
+        auto* step_expression = dynamic_cast<lang::ast::BinaryExpression*>(assignment->value);
+        if(step_expression == nullptr || (step_expression->op.m_type != lang::TokenType::PLUS && step_expression->op.m_type != lang::TokenType::MINUS))
+        {
+            return nullptr;
+        }
+
+        auto* stepped_variable = dynamic_cast<lang::ast::VariableExpression*>(step_expression->left);
+        auto* step_literal = dynamic_cast<lang::ast::LiteralExpression*>(step_expression->right);
+        if(stepped_variable == nullptr || stepped_variable->name.m_lexeme != name || step_literal == nullptr)
+        {
+            return nullptr;
+        }
+
+        auto* step = std::get_if<double>(&step_literal->value);
+        if(step == nullptr)
+        {
+            return nullptr;
+        }
+
+        double signed_step = (step_expression->op.m_type == lang::TokenType::PLUS) ? *step : -(*step);
+
+        auto numeric_for_statement = std::make_unique<lang::ast::NumericForStatement>(var_statement->name, var_statement->initializer, comparison->op, comparison->right, signed_step, body, generic_loop);
+        lang::ast::Statement* temp = numeric_for_statement.get();
+
+        m_temp_stmts.emplace_back(std::move(numeric_for_statement));
+
+        return temp;
+    }
+
     lang::ast::Statement* Parser::parse_if_statement()
     {
         (void)this->consume(lang::TokenType::LEFT_PAREN, "Expect '(' after 'if'.");
@@ -253,6 +478,26 @@ namespace lang
                 return temp;
             }
 
+            if(lang::ast::GetExpression* get_expr = dynamic_cast<lang::ast::GetExpression*>(expr))
+            {
+                auto set_expression = std::make_unique<lang::ast::SetExpression>(get_expr->object, get_expr->name, value, get_expr->cache_index);
+                lang::ast::Expression* temp = set_expression.get();
+
+                m_temp_exprs.emplace_back(std::move(set_expression));
+
+                return temp;
+            }
+
+            if(lang::ast::IndexExpression* index_expr = dynamic_cast<lang::ast::IndexExpression*>(expr))
+            {
+                auto index_assignment_expression = std::make_unique<lang::ast::IndexAssignmentExpression>(index_expr->object, index_expr->closing_bracket, index_expr->index, value);
+                lang::ast::Expression* temp = index_assignment_expression.get();
+
+                m_temp_exprs.emplace_back(std::move(index_assignment_expression));
+
+                return temp;
+            }
+
             this->error(equals, "Invalid assignment target");
         }
 
@@ -406,10 +651,30 @@ namespace lang
         }
         */
 
-        while(this->match({lang::TokenType::LEFT_PAREN}))
+        while(true)
         {
-            /* BIGGEST MISTAKE OF YOUR LIFE: "<! lang::ast::Expression* expr !> = this->finish_call(expr);" */
-            expr = this->finish_call(expr);
+            if(this->match({lang::TokenType::LEFT_PAREN}))
+            {
+                /* BIGGEST MISTAKE OF YOUR LIFE: "<! lang::ast::Expression* expr !> = this->finish_call(expr);" */
+                expr = this->finish_call(expr);
+            }
+            else if(this->match({lang::TokenType::LEFT_BRACKET}))
+            {
+                expr = this->finish_index(expr);
+            }
+            else if(this->match({lang::TokenType::DOT}))
+            {
+                lang::Token name = this->consume(lang::TokenType::IDENTIFIER, "Expect property name after '.'.");
+
+                auto get_expression = std::make_unique<lang::ast::GetExpression>(expr, name, m_inline_cache_count++);
+                expr = get_expression.get();
+
+                m_temp_exprs.emplace_back(std::move(get_expression));
+            }
+            else
+            {
+                break;
+            }
         }
 
         return expr;
@@ -436,6 +701,8 @@ namespace lang
         lang::Token paren = this->consume(lang::TokenType::RIGHT_PAREN, "Expect ')' after arguments");
 
         auto call_expression = std::make_unique<lang::ast::CallExpression>(callee, paren, std::move(arguments));
+        call_expression->get_callee = dynamic_cast<lang::ast::GetExpression*>(callee);
+        call_expression->super_callee = dynamic_cast<lang::ast::SuperExpression*>(callee);
         lang::ast::Expression* temp = call_expression.get();
 
         m_temp_exprs.emplace_back(std::move(call_expression));
@@ -443,6 +710,41 @@ namespace lang
         return temp;
     }
 
+    lang::ast::Expression* Parser::finish_index(lang::ast::Expression* object)
+    {
+        lang::ast::Expression* index = this->parse_expression();
+        lang::Token bracket = this->consume(lang::TokenType::RIGHT_BRACKET, "Expect ']' after index");
+
+        auto index_expression = std::make_unique<lang::ast::IndexExpression>(object, bracket, index);
+        lang::ast::Expression* temp = index_expression.get();
+
+        m_temp_exprs.emplace_back(std::move(index_expression));
+
+        return temp;
+    }
+
+    lang::ast::Expression* Parser::finish_array()
+    {
+        std::vector<lang::ast::Expression*> elements;
+        if(!this->check({lang::TokenType::RIGHT_BRACKET}))
+        {
+            do
+            {
+                elements.emplace_back(this->parse_expression());
+
+            } while(this->match({lang::TokenType::COMMA}));
+        }
+
+        lang::Token bracket = this->consume(lang::TokenType::RIGHT_BRACKET, "Expect ']' after array elements");
+
+        auto array_expression = std::make_unique<lang::ast::ArrayExpression>(bracket, std::move(elements));
+        lang::ast::Expression* temp = array_expression.get();
+
+        m_temp_exprs.emplace_back(std::move(array_expression));
+
+        return temp;
+    }
+
     lang::ast::Expression* Parser::parse_primary()
     {
         lang::ast::Expression* expr;
@@ -480,7 +782,7 @@ namespace lang
             return expr;
         }
 
-        if(this->match({lang::TokenType::NUMBER, lang::TokenType::STRING}))
+        if(this->match({lang::TokenType::NUMBER}))
         {
             lang::util::object_t value = this->previous().m_literal;
             auto literal_expression = std::make_unique<lang::ast::LiteralExpression>(value);
@@ -491,6 +793,42 @@ namespace lang
             return expr;
         }
 
+        if(this->match({lang::TokenType::STRING}))
+        {
+            /* The lexer only keeps a view of the string contents, the value is materialized once here */
+            lang::util::object_t value = this->intern_string(this->previous().string_contents());
+            auto literal_expression = std::make_unique<lang::ast::LiteralExpression>(value);
+            expr = literal_expression.get();
+
+            m_temp_exprs.emplace_back(std::move(literal_expression));
+
+            return expr;
+        }
+
+        if(this->match({lang::TokenType::THIS}))
+        {
+            auto this_expression = std::make_unique<lang::ast::ThisExpression>(this->previous());
+            expr = this_expression.get();
+
+            m_temp_exprs.emplace_back(std::move(this_expression));
+
+            return expr;
+        }
+
+        if(this->match({lang::TokenType::SUPER}))
+        {
+            lang::Token keyword = this->previous();
+            (void)this->consume(lang::TokenType::DOT, "Expect '.' after 'super'.");
+            lang::Token method = this->consume(lang::TokenType::IDENTIFIER, "Expect superclass method name.");
+
+            auto super_expression = std::make_unique<lang::ast::SuperExpression>(keyword, method);
+            expr = super_expression.get();
+
+            m_temp_exprs.emplace_back(std::move(super_expression));
+
+            return expr;
+        }
+
         if(this->match({lang::TokenType::IDENTIFIER}))
         {
             auto variable_expression = std::make_unique<lang::ast::VariableExpression>(this->previous());
@@ -501,6 +839,11 @@ namespace lang
             return expr;
         }
 
+        if(this->match({lang::TokenType::LEFT_BRACKET}))
+        {
+            return this->finish_array();
+        }
+
         if(this->match({lang::TokenType::LEFT_PAREN}))
         {
             expr = this->parse_expression();
@@ -519,6 +862,17 @@ namespace lang
         return nullptr; // Unreachable
     }
 
+    const lang::util::LLString& Parser::intern_string(std::string_view contents)
+    {
+        auto it = m_interned_strings.find(contents);
+        if(it == m_interned_strings.end())
+        {
+            it = m_interned_strings.emplace(contents, lang::util::LLString(contents)).first;
+        }
+
+        return it->second;
+    }
+
     lang::Token Parser::consume(lang::TokenType type, std::string message)
     {
         if(this->check(type))
@@ -539,7 +893,7 @@ namespace lang
         }
         else
         {
-            this->generate_error(token.m_line, " at '" + token.m_lexeme + "' " + message);
+            this->generate_error(token.m_line, " at '" + std::string(token.m_lexeme) + "' " + message);
         }
 
         throw lang::util::parser_error("Parser Error Caught");
@@ -0,0 +1,223 @@
+#include <profiler/profiler.hpp>
+#include <ast/ast.hpp>
+
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <map>
+#include <stdexcept>
+
+namespace lang
+{
+    namespace profiler
+    {
+        namespace
+        {
+            std::atomic<Profiler*> active_profiler{nullptr};
+
+            /* Set on the thread that started the profiler, a SIGPROF sent to the process can arrive on any thread */
+            thread_local bool tls_is_profiled_thread = false;
+
+            void set_timer(timer_t timer, std::chrono::microseconds interval)
+            {
+                itimerspec spec{};
+                spec.it_interval.tv_sec = static_cast<time_t>(interval.count() / 1000000);
+                spec.it_interval.tv_nsec = static_cast<long>(interval.count() % 1000000) * 1000;
+                spec.it_value = spec.it_interval;
+
+                (void)::timer_settime(timer, 0, &spec, nullptr);
+            }
+        }
+
+        Profiler::Profiler(std::string source_name, std::chrono::microseconds interval)
+            : m_source_name(std::move(source_name)), m_interval(interval), m_table(TABLE_SIZE, StackEntry{0, 0, 0, 0}), m_frame_pool(FRAME_POOL_SIZE, nullptr)
+        {}
+
+        Profiler::~Profiler()
+        {
+            this->stop();
+        }
+
+        ShadowStack& Profiler::shadow_stack()
+        {
+            return m_shadow_stack;
+        }
+
+        void Profiler::start()
+        {
+            Profiler* expected = nullptr;
+            if(!active_profiler.compare_exchange_strong(expected, this))
+            {
+                throw std::runtime_error("Another profiler is running");
+            }
+
+            tls_is_profiled_thread = true;
+            m_running = true;
+
+            struct sigaction action{};
+            action.sa_handler = &Profiler::handle_signal;
+            action.sa_flags = SA_RESTART;
+            sigemptyset(&action.sa_mask);
+            (void)::sigaction(SIGPROF, &action, nullptr);
+
+            /* The CPU time of the calling thread only, and the signal is sent to it, so tasks and workers do not take its samples */
+            sigevent event{};
+            event.sigev_notify = SIGEV_THREAD_ID;
+            event.sigev_signo = SIGPROF;
+#ifdef sigev_notify_thread_id
+            event.sigev_notify_thread_id = static_cast<pid_t>(::syscall(SYS_gettid));
+#else
+            event._sigev_un._tid = static_cast<pid_t>(::syscall(SYS_gettid)); /* not every libc names it */
+#endif
+
+            if(::timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &m_timer) != 0)
+            {
+                active_profiler.store(nullptr);
+                tls_is_profiled_thread = false;
+                m_running = false;
+
+                throw std::runtime_error("The profiler timer cannot be created");
+            }
+
+            set_timer(m_timer, m_interval);
+        }
+
+        void Profiler::stop()
+        {
+            if(!m_running)
+            {
+                return;
+            }
+
+            (void)::timer_delete(m_timer);
+
+            /* A signal that is already pending still finds no profiler, the handler stays installed */
+            active_profiler.store(nullptr);
+            tls_is_profiled_thread = false;
+            m_running = false;
+        }
+
+        void Profiler::handle_signal(int signal)
+        {
+            Profiler* profiler = active_profiler.load(std::memory_order_relaxed);
+            if(signal != SIGPROF || profiler == nullptr)
+            {
+                return;
+            }
+
+            /* A SIGPROF of another timer of the process, that thread has no shadow stack to record */
+            if(!tls_is_profiled_thread)
+            {
+                profiler->m_samples.fetch_add(1, std::memory_order_relaxed);
+                profiler->m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            profiler->record();
+        }
+
+        void Profiler::record()
+        {
+            m_samples.fetch_add(1, std::memory_order_relaxed);
+
+            std::size_t depth = m_shadow_stack.visible_depth();
+
+            /* FNV-1a over the frame pointers */
+            std::uint64_t hash = 14695981039346656037ull;
+            for(std::size_t i = 0; i < depth; i++)
+            {
+                hash = (hash ^ reinterpret_cast<std::uintptr_t>(m_shadow_stack.frame(i))) * 1099511628211ull;
+            }
+            hash = (hash ^ depth) * 1099511628211ull;
+
+            for(std::size_t probe = 0; probe < TABLE_SIZE; probe++)
+            {
+                StackEntry& entry = m_table[(hash + probe) & (TABLE_SIZE - 1)];
+
+                if(entry.count == 0)
+                {
+                    if(m_frames_used + depth > FRAME_POOL_SIZE)
+                    {
+                        break;
+                    }
+
+                    for(std::size_t i = 0; i < depth; i++)
+                    {
+                        m_frame_pool[m_frames_used + i] = m_shadow_stack.frame(i);
+                    }
+
+                    entry.hash = hash;
+                    entry.first_frame = static_cast<std::uint32_t>(m_frames_used);
+                    entry.depth = static_cast<std::uint32_t>(depth);
+                    entry.count = 1;
+                    m_frames_used += depth;
+
+                    return;
+                }
+
+                if(entry.hash == hash && entry.depth == depth && this->same_frames(entry))
+                {
+                    entry.count++;
+                    return;
+                }
+            }
+
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        bool Profiler::same_frames(const StackEntry& entry) const
+        {
+            for(std::uint32_t i = 0; i < entry.depth; i++)
+            {
+                if(m_frame_pool[entry.first_frame + i] != m_shadow_stack.frame(i))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        void Profiler::write_folded(std::ostream& out) const
+        {
+            /* Sorted by stack, like the output of stackcollapse scripts */
+            std::map<std::string, std::uint64_t> stacks;
+
+            for(const auto& entry: m_table)
+            {
+                if(entry.count == 0)
+                {
+                    continue;
+                }
+
+                std::string stack = "<script>";
+                for(std::uint32_t i = 0; i < entry.depth; i++)
+                {
+                    const lang::ast::FunctionStatement* function = m_frame_pool[entry.first_frame + i];
+
+                    stack += ";";
+                    stack += function->name.m_lexeme;
+                    stack += " (" + m_source_name + ":" + std::to_string(function->name.m_line) + ")";
+                }
+
+                stacks[stack] += entry.count;
+            }
+
+            for(const auto& [stack, count]: stacks)
+            {
+                out << stack << " " << count << "\n";
+            }
+        }
+
+        std::size_t Profiler::samples() const
+        {
+            return m_samples.load(std::memory_order_relaxed);
+        }
+
+        std::size_t Profiler::dropped_samples() const
+        {
+            return m_dropped.load(std::memory_order_relaxed);
+        }
+    }
+}
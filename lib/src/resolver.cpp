@@ -0,0 +1,490 @@
+#include <resolver/resolver.hpp>
+#include <environment/environment.hpp>
+
+namespace lang
+{
+    Resolver::Resolver(lang::env::SymbolTable& symbols)
+        : m_symbols(symbols)
+    {}
+
+    void Resolver::resolve(const std::vector<lang::ast::Statement*>& statements)
+    {
+        m_functions.push_back(Function{nullptr, nullptr, false});
+        m_function = &m_functions.back();
+
+        /* The global variables are never captured, they are found through their slots */
+        m_scopes.push_back(Scope{m_function, nullptr});
+        this->visit_statements(statements);
+        m_scopes.pop_back();
+
+        this->bind();
+    }
+
+    void Resolver::begin_scope(bool* escapes, const std::vector<lang::ast::Statement*>& statements)
+    {
+        Scope scope{m_function, escapes};
+
+        for(const auto& statement: statements)
+        {
+            if(auto* var_statement = dynamic_cast<lang::ast::VarStatement*>(statement))
+            {
+                scope.declarations.insert(var_statement->name.m_lexeme);
+            }
+            else if(auto* function_statement = dynamic_cast<lang::ast::FunctionStatement*>(statement))
+            {
+                scope.declarations.insert(function_statement->name.m_lexeme);
+            }
+            else if(auto* class_statement = dynamic_cast<lang::ast::ClassStatement*>(statement))
+            {
+                scope.declarations.insert(class_statement->name.m_lexeme);
+            }
+        }
+
+        m_scopes.push_back(std::move(scope));
+    }
+
+    void Resolver::end_scope()
+    {
+        m_finished_scopes.push_back(ScopeFunctions{m_scopes.back().escapes, std::move(m_scopes.back().functions)});
+        m_scopes.pop_back();
+    }
+
+    void Resolver::declare(std::string_view name)
+    {
+        m_scopes.back().declared.insert(name);
+        m_scopes.back().declarations.insert(name);
+    }
+
+    void Resolver::resolve_variable(const lang::Token& name, int* upvalue_index, int* global_slot)
+    {
+        *upvalue_index = -1;
+        *global_slot = -1;
+
+        Scope* found = nullptr;
+        Scope* declared_later = nullptr;
+
+        for(auto scope = m_scopes.rbegin(); scope != m_scopes.rend() && scope->escapes != nullptr; scope++)
+        {
+            if(scope->declared.count(name.m_lexeme) != 0)
+            {
+                found = &*scope;
+                break;
+            }
+
+            if(scope->declarations.count(name.m_lexeme) != 0)
+            {
+                declared_later = &*scope;
+            }
+        }
+
+        if(declared_later != nullptr)
+        {
+            /* It is that variable once it is declared and another one (found or a global one) before */
+            Function* to = (found != nullptr) ? found->function : declared_later->function;
+            m_references.push_back(Reference{name.m_lexeme, nullptr, m_function, to, true});
+
+            if(found == nullptr)
+            {
+                this->use_global(name.m_lexeme);
+            }
+        }
+        else if(found != nullptr && found->function != m_function)
+        {
+            m_references.push_back(Reference{name.m_lexeme, upvalue_index, m_function, found->function, false});
+        }
+        else if(found == nullptr)
+        {
+            /* No scope around it can define the name, it is a global variable or a builtin */
+            *global_slot = static_cast<int>(m_symbols.id(name.m_lexeme));
+            this->use_global(name.m_lexeme);
+        }
+    }
+
+    void Resolver::use_global(std::string_view name)
+    {
+        /* A function that has the name already got it from a function inside it, and so did the ones around it */
+        for(Function* function = m_function; function->statement != nullptr && function->globals.insert(name).second; function = function->enclosing)
+        {
+            function->statement->globals.push_back(name);
+        }
+    }
+
+    void Resolver::resolve_method_environment()
+    {
+        Function* to = m_methods.empty() ? nullptr : m_methods.back()->enclosing;
+
+        m_references.push_back(Reference{"this", nullptr, m_function, to, true});
+    }
+
+    void Resolver::resolve_function(lang::ast::FunctionStatement* statement, bool is_method)
+    {
+        m_functions.push_back(Function{statement, m_function, is_method});
+        Function* function = &m_functions.back();
+
+        statement->captures.clear();
+        statement->globals.clear();
+
+        /* Its closure is the environment of every scope of the enclosing function up to here */
+        for(auto scope = m_scopes.rbegin(); scope != m_scopes.rend() && scope->function == m_function && scope->escapes != nullptr; scope++)
+        {
+            scope->functions.push_back(function);
+        }
+
+        Function* enclosing = m_function;
+        m_function = function;
+        if(is_method)
+        {
+            m_methods.push_back(function);
+        }
+
+        this->begin_scope(&statement->frame_escapes, statement->body_stmts);
+        for(const auto& param: statement->params)
+        {
+            this->declare(param.m_lexeme);
+        }
+
+        this->visit_statements(statement->body_stmts);
+        this->end_scope();
+
+        if(is_method)
+        {
+            m_methods.pop_back();
+        }
+        m_function = enclosing;
+    }
+
+    void Resolver::visit_statements(const std::vector<lang::ast::Statement*>& statements)
+    {
+        for(const auto& statement: statements)
+        {
+            statement->accept(this);
+        }
+    }
+
+    bool Resolver::capture_environments(Function* from, Function* to)
+    {
+        bool changed{false};
+
+        for(Function* function = from; function != to; function = function->enclosing)
+        {
+            changed = changed || !function->captures_environment;
+            function->captures_environment = true;
+        }
+
+        return changed;
+    }
+
+    int Resolver::capture_index(Function* function, std::string_view name, int enclosing_index)
+    {
+        auto& captures = function->statement->captures;
+
+        for(std::size_t i = 0; i < captures.size(); i++)
+        {
+            if(captures[i].name == name)
+            {
+                return static_cast<int>(i);
+            }
+        }
+
+        captures.push_back(lang::ast::FunctionStatement::Capture{name, enclosing_index});
+        return static_cast<int>(captures.size() - 1);
+    }
+
+    void Resolver::bind()
+    {
+        for(const auto& reference: m_references)
+        {
+            if(reference.needs_environment)
+            {
+                (void)capture_environments(reference.from, reference.to);
+            }
+        }
+
+        /*
+            A function that captures its environment finds the variables of the enclosing functions through their
+            environments, so they capture theirs too, up to the scope of the variable
+        */
+        bool changed{true};
+        while(changed)
+        {
+            changed = false;
+
+            for(const auto& reference: m_references)
+            {
+                for(Function* function = reference.from; function != reference.to; function = function->enclosing)
+                {
+                    if(function->captures_environment)
+                    {
+                        changed = capture_environments(function, reference.to) || changed;
+                        break;
+                    }
+                }
+            }
+        }
+
+        /*
+            The outermost function that does not capture its environment takes the variable from the scope it is
+            declared in, the functions inside it take it from the upvalues of their enclosing function
+        */
+        for(const auto& reference: m_references)
+        {
+            if(reference.needs_environment)
+            {
+                continue;
+            }
+
+            std::vector<Function*> path;
+            for(Function* function = reference.from; function != reference.to && !function->captures_environment; function = function->enclosing)
+            {
+                path.push_back(function);
+            }
+
+            int index{-1};
+            for(auto function = path.rbegin(); function != path.rend(); function++)
+            {
+                index = capture_index(*function, reference.name, index);
+            }
+
+            *reference.upvalue_index = index;
+        }
+
+        for(const auto& function: m_functions)
+        {
+            if(function.statement != nullptr)
+            {
+                function.statement->captures_environment = function.captures_environment;
+            }
+        }
+
+        for(const auto& scope: m_finished_scopes)
+        {
+            *scope.escapes = std::any_of(scope.functions.begin(), scope.functions.end(), [](const Function* function){ return function->captures_environment; });
+        }
+    }
+
+    lang::util::object_t Resolver::visit(lang::ast::BinaryExpression* expression)
+    {
+        expression->left->accept(this);
+        expression->right->accept(this);
+
+        return lang::util::null;
+    }
+
+    lang::util::object_t Resolver::visit(lang::ast::GroupingExpression* expression)
+    {
+        expression->expr->accept(this);
+
+        return lang::util::null;
+    }
+
+    lang::util::object_t Resolver::visit(lang::ast::LiteralExpression*)
+    {
+        return lang::util::null;
+    }
+
+    lang::util::object_t Resolver::visit(lang::ast::UnaryExpression* expression)
+    {
+        expression->value->accept(this);
+
+        return lang::util::null;
+    }
+
+    lang::util::object_t Resolver::visit(lang::ast::VariableExpression* expression)
+    {
+        this->resolve_variable(expression->name, &expression->upvalue_index, &expression->global_slot);
+
+        return lang::util::null;
+    }
+
+    lang::util::object_t Resolver::visit(lang::ast::AssignmentExpression* expression)
+    {
+        expression->value->accept(this);
+
+        this->resolve_variable(expression->name, &expression->upvalue_index, &expression->global_slot);
+
+        return lang::util::null;
+    }
+
+    lang::util::object_t Resolver::visit(lang::ast::LogicalExpression* expression)
+    {
+        expression->left->accept(this);
+        expression->right->accept(this);
+
+        return lang::util::null;
+    }
+
+    lang::util::object_t Resolver::visit(lang::ast::CallExpression* expression)
+    {
+        expression->callee->accept(this);
+        for(const auto& argument: expression->arguments)
+        {
+            argument->accept(this);
+        }
+
+        return lang::util::null;
+    }
+
+    lang::util::object_t Resolver::visit(lang::ast::ArrayExpression* expression)
+    {
+        for(const auto& element: expression->elements)
+        {
+            element->accept(this);
+        }
+
+        return lang::util::null;
+    }
+
+    lang::util::object_t Resolver::visit(lang::ast::IndexExpression* expression)
+    {
+        expression->object->accept(this);
+        expression->index->accept(this);
+
+        return lang::util::null;
+    }
+
+    lang::util::object_t Resolver::visit(lang::ast::IndexAssignmentExpression* expression)
+    {
+        expression->object->accept(this);
+        expression->index->accept(this);
+        expression->value->accept(this);
+
+        return lang::util::null;
+    }
+
+    lang::util::object_t Resolver::visit(lang::ast::GetExpression* expression)
+    {
+        expression->object->accept(this);
+
+        return lang::util::null;
+    }
+
+    lang::util::object_t Resolver::visit(lang::ast::SetExpression* expression)
+    {
+        expression->object->accept(this);
+        expression->value->accept(this);
+
+        return lang::util::null;
+    }
+
+    lang::util::object_t Resolver::visit(lang::ast::ThisExpression*)
+    {
+        this->resolve_method_environment();
+
+        return lang::util::null;
+    }
+
+    lang::util::object_t Resolver::visit(lang::ast::SuperExpression*)
+    {
+        this->resolve_method_environment();
+
+        return lang::util::null;
+    }
+
+    void Resolver::visit(lang::ast::ExpressionStatement* statement)
+    {
+        statement->expr->accept(this);
+    }
+
+    void Resolver::visit(lang::ast::PrintStatement* statement)
+    {
+        statement->expr->accept(this);
+    }
+
+    void Resolver::visit(lang::ast::VarStatement* statement)
+    {
+        if(statement->initializer != nullptr)
+        {
+            statement->initializer->accept(this);
+        }
+
+        this->declare(statement->name.m_lexeme);
+    }
+
+    void Resolver::visit(lang::ast::BlockStatement* statement)
+    {
+        this->begin_scope(&statement->scope_escapes, statement->statements);
+        this->visit_statements(statement->statements);
+        this->end_scope();
+    }
+
+    void Resolver::visit(lang::ast::IfStatement* statement)
+    {
+        statement->condition->accept(this);
+        statement->thenBranch->accept(this);
+
+        if(statement->elseBranch != nullptr)
+        {
+            statement->elseBranch->accept(this);
+        }
+    }
+
+    void Resolver::visit(lang::ast::WhileStatement* statement)
+    {
+        statement->condition->accept(this);
+        statement->body->accept(this);
+    }
+
+    void Resolver::visit(lang::ast::FunctionStatement* statement)
+    {
+        /* Declared before its body is resolved, the interpreter defines it before capturing (a recursive function captures itself) */
+        this->declare(statement->name.m_lexeme);
+
+        this->resolve_function(statement, false);
+    }
+
+    void Resolver::visit(lang::ast::ReturnStatement* statement)
+    {
+        if(statement->value != nullptr)
+        {
+            statement->value->accept(this);
+        }
+    }
+
+    void Resolver::visit(lang::ast::NumericForStatement* statement)
+    {
+        statement->initializer->accept(this);
+
+        this->begin_scope(&statement->scope_escapes, {});
+        this->declare(statement->name.m_lexeme);
+
+        statement->limit->accept(this);
+
+        /*
+            The generic loop runs in the same environment when the initial value is not a number. It shares the
+            body, which is resolved once: the block around the body and the increment declares nothing.
+        */
+        auto* generic_loop = static_cast<lang::ast::WhileStatement*>(statement->generic_loop);
+        generic_loop->condition->accept(this);
+
+        if(generic_loop->body != statement->body)
+        {
+            auto* loop_body = static_cast<lang::ast::BlockStatement*>(generic_loop->body);
+
+            this->begin_scope(&loop_body->scope_escapes, {});
+            this->visit_statements(loop_body->statements);
+            this->end_scope();
+        }
+        else
+        {
+            statement->body->accept(this);
+        }
+
+        this->end_scope();
+    }
+
+    void Resolver::visit(lang::ast::ClassStatement* statement)
+    {
+        if(statement->superclass != nullptr)
+        {
+            statement->superclass->accept(this);
+        }
+
+        this->declare(statement->name.m_lexeme);
+
+        /* Methods find "this" and "super" in their environment, so they always capture it */
+        for(const auto& method: statement->methods)
+        {
+            this->resolve_function(method, true);
+        }
+    }
+}
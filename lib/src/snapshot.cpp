@@ -0,0 +1,1002 @@
+#include <snapshot/snapshot.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <limits>
+#include <stdexcept>
+
+namespace lang
+{
+    namespace snapshot
+    {
+        namespace
+        {
+            /*
+                The layout of a snapshot file, integers are 64 bit and doubles are stored as they are in memory:
+
+                    magic, prelude source size, prelude source, inline cache count, function count,
+                    entity count, the kind of every entity (1 byte each), the payload of every entity
+
+                An entity is anything a value can refer to: environments, functions, classes, arrays, maps,
+                instances and the upvalues of the functions. Entity 0 is the global environment. The enclosing environment of an environment always
+                has a smaller id, so environments can be created in order.
+            */
+            constexpr char MAGIC[8] = {'L', 'L', 'S', 'N', 'A', 'P', '0', '2'};
+
+            /* The enclosing environment of the globals (the builtins) and a class without superclass */
+            constexpr std::uint64_t NONE = std::numeric_limits<std::uint64_t>::max();
+
+            enum class EntityKind : std::uint8_t
+            {
+                ENVIRONMENT,    /* enclosing id, variable count, (name, value)... */
+                FUNCTION,       /* declaration index, is initializer, closure id, upvalue count, upvalue ids... */
+                CLASS,          /* name, superclass id, method count, (name, function id)... */
+                ARRAY,          /* size, numbers... */
+                MAP,            /* size, (key, value)... */
+                INSTANCE,       /* class id, field count, (name, value)... in the order of the field slots */
+                UPVALUE         /* environment id and the name of the variable if it is open, NONE and the value if it is closed */
+            };
+
+            enum class ValueTag : std::uint8_t
+            {
+                NUMBER,         /* the double */
+                NIL,
+                TRUE,
+                FALSE,
+                STRING,         /* size, characters */
+                NATIVE,         /* the name of the builtin */
+                FUNCTION,       /* the entity id of the following ones */
+                ARRAY,
+                MAP,
+                CLASS,
+                INSTANCE
+            };
+
+            [[noreturn]] void corrupt()
+            {
+                throw std::runtime_error("The snapshot is corrupt or from another build");
+            }
+
+            /*****************************************Writer*******************************************/
+            class Writer
+            {
+                public:
+                    explicit Writer(const CompiledProgram& prelude)
+                    {
+                        for(std::size_t i = 0; i < prelude.functions().size(); i++)
+                        {
+                            m_function_indexes.emplace(prelude.functions()[i], i);
+                        }
+                    }
+
+                    /* The value graph of the snapshot, everything after the function count */
+                    std::string write(lang::env::Environment* globals)
+                    {
+                        (void)this->add_environment(globals);
+
+                        /* Every entity found adds the ones it refers to at the end */
+                        for(std::size_t i = 0; i < m_entities.size(); i++)
+                        {
+                            this->discover_references(m_entities[i]);
+                        }
+
+                        this->put_u64(m_entities.size());
+                        for(const auto& entity: m_entities)
+                        {
+                            this->put_u8(static_cast<std::uint8_t>(entity.kind));
+                        }
+
+                        for(const auto& entity: m_entities)
+                        {
+                            this->put_payload(entity);
+                        }
+
+                        return std::move(m_out);
+                    }
+
+                private:
+                    struct Entity
+                    {
+                        EntityKind kind;
+                        const void* pointer;
+                    };
+
+                    std::uint64_t add(EntityKind kind, const void* pointer)
+                    {
+                        auto [it, inserted] = m_ids.emplace(pointer, m_entities.size());
+                        if(inserted)
+                        {
+                            m_entities.push_back(Entity{kind, pointer});
+                        }
+
+                        return it->second;
+                    }
+
+                    std::uint64_t add_environment(lang::env::Environment* environment)
+                    {
+                        if(environment->enclosing() == nullptr)
+                        {
+                            return NONE;
+                        }
+
+                        auto it = m_ids.find(environment);
+                        if(it != m_ids.end())
+                        {
+                            return it->second;
+                        }
+
+                        /* The enclosing environment gets the smaller id */
+                        (void)this->add_environment(environment->enclosing());
+
+                        return this->add(EntityKind::ENVIRONMENT, environment);
+                    }
+
+                    void discover(const lang::util::object_t& value)
+                    {
+                        if(auto* data = std::get_if<lang::util::LLCallable*>(&value))
+                        {
+                            if(!(*data)->flag_is_native_function)
+                            {
+                                (void)this->add(EntityKind::FUNCTION, *data);
+                            }
+                        }
+                        else if(auto* data = std::get_if<lang::util::LLClass*>(&value))
+                        {
+                            (void)this->add(EntityKind::CLASS, *data);
+                        }
+                        else if(auto* data = std::get_if<std::shared_ptr<lang::util::LLArray>>(&value))
+                        {
+                            (void)this->add(EntityKind::ARRAY, data->get());
+                        }
+                        else if(auto* data = std::get_if<std::shared_ptr<lang::util::LLMap>>(&value))
+                        {
+                            (void)this->add(EntityKind::MAP, data->get());
+                        }
+                        else if(auto* data = std::get_if<std::shared_ptr<lang::util::LLInstance>>(&value))
+                        {
+                            (void)this->add(EntityKind::INSTANCE, data->get());
+                        }
+                    }
+
+                    void discover_references(const Entity& entity)
+                    {
+                        switch(entity.kind)
+                        {
+                            case EntityKind::ENVIRONMENT:
+                            {
+                                for(const auto& [name, value]: static_cast<const lang::env::Environment*>(entity.pointer)->values())
+                                {
+                                    this->discover(value);
+                                }
+                                break;
+                            }
+                            case EntityKind::FUNCTION:
+                            {
+                                auto* function = static_cast<const lang::util::LLCallable*>(entity.pointer);
+                                if(m_function_indexes.find(function->function_declaration_statement) == m_function_indexes.end())
+                                {
+                                    throw std::runtime_error("A function of the snapshot is not declared in its prelude");
+                                }
+
+                                (void)this->add_environment(function->closure);
+                                for(const auto& upvalue: function->upvalues)
+                                {
+                                    (void)this->add(EntityKind::UPVALUE, upvalue.get());
+                                }
+                                break;
+                            }
+                            case EntityKind::CLASS:
+                            {
+                                auto* klass = static_cast<const lang::util::LLClass*>(entity.pointer);
+                                if(klass->superclass != nullptr)
+                                {
+                                    (void)this->add(EntityKind::CLASS, klass->superclass);
+                                }
+                                for(const auto& [name, method]: klass->methods)
+                                {
+                                    this->discover(method);
+                                }
+                                break;
+                            }
+                            case EntityKind::ARRAY:
+                                break;
+                            case EntityKind::MAP:
+                            {
+                                for(const auto& entry: static_cast<const lang::util::LLMap*>(entity.pointer)->entries)
+                                {
+                                    this->discover(entry.key);
+                                    this->discover(entry.value);
+                                }
+                                break;
+                            }
+                            case EntityKind::INSTANCE:
+                            {
+                                auto* instance = static_cast<const lang::util::LLInstance*>(entity.pointer);
+                                (void)this->add(EntityKind::CLASS, instance->shape->klass);
+                                for(const auto& field: instance->fields)
+                                {
+                                    this->discover(field);
+                                }
+                                break;
+                            }
+                            case EntityKind::UPVALUE:
+                            {
+                                auto* upvalue = static_cast<const lang::util::Upvalue*>(entity.pointer);
+                                if(upvalue->environment != nullptr)
+                                {
+                                    (void)this->add_environment(upvalue->environment);
+                                }
+                                else
+                                {
+                                    this->discover(upvalue->closed);
+                                }
+                                break;
+                            }
+                        }
+                    }
+
+                    void put_payload(const Entity& entity)
+                    {
+                        switch(entity.kind)
+                        {
+                            case EntityKind::ENVIRONMENT:
+                            {
+                                auto* environment = static_cast<lang::env::Environment*>(const_cast<void*>(entity.pointer));
+                                this->put_u64(this->add_environment(environment->enclosing()));
+                                this->put_u64(environment->values().size());
+                                for(const auto& [name, value]: environment->values())
+                                {
+                                    this->put_string(name);
+                                    this->put_value(value);
+                                }
+                                break;
+                            }
+                            case EntityKind::FUNCTION:
+                            {
+                                auto* function = static_cast<const lang::util::LLCallable*>(entity.pointer);
+                                this->put_u64(m_function_indexes.at(function->function_declaration_statement));
+                                this->put_u8(function->flag_is_initializer ? 1 : 0);
+                                this->put_u64(this->add_environment(function->closure));
+                                this->put_u64(function->upvalues.size());
+                                for(const auto& upvalue: function->upvalues)
+                                {
+                                    this->put_u64(m_ids.at(upvalue.get()));
+                                }
+                                break;
+                            }
+                            case EntityKind::CLASS:
+                            {
+                                auto* klass = static_cast<const lang::util::LLClass*>(entity.pointer);
+                                this->put_string(klass->name);
+                                this->put_u64(klass->superclass != nullptr ? m_ids.at(klass->superclass) : NONE);
+                                this->put_u64(klass->methods.size());
+                                for(const auto& [name, method]: klass->methods)
+                                {
+                                    this->put_string(name);
+                                    this->put_u64(m_ids.at(method));
+                                }
+                                break;
+                            }
+                            case EntityKind::ARRAY:
+                            {
+                                const auto& values = static_cast<const lang::util::LLArray*>(entity.pointer)->values;
+                                this->put_u64(values.size());
+                                m_out.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(double));
+                                break;
+                            }
+                            case EntityKind::MAP:
+                            {
+                                const auto& entries = static_cast<const lang::util::LLMap*>(entity.pointer)->entries;
+                                this->put_u64(entries.size());
+                                for(const auto& entry: entries)
+                                {
+                                    this->put_value(entry.key);
+                                    this->put_value(entry.value);
+                                }
+                                break;
+                            }
+                            case EntityKind::INSTANCE:
+                            {
+                                auto* instance = static_cast<const lang::util::LLInstance*>(entity.pointer);
+
+                                std::vector<std::string_view> names(instance->fields.size());
+                                for(const auto& [name, slot]: instance->shape->field_slots)
+                                {
+                                    names[slot] = name;
+                                }
+
+                                this->put_u64(m_ids.at(instance->shape->klass));
+                                this->put_u64(instance->fields.size());
+                                for(std::size_t slot = 0; slot < names.size(); slot++)
+                                {
+                                    this->put_string(names[slot]);
+                                    this->put_value(instance->fields[slot]);
+                                }
+                                break;
+                            }
+                            case EntityKind::UPVALUE:
+                            {
+                                auto* upvalue = static_cast<const lang::util::Upvalue*>(entity.pointer);
+                                if(upvalue->environment != nullptr)
+                                {
+                                    this->put_u64(this->add_environment(upvalue->environment));
+                                    this->put_string(upvalue->environment->name_of(upvalue->location));
+                                }
+                                else
+                                {
+                                    this->put_u64(NONE);
+                                    this->put_value(upvalue->closed);
+                                }
+                                break;
+                            }
+                        }
+                    }
+
+                    void put_value(const lang::util::object_t& value)
+                    {
+                        if(auto* data = std::get_if<double>(&value))
+                        {
+                            this->put_u8(static_cast<std::uint8_t>(ValueTag::NUMBER));
+                            m_out.append(reinterpret_cast<const char*>(data), sizeof(double));
+                        }
+                        else if(std::holds_alternative<lang::util::null_t>(value))
+                        {
+                            this->put_u8(static_cast<std::uint8_t>(ValueTag::NIL));
+                        }
+                        else if(auto* data = std::get_if<bool>(&value))
+                        {
+                            this->put_u8(static_cast<std::uint8_t>(*data ? ValueTag::TRUE : ValueTag::FALSE));
+                        }
+                        else if(auto* data = std::get_if<lang::util::LLString>(&value))
+                        {
+                            this->put_u8(static_cast<std::uint8_t>(ValueTag::STRING));
+                            this->put_string(data->view());
+                        }
+                        else if(auto* data = std::get_if<lang::util::LLCallable*>(&value))
+                        {
+                            if((*data)->flag_is_native_function)
+                            {
+                                this->put_u8(static_cast<std::uint8_t>(ValueTag::NATIVE));
+                                this->put_string((*data)->native_name);
+                            }
+                            else
+                            {
+                                this->put_u8(static_cast<std::uint8_t>(ValueTag::FUNCTION));
+                                this->put_u64(m_ids.at(*data));
+                            }
+                        }
+                        else if(auto* data = std::get_if<std::shared_ptr<lang::util::LLArray>>(&value))
+                        {
+                            this->put_u8(static_cast<std::uint8_t>(ValueTag::ARRAY));
+                            this->put_u64(m_ids.at(data->get()));
+                        }
+                        else if(auto* data = std::get_if<std::shared_ptr<lang::util::LLMap>>(&value))
+                        {
+                            this->put_u8(static_cast<std::uint8_t>(ValueTag::MAP));
+                            this->put_u64(m_ids.at(data->get()));
+                        }
+                        else if(auto* data = std::get_if<lang::util::LLClass*>(&value))
+                        {
+                            this->put_u8(static_cast<std::uint8_t>(ValueTag::CLASS));
+                            this->put_u64(m_ids.at(*data));
+                        }
+                        else if(auto* data = std::get_if<std::shared_ptr<lang::util::LLInstance>>(&value))
+                        {
+                            this->put_u8(static_cast<std::uint8_t>(ValueTag::INSTANCE));
+                            this->put_u64(m_ids.at(data->get()));
+                        }
+                    }
+
+                    void put_u8(std::uint8_t value)
+                    {
+                        m_out.push_back(static_cast<char>(value));
+                    }
+
+                    void put_u64(std::uint64_t value)
+                    {
+                        m_out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+                    }
+
+                    void put_string(std::string_view text)
+                    {
+                        this->put_u64(text.size());
+                        m_out.append(text);
+                    }
+
+                private:
+                    std::unordered_map<const lang::ast::FunctionStatement*, std::uint64_t> m_function_indexes;
+
+                    std::vector<Entity> m_entities;
+                    std::unordered_map<const void*, std::uint64_t> m_ids;
+
+                    std::string m_out;
+            };
+
+            /*****************************************Reader*******************************************/
+            class Reader
+            {
+                public:
+                    Reader(const unsigned char* data, std::size_t size, std::size_t position)
+                        : m_data(data), m_size(size), m_position(position)
+                    {}
+
+                    std::uint8_t u8()
+                    {
+                        this->need(1);
+                        return m_data[m_position++];
+                    }
+
+                    std::uint64_t u64()
+                    {
+                        std::uint64_t value;
+                        this->need(sizeof(value));
+                        std::memcpy(&value, m_data + m_position, sizeof(value));
+                        m_position += sizeof(value);
+
+                        return value;
+                    }
+
+                    double f64()
+                    {
+                        double value;
+                        this->need(sizeof(value));
+                        std::memcpy(&value, m_data + m_position, sizeof(value));
+                        m_position += sizeof(value);
+
+                        return value;
+                    }
+
+                    /* A view into the mapped file */
+                    std::string_view string()
+                    {
+                        std::uint64_t size = this->u64();
+                        this->need(size);
+
+                        std::string_view text(reinterpret_cast<const char*>(m_data + m_position), size);
+                        m_position += size;
+
+                        return text;
+                    }
+
+                    std::size_t position() const
+                    {
+                        return m_position;
+                    }
+
+                    /* A count read from the file, before reserving for it: "count" items of "item_size" bytes must be left */
+                    void need_items(std::uint64_t count, std::size_t item_size)
+                    {
+                        if(count > (m_size - m_position) / item_size)
+                        {
+                            corrupt();
+                        }
+                    }
+
+                private:
+                    void need(std::uint64_t bytes)
+                    {
+                        if(m_size - m_position < bytes)
+                        {
+                            corrupt();
+                        }
+                    }
+
+                private:
+                    const unsigned char* m_data;
+                    std::size_t m_size;
+                    std::size_t m_position;
+            };
+
+            /*****************************************Loader*******************************************/
+            /*
+                It reads the entities three times: first it creates every environment, function, class, array
+                and map, then the instances (they need their class), and last it fills everything in, when all
+                the entities a value can refer to exist.
+            */
+            class Loader
+            {
+                public:
+                    Loader(lang::Interpreter& interpreter, const CompiledProgram& prelude)
+                        : m_interpreter(interpreter), m_prelude(prelude)
+                    {}
+
+                    void load(Reader reader)
+                    {
+                        std::uint64_t count = reader.u64();
+
+                        reader.need_items(count, sizeof(std::uint8_t));
+                        m_kinds.reserve(count);
+                        for(std::uint64_t i = 0; i < count; i++)
+                        {
+                            std::uint8_t kind = reader.u8();
+                            if(kind > static_cast<std::uint8_t>(EntityKind::UPVALUE))
+                            {
+                                corrupt();
+                            }
+                            m_kinds.push_back(static_cast<EntityKind>(kind));
+                        }
+
+                        if(count == 0 || m_kinds[0] != EntityKind::ENVIRONMENT)
+                        {
+                            corrupt();
+                        }
+
+                        m_entities.resize(count);
+                        m_environments.resize(count, nullptr);
+                        m_upvalues.resize(count);
+
+                        for(Phase phase: {Phase::CREATE, Phase::CREATE_INSTANCES, Phase::FILL})
+                        {
+                            Reader entities = reader;
+                            for(std::uint64_t id = 0; id < count; id++)
+                            {
+                                this->read_entity(entities, phase, id);
+                            }
+                        }
+
+                        /* The variables of all the environments are defined now */
+                        for(const auto& [upvalue, environment, name]: m_open_upvalues)
+                        {
+                            lang::util::object_t* variable = environment->find_local(name);
+                            if(variable == nullptr)
+                            {
+                                corrupt();
+                            }
+
+                            upvalue->location = variable;
+                            upvalue->environment = environment;
+                        }
+                    }
+
+                private:
+                    enum class Phase
+                    {
+                        CREATE,
+                        CREATE_INSTANCES,
+                        FILL
+                    };
+
+                    void read_entity(Reader& reader, Phase phase, std::uint64_t id)
+                    {
+                        bool fill = (phase == Phase::FILL);
+
+                        switch(m_kinds[id])
+                        {
+                            case EntityKind::ENVIRONMENT:
+                            {
+                                std::uint64_t enclosing = reader.u64();
+                                if(phase == Phase::CREATE)
+                                {
+                                    if(id == 0)
+                                    {
+                                        m_environments[id] = m_interpreter.globals();
+                                    }
+                                    else if(enclosing == NONE)
+                                    {
+                                        m_environments[id] = m_interpreter.make_environment(m_interpreter.builtins());
+                                    }
+                                    else
+                                    {
+                                        m_environments[id] = m_interpreter.make_environment(this->environment(enclosing, id));
+                                    }
+                                }
+
+                                std::uint64_t variables = reader.u64();
+                                for(std::uint64_t i = 0; i < variables; i++)
+                                {
+                                    std::string_view name = reader.string();
+                                    lang::util::object_t value = this->value(reader, fill);
+                                    if(fill)
+                                    {
+                                        m_environments[id]->define(name, value);
+                                    }
+                                }
+                                break;
+                            }
+                            case EntityKind::FUNCTION:
+                            {
+                                std::uint64_t index = reader.u64();
+                                bool is_initializer = (reader.u8() != 0);
+                                std::uint64_t closure = reader.u64();
+
+                                std::uint64_t upvalues = reader.u64();
+                                std::vector<std::uint64_t> upvalue_ids;
+                                for(std::uint64_t i = 0; i < upvalues; i++)
+                                {
+                                    upvalue_ids.push_back(reader.u64());
+                                }
+
+                                if(phase == Phase::CREATE)
+                                {
+                                    if(index >= m_prelude.functions().size())
+                                    {
+                                        corrupt();
+                                    }
+
+                                    lang::ast::FunctionStatement* declaration = m_prelude.functions()[index];
+                                    auto* function = new lang::util::LLCallable(&m_interpreter, declaration, false, declaration->params.size(), nullptr, nullptr);
+                                    function->flag_is_initializer = is_initializer;
+                                    m_interpreter.adopt_callable(function);
+
+                                    m_entities[id] = function;
+                                }
+                                else if(fill)
+                                {
+                                    auto* function = std::get<lang::util::LLCallable*>(m_entities[id]);
+                                    function->closure = this->environment(closure, m_kinds.size());
+
+                                    if(upvalue_ids.size() != function->function_declaration_statement->captures.size())
+                                    {
+                                        corrupt();
+                                    }
+                                    for(std::uint64_t upvalue: upvalue_ids)
+                                    {
+                                        function->upvalues.push_back(this->upvalue(upvalue));
+                                    }
+                                }
+                                break;
+                            }
+                            case EntityKind::CLASS:
+                            {
+                                std::string_view name = reader.string();
+                                std::uint64_t superclass = reader.u64();
+
+                                if(phase == Phase::CREATE)
+                                {
+                                    auto* klass = new lang::util::LLClass(name, nullptr);
+                                    m_interpreter.adopt_class(klass);
+
+                                    m_entities[id] = klass;
+                                }
+
+                                auto* klass = fill ? std::get<lang::util::LLClass*>(m_entities[id]) : nullptr;
+                                if(fill && superclass != NONE)
+                                {
+                                    klass->superclass = this->entity<lang::util::LLClass*>(superclass);
+                                }
+
+                                std::uint64_t methods = reader.u64();
+                                for(std::uint64_t i = 0; i < methods; i++)
+                                {
+                                    std::string_view method_name = reader.string();
+                                    std::uint64_t method = reader.u64();
+                                    if(fill)
+                                    {
+                                        klass->methods.emplace(std::string(method_name), this->entity<lang::util::LLCallable*>(method));
+                                    }
+                                }
+                                break;
+                            }
+                            case EntityKind::ARRAY:
+                            {
+                                std::uint64_t size = reader.u64();
+                                reader.need_items(size, sizeof(double));
+
+                                std::vector<double> values;
+                                if(phase == Phase::CREATE)
+                                {
+                                    values.reserve(size);
+                                }
+                                for(std::uint64_t i = 0; i < size; i++)
+                                {
+                                    double value = reader.f64();
+                                    if(phase == Phase::CREATE)
+                                    {
+                                        values.push_back(value);
+                                    }
+                                }
+
+                                if(phase == Phase::CREATE)
+                                {
+                                    m_entities[id] = std::make_shared<lang::util::LLArray>(std::move(values));
+                                }
+                                break;
+                            }
+                            case EntityKind::MAP:
+                            {
+                                if(phase == Phase::CREATE)
+                                {
+                                    m_entities[id] = std::make_shared<lang::util::LLMap>();
+                                }
+
+                                std::uint64_t size = reader.u64();
+                                for(std::uint64_t i = 0; i < size; i++)
+                                {
+                                    lang::util::object_t key = this->value(reader, fill);
+                                    lang::util::object_t value = this->value(reader, fill);
+                                    if(fill)
+                                    {
+                                        std::get<std::shared_ptr<lang::util::LLMap>>(m_entities[id])->set(key, value);
+                                    }
+                                }
+                                break;
+                            }
+                            case EntityKind::INSTANCE:
+                            {
+                                std::uint64_t klass = reader.u64();
+                                if(phase == Phase::CREATE_INSTANCES)
+                                {
+                                    m_entities[id] = std::make_shared<lang::util::LLInstance>(this->entity<lang::util::LLClass*>(klass));
+                                }
+
+                                auto* instance = fill ? std::get<std::shared_ptr<lang::util::LLInstance>>(m_entities[id]).get() : nullptr;
+
+                                std::uint64_t fields = reader.u64();
+                                for(std::uint64_t i = 0; i < fields; i++)
+                                {
+                                    std::string_view name = reader.string();
+                                    lang::util::object_t value = this->value(reader, fill);
+                                    if(fill)
+                                    {
+                                        /* The same transitions as the original instance, so it gets an equivalent shape */
+                                        instance->shape = instance->shape->add_field(name);
+                                        instance->fields.push_back(std::move(value));
+                                    }
+                                }
+                                break;
+                            }
+                            case EntityKind::UPVALUE:
+                            {
+                                if(phase == Phase::CREATE)
+                                {
+                                    m_upvalues[id] = std::make_shared<lang::util::Upvalue>(lang::util::null);
+                                }
+
+                                std::uint64_t environment = reader.u64();
+                                if(environment == NONE)
+                                {
+                                    lang::util::object_t value = this->value(reader, fill);
+                                    if(fill)
+                                    {
+                                        m_upvalues[id]->closed = std::move(value);
+                                    }
+                                }
+                                else
+                                {
+                                    std::string_view name = reader.string();
+                                    if(fill)
+                                    {
+                                        m_open_upvalues.push_back(OpenUpvalue{m_upvalues[id].get(), this->environment(environment, m_kinds.size()), name});
+                                    }
+                                }
+                                break;
+                            }
+                        }
+                    }
+
+                    /* The value is only built when "resolve" is set, otherwise it is skipped */
+                    lang::util::object_t value(Reader& reader, bool resolve)
+                    {
+                        auto tag = static_cast<ValueTag>(reader.u8());
+                        switch(tag)
+                        {
+                            case ValueTag::NUMBER: return reader.f64();
+                            case ValueTag::NIL: return lang::util::null;
+                            case ValueTag::TRUE: return true;
+                            case ValueTag::FALSE: return false;
+                            case ValueTag::STRING:
+                            {
+                                std::string_view text = reader.string();
+                                return resolve ? lang::util::object_t{lang::util::LLString(text)} : lang::util::null;
+                            }
+                            case ValueTag::NATIVE:
+                            {
+                                std::string_view name = reader.string();
+                                if(!resolve)
+                                {
+                                    return lang::util::null;
+                                }
+
+                                lang::util::object_t* native = m_interpreter.builtins()->find_local(name);
+                                if(native == nullptr)
+                                {
+                                    corrupt();
+                                }
+                                return *native;
+                            }
+                            case ValueTag::FUNCTION:
+                            case ValueTag::ARRAY:
+                            case ValueTag::MAP:
+                            case ValueTag::CLASS:
+                            case ValueTag::INSTANCE:
+                            {
+                                std::uint64_t id = reader.u64();
+                                if(!resolve)
+                                {
+                                    return lang::util::null;
+                                }
+
+                                if(id >= m_entities.size() || m_kinds[id] == EntityKind::ENVIRONMENT || m_kinds[id] == EntityKind::UPVALUE)
+                                {
+                                    corrupt();
+                                }
+                                return m_entities[id];
+                            }
+                        }
+
+                        corrupt();
+                    }
+
+                    /* An environment created before the entity "before" */
+                    lang::env::Environment* environment(std::uint64_t id, std::uint64_t before)
+                    {
+                        if(id >= before || m_environments[id] == nullptr)
+                        {
+                            corrupt();
+                        }
+
+                        return m_environments[id];
+                    }
+
+                    std::shared_ptr<lang::util::Upvalue> upvalue(std::uint64_t id)
+                    {
+                        if(id >= m_upvalues.size() || m_upvalues[id] == nullptr)
+                        {
+                            corrupt();
+                        }
+
+                        return m_upvalues[id];
+                    }
+
+                    template<typename T>
+                    T entity(std::uint64_t id)
+                    {
+                        if(id >= m_entities.size())
+                        {
+                            corrupt();
+                        }
+
+                        auto* data = std::get_if<T>(&m_entities[id]);
+                        if(data == nullptr)
+                        {
+                            corrupt();
+                        }
+
+                        return *data;
+                    }
+
+                private:
+                    lang::Interpreter& m_interpreter;
+                    const CompiledProgram& m_prelude;
+
+                    std::vector<EntityKind> m_kinds;
+
+                    /* Functions, classes, arrays, maps and instances as values, by id */
+                    std::vector<lang::util::object_t> m_entities;
+
+                    std::vector<lang::env::Environment*> m_environments;
+
+                    std::vector<std::shared_ptr<lang::util::Upvalue>> m_upvalues;
+
+                    /* The open upvalues point to their variable once all the environments are filled */
+                    struct OpenUpvalue
+                    {
+                        lang::util::Upvalue* upvalue;
+                        lang::env::Environment* environment;
+                        std::string_view name;
+                    };
+                    std::vector<OpenUpvalue> m_open_upvalues;
+            };
+        }
+
+        std::vector<std::string> create(std::string prelude_source, const std::string& path)
+        {
+            auto prelude = lang::Lang::compile(prelude_source);
+            if(!prelude->ok())
+            {
+                std::ostringstream errors;
+                lang::Lang::write_compile_errors(*prelude, errors);
+
+                return {std::move(errors).str()};
+            }
+
+            lang::Interpreter interpreter;
+            interpreter.set_programs({prelude});
+
+            std::vector<std::string> errors = interpreter.interpret(prelude->statements(), prelude->inline_cache_count());
+            if(!errors.empty())
+            {
+                return errors;
+            }
+
+            std::string graph = Writer(*prelude).write(interpreter.globals());
+
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            if(!file.is_open())
+            {
+                return {"Error opening the snapshot " + path};
+            }
+
+            std::uint64_t source_size = prelude_source.size();
+            std::uint64_t inline_cache_count = prelude->inline_cache_count();
+            std::uint64_t function_count = prelude->functions().size();
+
+            file.write(MAGIC, sizeof(MAGIC));
+            file.write(reinterpret_cast<const char*>(&source_size), sizeof(source_size));
+            file.write(prelude_source.data(), static_cast<std::streamsize>(prelude_source.size()));
+            file.write(reinterpret_cast<const char*>(&inline_cache_count), sizeof(inline_cache_count));
+            file.write(reinterpret_cast<const char*>(&function_count), sizeof(function_count));
+            file.write(graph.data(), static_cast<std::streamsize>(graph.size()));
+
+            if(!file.good())
+            {
+                return {"Error writing the snapshot " + path};
+            }
+
+            return {};
+        }
+
+        std::shared_ptr<const Snapshot> Snapshot::load(const std::string& path)
+        {
+            int descriptor = ::open(path.c_str(), O_RDONLY);
+            if(descriptor < 0)
+            {
+                throw std::runtime_error("Error opening the snapshot " + path);
+            }
+
+            struct stat status;
+            if(::fstat(descriptor, &status) != 0 || status.st_size < static_cast<off_t>(sizeof(MAGIC)))
+            {
+                ::close(descriptor);
+                corrupt();
+            }
+
+            void* data = ::mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+            ::close(descriptor);
+
+            if(data == MAP_FAILED)
+            {
+                throw std::runtime_error("Error mapping the snapshot " + path);
+            }
+
+            std::shared_ptr<Snapshot> snapshot(new Snapshot());
+            snapshot->m_data = static_cast<const unsigned char*>(data);
+            snapshot->m_size = static_cast<std::size_t>(status.st_size);
+
+            if(std::memcmp(snapshot->m_data, MAGIC, sizeof(MAGIC)) != 0)
+            {
+                corrupt();
+            }
+
+            Reader reader(snapshot->m_data, snapshot->m_size, sizeof(MAGIC));
+            snapshot->m_prelude = lang::Lang::compile(std::string(reader.string()));
+
+            std::uint64_t inline_cache_count = reader.u64();
+            std::uint64_t function_count = reader.u64();
+            if(!snapshot->m_prelude->ok() || inline_cache_count != snapshot->m_prelude->inline_cache_count() || function_count != snapshot->m_prelude->functions().size())
+            {
+                corrupt();
+            }
+
+            snapshot->m_graph_offset = reader.position();
+
+            return snapshot;
+        }
+
+        Snapshot::~Snapshot()
+        {
+            if(m_data != nullptr)
+            {
+                ::munmap(const_cast<unsigned char*>(m_data), m_size);
+            }
+        }
+
+        std::shared_ptr<const CompiledProgram> Snapshot::compile(std::string source) const
+        {
+            return lang::Lang::compile(std::move(source), m_prelude.get());
+        }
+
+        void Snapshot::restore(lang::Interpreter& interpreter) const
+        {
+            Loader(interpreter, *m_prelude).load(Reader(m_data, m_size, m_graph_offset));
+        }
+
+        const CompiledProgram& Snapshot::prelude() const
+        {
+            return *m_prelude;
+        }
+    }
+}
@@ -0,0 +1,540 @@
+#include <tasks/tasks.hpp>
+
+namespace lang
+{
+    namespace tasks
+    {
+        namespace
+        {
+            /* The scheduler and worker index of a worker thread */
+            thread_local const Scheduler* tls_scheduler = nullptr;
+            thread_local std::size_t tls_worker{0};
+        }
+
+        /*****************************************ValueCloner*******************************************/
+        ValueCloner::ValueCloner(lang::Interpreter& target) : m_target(target) {}
+
+        bool ValueCloner::clone(const lang::util::object_t& value, lang::util::object_t& result)
+        {
+            if(auto* data = std::get_if<std::shared_ptr<lang::util::LLArray>>(&value))
+            {
+                auto it = m_copies.find(data->get());
+                if(it == m_copies.end())
+                {
+                    it = m_copies.emplace(data->get(), std::make_shared<lang::util::LLArray>(std::vector<double>((*data)->values))).first;
+                }
+
+                result = it->second;
+                return true;
+            }
+
+            if(auto* data = std::get_if<std::shared_ptr<lang::util::LLMap>>(&value))
+            {
+                auto it = m_copies.find(data->get());
+                if(it != m_copies.end())
+                {
+                    result = it->second;
+                    return true;
+                }
+
+                auto copy = std::make_shared<lang::util::LLMap>();
+                m_copies.emplace(data->get(), copy);
+
+                for(const auto& entry: (*data)->entries)
+                {
+                    lang::util::object_t entry_value;
+                    if(!this->clone(entry.value, entry_value))
+                    {
+                        return false;
+                    }
+
+                    copy->set(entry.key, entry_value);
+                }
+
+                result = copy;
+                return true;
+            }
+
+            if(auto* data = std::get_if<lang::util::LLCallable*>(&value))
+            {
+                return this->clone_callable(*data, result);
+            }
+
+            if(std::holds_alternative<lang::util::LLClass*>(value) || std::holds_alternative<std::shared_ptr<lang::util::LLInstance>>(value))
+            {
+                return false;
+            }
+
+            /* Numbers, booleans, nil and strings (their buffers are immutable and reference counted atomically) */
+            result = value;
+            return true;
+        }
+
+        bool ValueCloner::clone_callable(lang::util::LLCallable* callable, lang::util::object_t& result)
+        {
+            if(callable->flag_is_native_function)
+            {
+                lang::util::object_t* native = m_target.builtins()->find_local(callable->native_name);
+                if(native == nullptr)
+                {
+                    return false;
+                }
+
+                result = *native;
+                return true;
+            }
+
+            /* A method has "this" in its closure */
+            if(callable->closure->find_local("this") != nullptr)
+            {
+                return false;
+            }
+
+            auto it = m_copies.find(callable);
+            if(it != m_copies.end())
+            {
+                result = it->second;
+                return true;
+            }
+
+            auto* copy = new lang::util::LLCallable(&m_target, callable->function_declaration_statement, false, callable->arity, nullptr, nullptr);
+            m_target.adopt_callable(copy);
+
+            /* Before the closure, it can refer back to the function (a recursive global function) */
+            m_copies.emplace(callable, copy);
+            copy->closure = this->clone_environment(callable->closure);
+            this->clone_globals(callable->closure->global_environment(), callable->function_declaration_statement->globals);
+
+            copy->upvalues.reserve(callable->upvalues.size());
+            for(const auto& upvalue: callable->upvalues)
+            {
+                std::shared_ptr<lang::util::Upvalue> upvalue_copy = this->clone_upvalue(upvalue.get());
+                if(upvalue_copy == nullptr)
+                {
+                    return false;
+                }
+
+                copy->upvalues.push_back(std::move(upvalue_copy));
+            }
+
+            result = copy;
+            return true;
+        }
+
+        std::shared_ptr<lang::util::Upvalue> ValueCloner::clone_upvalue(lang::util::Upvalue* upvalue)
+        {
+            auto it = m_upvalues.find(upvalue);
+            if(it != m_upvalues.end())
+            {
+                return it->second;
+            }
+
+            std::shared_ptr<lang::util::Upvalue> copy;
+
+            /* An open one stays open on the copy of its variable, a function that captures the environment may see it too */
+            if(upvalue->environment != nullptr)
+            {
+                std::string_view name = upvalue->environment->name_of(upvalue->location);
+                lang::env::Environment* environment = this->clone_environment(upvalue->environment);
+
+                lang::util::object_t* variable = environment->find_local(name);
+                if(variable != nullptr)
+                {
+                    copy = std::make_shared<lang::util::Upvalue>(variable, environment);
+                }
+            }
+            else
+            {
+                /* A placeholder first, the value can be the function being cloned */
+                copy = std::make_shared<lang::util::Upvalue>(lang::util::null);
+                m_upvalues.emplace(upvalue, copy);
+
+                if(!this->clone(upvalue->closed, copy->closed))
+                {
+                    copy = nullptr;
+                }
+            }
+
+            m_upvalues[upvalue] = copy;
+            return copy;
+        }
+
+        lang::env::Environment* ValueCloner::clone_environment(lang::env::Environment* environment)
+        {
+            /* The outermost environment is the builtins one */
+            if(environment->enclosing() == nullptr)
+            {
+                return m_target.builtins();
+            }
+
+            auto it = m_environments.find(environment);
+            if(it != m_environments.end())
+            {
+                return it->second;
+            }
+
+            lang::env::Environment* enclosing = this->clone_environment(environment->enclosing());
+
+            lang::env::Environment* copy = m_target.make_environment(enclosing);
+            m_environments.emplace(environment, copy);
+
+            /* A global environment can hold anything the program made, its variables are copied when a function uses them */
+            if(environment->global_environment() == environment)
+            {
+                return copy;
+            }
+
+            for(const auto& [name, value]: environment->values())
+            {
+                lang::util::object_t value_copy;
+                if(this->clone(value, value_copy))
+                {
+                    copy->define(name, value_copy);
+                }
+            }
+
+            return copy;
+        }
+
+        void ValueCloner::clone_globals(lang::env::Environment* global, const std::vector<std::string_view>& names)
+        {
+            lang::env::Environment* copy = this->clone_environment(global);
+            std::unordered_set<std::string_view>& copied = m_globals[global];
+
+            for(std::string_view name: names)
+            {
+                /* Marked first, the value can be a function that uses the name itself */
+                if(!copied.insert(name).second)
+                {
+                    continue;
+                }
+
+                lang::util::object_t* variable = global->find_local(name);
+
+                lang::util::object_t value_copy;
+                if(variable != nullptr && this->clone(*variable, value_copy))
+                {
+                    copy->define(name, value_copy);
+                }
+            }
+        }
+
+        /*****************************************Task*******************************************/
+        Task::~Task()
+        {
+            /* Its values go before the run they belong to */
+            arguments.clear();
+            result = lang::util::null;
+
+            if(interpreter != nullptr)
+            {
+                scheduler->release_interpreter(std::move(interpreter));
+            }
+        }
+
+        void Task::run()
+        {
+            try
+            {
+                /* Cancelled before it started */
+                if(interpreter->cancelled())
+                {
+                    throw std::runtime_error("Execution cancelled");
+                }
+
+                result = function->call(lang::util::Arguments{arguments.data(), arguments.size()});
+            }
+            catch(const std::exception& e)
+            {
+                failure = e.what();
+            }
+
+            /* The interpreter records the errors of a run, even those that a block stopped */
+            if(!interpreter->errors().empty())
+            {
+                failure = interpreter->errors().front();
+            }
+
+            /* The tasks it spawned end with it, and what it printed is visible once it can be joined */
+            interpreter->end_run();
+
+            done.store(true, std::memory_order_release);
+            done.notify_all();
+        }
+
+        /*****************************************Scheduler*******************************************/
+        Scheduler::Scheduler(std::size_t worker_count)
+        {
+            worker_count = (worker_count == 0) ? 1 : worker_count;
+
+            for(std::size_t worker = 0; worker < worker_count; worker++)
+            {
+                m_workers.emplace_back(std::make_unique<Worker>());
+            }
+
+            for(std::size_t worker = 0; worker < worker_count; worker++)
+            {
+                m_threads.emplace_back(&Scheduler::worker_loop, this, worker);
+            }
+        }
+
+        Scheduler::~Scheduler()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_sleep_mutex);
+                m_stop = true;
+            }
+            m_wakeup.notify_all();
+
+            for(auto& thread: m_threads)
+            {
+                thread.join();
+            }
+        }
+
+        Scheduler& Scheduler::shared()
+        {
+            static Scheduler scheduler(std::thread::hardware_concurrency());
+
+            return scheduler;
+        }
+
+        std::size_t Scheduler::worker_count() const
+        {
+            return m_workers.size();
+        }
+
+        std::size_t Scheduler::current_worker() const
+        {
+            return (tls_scheduler == this) ? tls_worker : NOT_A_WORKER;
+        }
+
+        void Scheduler::submit(std::shared_ptr<Task> task)
+        {
+            /* Counted before it is visible, so a thief never sees the counter go below zero */
+            m_queued.fetch_add(1, std::memory_order_acq_rel);
+
+            std::size_t worker = this->current_worker();
+            Worker& queue = (worker == NOT_A_WORKER) ? m_injection : *m_workers[worker];
+            {
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.deque.push_back(std::move(task));
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_sleep_mutex);
+            }
+            m_wakeup.notify_one();
+        }
+
+        void Scheduler::wait(Task& task)
+        {
+            std::size_t worker = this->current_worker();
+            while(!task.done.load(std::memory_order_acquire))
+            {
+                /* Nothing left to run: the task is running on another thread */
+                if(!this->run_one(worker))
+                {
+                    task.done.wait(false, std::memory_order_acquire);
+                }
+            }
+        }
+
+        std::unique_ptr<lang::Interpreter> Scheduler::acquire_interpreter()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_idle_mutex);
+
+                if(!m_idle_interpreters.empty())
+                {
+                    std::unique_ptr<lang::Interpreter> interpreter = std::move(m_idle_interpreters.back());
+                    m_idle_interpreters.pop_back();
+
+                    return interpreter;
+                }
+            }
+
+            return std::make_unique<lang::Interpreter>();
+        }
+
+        void Scheduler::release_interpreter(std::unique_ptr<lang::Interpreter> interpreter)
+        {
+            interpreter->release_run();
+
+            std::lock_guard<std::mutex> lock(m_idle_mutex);
+
+            if(m_idle_interpreters.size() < m_workers.size() * IDLE_INTERPRETERS_PER_WORKER)
+            {
+                m_idle_interpreters.push_back(std::move(interpreter));
+            }
+        }
+
+        bool Scheduler::run_one(std::size_t worker)
+        {
+            std::shared_ptr<Task> task;
+
+            /* The newest task of its own deque (it is the most likely to be hot in the cache) */
+            if(worker != NOT_A_WORKER)
+            {
+                Worker& own = *m_workers[worker];
+                std::lock_guard<std::mutex> lock(own.mutex);
+
+                if(!own.deque.empty())
+                {
+                    task = std::move(own.deque.back());
+                    own.deque.pop_back();
+                }
+            }
+
+            /* Then the oldest task of the injection queue or of another worker */
+            std::size_t start = (worker == NOT_A_WORKER) ? 0 : worker + 1;
+            for(std::size_t i = 0; task == nullptr && i <= m_workers.size(); i++)
+            {
+                Worker& victim = (i == 0) ? m_injection : *m_workers[(start + i - 1) % m_workers.size()];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+
+                if(!victim.deque.empty())
+                {
+                    task = std::move(victim.deque.front());
+                    victim.deque.pop_front();
+                }
+            }
+
+            if(task == nullptr)
+            {
+                return false;
+            }
+
+            m_queued.fetch_sub(1, std::memory_order_acq_rel);
+            task->run();
+
+            return true;
+        }
+
+        void Scheduler::worker_loop(std::size_t worker)
+        {
+            tls_scheduler = this;
+            tls_worker = worker;
+
+            while(true)
+            {
+                if(this->run_one(worker))
+                {
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(m_sleep_mutex);
+                m_wakeup.wait(lock, [this]{ return m_stop || m_queued.load(std::memory_order_acquire) > 0; });
+
+                if(m_stop)
+                {
+                    return;
+                }
+            }
+        }
+
+        /*****************************************native functions*******************************************/
+        namespace
+        {
+            /* spawn(fn, args...) runs fn(args...) as a task and returns its handle */
+            lang::util::object_t native_spawn_function(const lang::util::LLCallable* callable, lang::util::Arguments arguments)
+            {
+                auto* data = std::get_if<lang::util::LLCallable*>(&arguments[0]);
+                if(data == nullptr)
+                {
+                    throw lang::util::native_error("spawn() expects a function as argument 1");
+                }
+
+                lang::util::LLCallable* function = *data;
+                if(arguments.size - 1 != function->arity)
+                {
+                    throw lang::util::native_error("spawn() expects " + std::to_string(function->arity) + " arguments for the function but got " + std::to_string(arguments.size - 1));
+                }
+
+                lang::Interpreter& spawner = *callable->interpreter;
+
+                auto task = std::make_shared<Task>();
+                task->programs = spawner.programs();
+                task->scheduler = &spawner.scheduler();
+                task->interpreter = task->scheduler->acquire_interpreter();
+                task->interpreter->set_programs(spawner.programs());
+                task->interpreter->set_scheduler(&spawner.scheduler());
+                task->interpreter->begin_run(spawner.inline_cache_count());
+                task->interpreter->inherit_limits(spawner);
+
+                ValueCloner cloner(*task->interpreter);
+
+                lang::util::object_t function_copy;
+                if(!cloner.clone(function, function_copy))
+                {
+                    throw lang::util::native_error("spawn() expects a function that can be shared between tasks, not a method");
+                }
+                task->function = std::get<lang::util::LLCallable*>(function_copy);
+
+                for(std::size_t i = 1; i < arguments.size; i++)
+                {
+                    lang::util::object_t argument_copy;
+                    if(!cloner.clone(arguments[i], argument_copy))
+                    {
+                        throw lang::util::native_error("spawn() argument " + std::to_string(i + 1) + " cannot be shared between tasks");
+                    }
+
+                    task->arguments.push_back(std::move(argument_copy));
+                }
+
+                double handle = static_cast<double>(spawner.adopt_task(task));
+                spawner.scheduler().submit(std::move(task));
+
+                return handle;
+            }
+
+            /* join(handle) waits for the task and returns its result, every handle can be joined once */
+            lang::util::object_t native_join_function(const lang::util::LLCallable* callable, lang::util::Arguments arguments)
+            {
+                auto* handle = std::get_if<double>(&arguments[0]);
+                if(handle == nullptr || *handle < 1 || *handle != static_cast<double>(static_cast<std::uint64_t>(*handle)))
+                {
+                    throw lang::util::native_error("join() expects a task handle as argument 1");
+                }
+
+                lang::Interpreter& joiner = *callable->interpreter;
+
+                std::shared_ptr<Task> task = joiner.take_task(static_cast<std::uint64_t>(*handle));
+                if(task == nullptr)
+                {
+                    throw lang::util::native_error("join() expects a handle returned by spawn() in this run that was not joined yet");
+                }
+
+                joiner.scheduler().wait(*task);
+
+                /* The task drew from the budget of the run, the joiner stops at its next step if it is used up */
+                joiner.settle_steps();
+
+                if(!task->failure.empty())
+                {
+                    std::string failure = task->failure;
+                    if(!failure.empty() && failure.back() == '\n')
+                    {
+                        failure.pop_back();
+                    }
+
+                    throw lang::util::native_error("join() of a failed task: " + failure);
+                }
+
+                lang::util::object_t result;
+                if(!ValueCloner(joiner).clone(task->result, result))
+                {
+                    throw lang::util::native_error("join() got a result that cannot be shared between tasks");
+                }
+
+                return result;
+            }
+        }
+
+        void register_natives(lang::Interpreter& interpreter)
+        {
+            interpreter.register_raw_native("spawn", 1, true, &native_spawn_function);
+            interpreter.register_raw_native("join", 1, false, &native_join_function);
+        }
+    }
+}
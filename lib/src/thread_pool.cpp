@@ -0,0 +1,119 @@
+#include <thread_pool/thread_pool.hpp>
+
+#include <utility>
+
+namespace lang
+{
+    ThreadPool::ThreadPool(std::size_t thread_count)
+    {
+        thread_count = (thread_count == 0) ? 1 : thread_count;
+
+        for(std::size_t worker = 0; worker < thread_count; worker++)
+        {
+            m_threads.emplace_back(&ThreadPool::worker_loop, this, worker);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_work_ready.notify_all();
+
+        for(auto& thread: m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    std::size_t ThreadPool::size() const
+    {
+        return m_threads.size();
+    }
+
+    void ThreadPool::parallel_for(std::size_t count, const std::function<void(std::size_t worker, std::size_t index)>& task)
+    {
+        if(count == 0)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> loop_lock(m_loop_mutex);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        m_task = &task;
+        m_count = count;
+        m_next.store(0, std::memory_order_relaxed);
+        m_running = m_threads.size();
+        m_exception = nullptr;
+        m_generation++;
+
+        m_work_ready.notify_all();
+        m_work_done.wait(lock, [this]{ return m_running == 0; });
+
+        m_task = nullptr;
+
+        if(m_exception)
+        {
+            std::rethrow_exception(std::exchange(m_exception, nullptr));
+        }
+    }
+
+    void ThreadPool::worker_loop(std::size_t worker)
+    {
+        std::uint64_t seen_generation{0};
+
+        while(true)
+        {
+            const std::function<void(std::size_t, std::size_t)>* task = nullptr;
+            std::size_t count{0};
+
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_work_ready.wait(lock, [&]{ return m_stop || m_generation != seen_generation; });
+
+                if(m_stop)
+                {
+                    return;
+                }
+
+                seen_generation = m_generation;
+                task = m_task;
+                count = m_count;
+            }
+
+            std::exception_ptr exception;
+            for(std::size_t index = m_next.fetch_add(1, std::memory_order_relaxed); index < count; index = m_next.fetch_add(1, std::memory_order_relaxed))
+            {
+                try
+                {
+                    (*task)(worker, index);
+                }
+                catch(...)
+                {
+                    if(!exception)
+                    {
+                        exception = std::current_exception();
+                    }
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+
+                if(exception && !m_exception)
+                {
+                    m_exception = exception;
+                }
+
+                if(--m_running == 0)
+                {
+                    m_work_done.notify_one();
+                }
+            }
+        }
+    }
+}
@@ -1,11 +1,194 @@
 #include <types/types.hpp>
 #include <interpreter/interpreter.hpp>
 #include <environment/environment.hpp>
+#include <memory/memory.hpp>
 
 namespace lang
 {
     namespace util
     {
+        /***************************************************LLString***************************************************/
+        struct LLString::Buffer
+        {
+            std::atomic<std::size_t> ref_count{1};
+            std::atomic<std::size_t> committed; /* characters written so far, appends claim the tail with a CAS on it */
+            std::size_t capacity;
+            std::size_t initial_length; /* the contents [0, initial_length) are the ones the cached hash is for */
+            std::atomic<std::uint64_t> cached_hash{0}; /* 0 means not computed yet */
+
+            Buffer(std::size_t committed, std::size_t capacity)
+                : committed(committed), capacity(capacity), initial_length(committed)
+            {}
+
+            char* data()
+            {
+                return reinterpret_cast<char*>(this + 1);
+            }
+
+            static Buffer* allocate(std::size_t committed, std::size_t capacity)
+            {
+                void* memory = lang::memory::allocate(sizeof(Buffer) + capacity, lang::memory::Subsystem::STRINGS);
+                return new (memory) Buffer(committed, capacity);
+            }
+
+            static void deallocate(Buffer* buffer)
+            {
+                buffer->~Buffer();
+                lang::memory::deallocate(buffer);
+            }
+        };
+
+        LLString::LLString()
+        {}
+
+        LLString::LLString(std::string_view text)
+            : m_size(text.size())
+        {
+            if(this->is_inline())
+            {
+                std::memcpy(m_inline, text.data(), text.size());
+                return;
+            }
+
+            m_buffer = Buffer::allocate(text.size(), text.size());
+            std::memcpy(m_buffer->data(), text.data(), text.size());
+        }
+
+        LLString::LLString(const LLString& other)
+            : m_size(other.m_size)
+        {
+            if(this->is_inline())
+            {
+                std::memcpy(m_inline, other.m_inline, INLINE_CAPACITY);
+                return;
+            }
+
+            m_buffer = other.m_buffer;
+            m_buffer->ref_count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        LLString::LLString(LLString&& other) noexcept
+            : m_size(other.m_size)
+        {
+            std::memcpy(m_inline, other.m_inline, INLINE_CAPACITY);
+            other.m_size = 0;
+        }
+
+        LLString& LLString::operator=(const LLString& other)
+        {
+            if(this != &other)
+            {
+                LLString copy(other);
+                *this = std::move(copy);
+            }
+
+            return *this;
+        }
+
+        LLString& LLString::operator=(LLString&& other) noexcept
+        {
+            if(this != &other)
+            {
+                this->release();
+
+                m_size = other.m_size;
+                std::memcpy(m_inline, other.m_inline, INLINE_CAPACITY);
+                other.m_size = 0;
+            }
+
+            return *this;
+        }
+
+        LLString::~LLString()
+        {
+            this->release();
+        }
+
+        void LLString::release()
+        {
+            if(!this->is_inline() && m_buffer->ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                Buffer::deallocate(m_buffer);
+            }
+        }
+
+        const char* LLString::heap_data() const
+        {
+            return m_buffer->data();
+        }
+
+        std::uint64_t LLString::hash() const
+        {
+            bool cacheable = !this->is_inline() && m_size == m_buffer->initial_length;
+
+            if(cacheable)
+            {
+                std::uint64_t cached = m_buffer->cached_hash.load(std::memory_order_relaxed);
+                if(cached != 0)
+                {
+                    return cached;
+                }
+            }
+
+            std::uint64_t hash = std::hash<std::string_view>{}(this->view());
+
+            if(cacheable)
+            {
+                m_buffer->cached_hash.store(hash, std::memory_order_relaxed);
+            }
+
+            return hash;
+        }
+
+        LLString LLString::compacted() const
+        {
+            if(this->is_inline() || (m_size == m_buffer->initial_length && m_size == m_buffer->capacity))
+            {
+                return *this;
+            }
+
+            return LLString(this->view());
+        }
+
+        LLString LLString::concatenate(const LLString& left, std::string_view right)
+        {
+            std::size_t length = left.m_size + right.size();
+
+            LLString result;
+            result.m_size = length;
+
+            if(result.is_inline())
+            {
+                std::string_view left_view = left.view();
+                std::memcpy(result.m_inline, left_view.data(), left_view.size());
+                std::memcpy(result.m_inline + left_view.size(), right.data(), right.size());
+                return result;
+            }
+
+            if(!left.is_inline() && length <= left.m_buffer->capacity)
+            {
+                /* Try to claim the tail of the buffer. It only succeeds if nothing was appended after "left" yet */
+                std::size_t expected = left.m_size;
+                if(left.m_buffer->committed.compare_exchange_strong(expected, length, std::memory_order_acq_rel))
+                {
+                    /* "right" may be a prefix of this very buffer ("s + s"), it is never overwritten */
+                    std::memcpy(left.m_buffer->data() + left.m_size, right.data(), right.size());
+
+                    result.m_buffer = left.m_buffer;
+                    result.m_buffer->ref_count.fetch_add(1, std::memory_order_relaxed);
+                    return result;
+                }
+            }
+
+            /* A fresh buffer with room to grow, so that the next append can happen in place */
+            result.m_buffer = Buffer::allocate(length, std::max<std::size_t>(2 * length, 64));
+
+            std::string_view left_view = left.view();
+            std::memcpy(result.m_buffer->data(), left_view.data(), left_view.size());
+            std::memcpy(result.m_buffer->data() + left_view.size(), right.data(), right.size());
+
+            return result;
+        }
 
         LLCallable::LLCallable(
                 
@@ -13,7 +196,7 @@ namespace lang
                     lang::ast::FunctionStatement* function_declaration_statement, 
                     bool flag_is_native_function,
                     size_t arity,
-                    lang::util::object_t (*call_fn)(std::vector<lang::util::object_t>&& arguments),
+                    native_fn_t call_fn,
                     lang::env::Environment* closure
 
             ) :     arity(arity), 
@@ -25,21 +208,41 @@ namespace lang
         {}
 
         LLCallable::~LLCallable()
+        {}
+
+        void* LLCallable::operator new(std::size_t size)
         {
-            if(new_environment != nullptr)
-            {
-                delete new_environment;
-            }
+            return lang::memory::allocate(size, lang::memory::Subsystem::CALLABLES);
+        }
+
+        void LLCallable::operator delete(void* memory)
+        {
+            lang::memory::deallocate(memory);
+        }
+
+        void* LLClass::operator new(std::size_t size)
+        {
+            return lang::memory::allocate(size, lang::memory::Subsystem::CALLABLES);
         }
 
-        lang::util::object_t LLCallable::call(std::vector<lang::util::object_t>&& arguments)
+        void LLClass::operator delete(void* memory)
+        {
+            lang::memory::deallocate(memory);
+        }
+
+        lang::util::object_t LLCallable::call(lang::util::Arguments arguments)
         {
             if(flag_is_native_function)
             {
                 /* We have a native function */
-                return this->call_fn(std::move(arguments));
+                return this->call_fn(this, arguments);
             }
 
+            return this->call(arguments, closure);
+        }
+
+        lang::util::object_t LLCallable::call(lang::util::Arguments arguments, lang::env::Environment* closure)
+        {
             /*
                 std::unique_ptr<lang::env::Environment> environment = std::make_unique<lang::env::Environment>(interpreter->get_environment());
 
@@ -47,23 +250,275 @@ namespace lang
             */
             // std::unique_ptr<lang::env::Environment> environment = std::make_unique<lang::env::Environment>(closure);
 
-            new_environment = new lang::env::Environment(closure);
+            lang::FrameEnvironment frame(*interpreter, closure, function_declaration_statement->frame_escapes);
+            lang::env::Environment* new_environment = frame.get();
+
+            lang::CallUpvalues call_upvalues(*interpreter, upvalues);
+
+            lang::profiler::ShadowFrame shadow_frame(interpreter->shadow_stack(), function_declaration_statement);
 
             for(int i = 0; i < function_declaration_statement->params.size(); i++)
             {
-                new_environment->define(function_declaration_statement->params.at(i).m_lexeme, arguments.at(i));
+                new_environment->define(function_declaration_statement->params.at(i).m_lexeme, arguments[i]);
             }
 
             try{
 
+                interpreter->count_step(function_declaration_statement->name.m_line);
+
                 interpreter->execute_block(function_declaration_statement->body_stmts, new_environment);
                 
+            } catch(lang::util::execution_aborted& e)
+            {
+                e.add_frame(function_declaration_statement->name.m_lexeme);
+
+                throw;
             } catch(const lang::util::return_statement_throw& e)
             {
+                if(flag_is_initializer)
+                {
+                    return *closure->find_local("this");
+                }
+
                 return e.get_val();
             }
 
+            if(flag_is_initializer)
+            {
+                return *closure->find_local("this");
+            }
+
             return lang::util::null;
         }
+
+        /***************************************************LLMap***************************************************/
+        bool LLMap::is_valid_key(const lang::util::object_t& key)
+        {
+            return std::holds_alternative<double>(key) || std::holds_alternative<lang::util::LLString>(key);
+        }
+
+        std::uint64_t LLMap::hash_key(const lang::util::object_t& key)
+        {
+            std::uint64_t hash{0};
+
+            if(auto* data = std::get_if<double>(&key))
+            {
+                /* 0.0 and -0.0 are the same key */
+                double number = (*data == 0) ? 0.0 : *data;
+                std::memcpy(&hash, &number, sizeof(hash));
+            }
+            else
+            {
+                /* It is cached in the string buffer for interned strings, so this is constant time for them */
+                hash = std::get<lang::util::LLString>(key).hash();
+            }
+
+            /* splitmix64 finalizer, so both the low bits (slot) and the high bits (tag) are well mixed */
+            hash ^= hash >> 30;
+            hash *= 0xbf58476d1ce4e5b9ULL;
+            hash ^= hash >> 27;
+            hash *= 0x94d049bb133111ebULL;
+            hash ^= hash >> 31;
+
+            return hash;
+        }
+
+        bool LLMap::keys_equal(const lang::util::object_t& key_A, const lang::util::object_t& key_B)
+        {
+            if(auto* A_data_double = std::get_if<double>(&key_A))
+            {
+                auto* B_data_double = std::get_if<double>(&key_B);
+                return B_data_double && (*A_data_double) == (*B_data_double);
+            }
+
+            auto* B_data_string = std::get_if<lang::util::LLString>(&key_B);
+            return B_data_string && std::get<lang::util::LLString>(key_A) == (*B_data_string);
+        }
+
+        LLMap::Slot* LLMap::find_slot(const lang::util::object_t& key, std::uint64_t hash)
+        {
+            if(m_slots.empty())
+            {
+                return nullptr;
+            }
+
+            std::size_t mask = m_slots.size() - 1;
+            std::uint32_t tag = static_cast<std::uint32_t>(hash >> 32);
+
+            for(std::size_t i = hash & mask; ; i = (i + 1) & mask)
+            {
+                Slot& slot = m_slots[i];
+
+                if(slot.position == EMPTY)
+                {
+                    return nullptr;
+                }
+
+                if(slot.position >= 0 && slot.hash_tag == tag && LLMap::keys_equal(entries[slot.position].key, key))
+                {
+                    return &slot;
+                }
+            }
+        }
+
+        LLMap::Slot* LLMap::find_slot_of_position(std::uint64_t hash, std::size_t position)
+        {
+            std::size_t mask = m_slots.size() - 1;
+
+            for(std::size_t i = hash & mask; ; i = (i + 1) & mask)
+            {
+                if(m_slots[i].position == static_cast<std::int32_t>(position))
+                {
+                    return &m_slots[i];
+                }
+            }
+        }
+
+        void LLMap::insert_slot(std::uint64_t hash, std::size_t position)
+        {
+            std::size_t mask = m_slots.size() - 1;
+
+            for(std::size_t i = hash & mask; ; i = (i + 1) & mask)
+            {
+                Slot& slot = m_slots[i];
+
+                if(slot.position < 0)
+                {
+                    if(slot.position == EMPTY)
+                    {
+                        m_used_slots++;
+                    }
+
+                    slot.position = static_cast<std::int32_t>(position);
+                    slot.hash_tag = static_cast<std::uint32_t>(hash >> 32);
+                    return;
+                }
+            }
+        }
+
+        void LLMap::rehash(std::size_t capacity)
+        {
+            m_slots.assign(capacity, Slot{EMPTY, 0});
+            m_used_slots = 0;
+
+            for(std::size_t i = 0; i < entries.size(); i++)
+            {
+                this->insert_slot(entries[i].hash, i);
+            }
+        }
+
+        lang::util::object_t* LLMap::get(const lang::util::object_t& key)
+        {
+            Slot* slot = this->find_slot(key, LLMap::hash_key(key));
+
+            if(slot == nullptr)
+            {
+                return nullptr;
+            }
+
+            return &entries[slot->position].value;
+        }
+
+        void LLMap::set(const lang::util::object_t& key, const lang::util::object_t& value)
+        {
+            std::uint64_t hash = LLMap::hash_key(key);
+
+            if(Slot* slot = this->find_slot(key, hash))
+            {
+                entries[slot->position].value = value;
+                return;
+            }
+
+            /* Keep the table at most 3/4 full (tombstones included) so probing always finds an EMPTY slot quickly */
+            if((m_used_slots + 1) * 4 > m_slots.size() * 3)
+            {
+                std::size_t capacity = m_slots.empty() ? 8 : m_slots.size();
+                while((entries.size() + 1) * 2 > capacity)
+                {
+                    capacity *= 2;
+                }
+
+                this->rehash(capacity);
+            }
+
+            if(auto* string = std::get_if<lang::util::LLString>(&key))
+            {
+                /* Keys are compacted so that a map never keeps a large shared buffer alive and their hash can be cached */
+                entries.push_back(Entry{string->compacted(), value, hash});
+            }
+            else
+            {
+                entries.push_back(Entry{key, value, hash});
+            }
+            this->insert_slot(hash, entries.size() - 1);
+        }
+
+        bool LLMap::remove(const lang::util::object_t& key)
+        {
+            Slot* slot = this->find_slot(key, LLMap::hash_key(key));
+
+            if(slot == nullptr)
+            {
+                return false;
+            }
+
+            std::size_t position = slot->position;
+            std::size_t last = entries.size() - 1;
+            slot->position = TOMBSTONE;
+
+            if(position != last)
+            {
+                this->find_slot_of_position(entries[last].hash, last)->position = static_cast<std::int32_t>(position);
+                entries[position] = std::move(entries[last]);
+            }
+
+            entries.pop_back();
+
+            return true;
+        }
+
+        /***************************************************LLShape/LLClass***************************************************/
+        const std::size_t* LLShape::find_field(std::string_view name) const
+        {
+            auto it = field_slots.find(name);
+            if(it != field_slots.end())
+            {
+                return &it->second;
+            }
+
+            return nullptr;
+        }
+
+        LLShape* LLShape::add_field(std::string_view name)
+        {
+            auto it = transitions.find(name);
+            if(it != transitions.end())
+            {
+                return it->second.get();
+            }
+
+            auto shape = std::make_unique<LLShape>(klass);
+            shape->field_slots = field_slots;
+            shape->field_slots.emplace(std::string(name), field_slots.size());
+
+            LLShape* temp = shape.get();
+            transitions.emplace(std::string(name), std::move(shape));
+
+            return temp;
+        }
+
+        lang::util::LLCallable* LLClass::find_method(std::string_view name) const
+        {
+            for(const LLClass* klass = this; klass != nullptr; klass = klass->superclass)
+            {
+                auto it = klass->methods.find(name);
+                if(it != klass->methods.end())
+                {
+                    return it->second;
+                }
+            }
+
+            return nullptr;
+        }
     }
 }
\ No newline at end of file